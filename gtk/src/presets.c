@@ -1715,27 +1715,381 @@ presets_list_remove(signal_user_data_t *ud, hb_preset_index_t *path)
     }
 }
 
+/*
+ * The queue is stored as a snapshot, queue.<pid>, followed by a journal,
+ * queue.<pid>.journal, of the changes made since the snapshot was
+ * written. Each journal line is a JSON record:
+ *   {"Op": "insert", "Index": n, "Job": {...}}
+ *   {"Op": "remove", "Index": n}
+ *   {"Op": "move",   "Index": n, "To": m}
+ *   {"Op": "update", "Index": n, "uiSettings": {...}}
+ * ghb_save_queue() compares the queue with what has been stored so far
+ * and only appends the records needed to bring it up to date. When the
+ * journal grows larger than the queue, the snapshot is rewritten and
+ * the journal dropped.
+ */
+#define QUEUE_JOURNAL_MIN_RECORDS 64
+
+// uiSettings keys that change while a job sits in the queue
+static const char *queue_journal_keys[] =
+{
+    "job_status",
+    "job_unique_id",
+    "job_start_time",
+    "job_finish_time",
+    "job_pause_time_ms",
+    "ActivityFilename",
+    NULL
+};
+
+typedef struct
+{
+    GhbValue *job;      // reference to the stored queue entry
+    GhbValue *state;    // stored values of queue_journal_keys
+} queue_journal_entry_t;
+
+// Queue entries as they are stored on disk
+static GPtrArray *queue_journal_entries = NULL;
+static int        queue_journal_records = 0;
+
+static void
+queue_journal_entry_free (gpointer data)
+{
+    queue_journal_entry_t *entry = data;
+
+    ghb_value_decref(entry->job);
+    ghb_value_free(&entry->state);
+    g_free(entry);
+}
+
+static GhbValue *
+queue_journal_state (GhbValue *job)
+{
+    GhbValue *uiDict = ghb_dict_get(job, "uiSettings");
+    GhbValue *state  = ghb_dict_new();
+    int       ii;
+
+    for (ii = 0; queue_journal_keys[ii] != NULL; ii++)
+    {
+        GhbValue *val = ghb_dict_get(uiDict, queue_journal_keys[ii]);
+        if (val != NULL)
+        {
+            ghb_dict_set(state, queue_journal_keys[ii], ghb_value_dup(val));
+        }
+    }
+    return state;
+}
+
+static gboolean
+queue_journal_state_changed (queue_journal_entry_t *entry)
+{
+    GhbValue *uiDict = ghb_dict_get(entry->job, "uiSettings");
+    int       ii;
+
+    for (ii = 0; queue_journal_keys[ii] != NULL; ii++)
+    {
+        GhbValue *val = ghb_dict_get(uiDict, queue_journal_keys[ii]);
+        GhbValue *old = ghb_dict_get(entry->state, queue_journal_keys[ii]);
+        if (val == NULL && old == NULL)
+            continue;
+        if (val == NULL || old == NULL || ghb_value_cmp(val, old))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static queue_journal_entry_t *
+queue_journal_entry_new (GhbValue *job)
+{
+    queue_journal_entry_t *entry = g_new0(queue_journal_entry_t, 1);
+
+    ghb_value_incref(job);
+    entry->job   = job;
+    entry->state = queue_journal_state(job);
+    return entry;
+}
+
+static GhbValue *
+queue_journal_record (const char *op, int index)
+{
+    GhbValue *record = ghb_dict_new();
+
+    ghb_dict_set_string(record, "Op", op);
+    ghb_dict_set_int(record, "Index", index);
+    return record;
+}
+
+// Updates queue_journal_entries to match queue and returns the
+// records that do the same to the stored queue
+static GhbValue *
+queue_journal_diff (GhbValue *queue)
+{
+    GhbValue   *records = ghb_array_new();
+    GHashTable *jobs;
+    int         ii, jj, count;
+
+    if (queue_journal_entries == NULL)
+    {
+        queue_journal_entries =
+            g_ptr_array_new_with_free_func(queue_journal_entry_free);
+    }
+
+    // Removed jobs, last first so that the indices stay valid
+    count = ghb_array_len(queue);
+    jobs  = g_hash_table_new(NULL, NULL);
+    for (ii = 0; ii < count; ii++)
+    {
+        g_hash_table_add(jobs, ghb_array_get(queue, ii));
+    }
+    for (ii = queue_journal_entries->len - 1; ii >= 0; ii--)
+    {
+        queue_journal_entry_t *entry;
+
+        entry = g_ptr_array_index(queue_journal_entries, ii);
+        if (!g_hash_table_contains(jobs, entry->job))
+        {
+            ghb_array_append(records, queue_journal_record("remove", ii));
+            g_ptr_array_remove_index(queue_journal_entries, ii);
+        }
+    }
+
+    // Added and moved jobs. Every stored job is now in the queue,
+    // so both lists have the same length once this is done.
+    g_hash_table_remove_all(jobs);
+    for (ii = 0; ii < queue_journal_entries->len; ii++)
+    {
+        queue_journal_entry_t *entry;
+
+        entry = g_ptr_array_index(queue_journal_entries, ii);
+        g_hash_table_add(jobs, entry->job);
+    }
+    for (ii = 0; ii < count; ii++)
+    {
+        GhbValue              *job = ghb_array_get(queue, ii);
+        queue_journal_entry_t *entry;
+
+        if (ii < queue_journal_entries->len)
+        {
+            entry = g_ptr_array_index(queue_journal_entries, ii);
+            if (entry->job == job)
+                continue;
+        }
+        if (!g_hash_table_contains(jobs, job))
+        {
+            GhbValue *record = queue_journal_record("insert", ii);
+
+            ghb_value_incref(job);
+            ghb_dict_set(record, "Job", job);
+            ghb_array_append(records, record);
+            g_ptr_array_insert(queue_journal_entries, ii,
+                               queue_journal_entry_new(job));
+            continue;
+        }
+        for (jj = ii + 1; jj < queue_journal_entries->len; jj++)
+        {
+            entry = g_ptr_array_index(queue_journal_entries, jj);
+            if (entry->job == job)
+                break;
+        }
+        if (jj < queue_journal_entries->len)
+        {
+            GhbValue *record = queue_journal_record("move", jj);
+
+            ghb_dict_set_int(record, "To", ii);
+            ghb_array_append(records, record);
+            g_ptr_array_steal_index(queue_journal_entries, jj);
+            g_ptr_array_insert(queue_journal_entries, ii, entry);
+        }
+    }
+    g_hash_table_destroy(jobs);
+
+    // Status changes
+    for (ii = 0; ii < queue_journal_entries->len; ii++)
+    {
+        queue_journal_entry_t *entry;
+
+        entry = g_ptr_array_index(queue_journal_entries, ii);
+        if (queue_journal_state_changed(entry))
+        {
+            GhbValue *record = queue_journal_record("update", ii);
+
+            ghb_value_free(&entry->state);
+            entry->state = queue_journal_state(entry->job);
+            ghb_dict_set(record, "uiSettings", ghb_value_dup(entry->state));
+            ghb_array_append(records, record);
+        }
+    }
+    return records;
+}
+
+static void
+queue_journal_append (const gchar *path, GhbValue *records)
+{
+    FILE *fp;
+    int   ii, count;
+
+    fp = g_fopen(path, "a");
+    if (fp == NULL)
+    {
+        g_warning("Failed to open queue journal %s", path);
+        return;
+    }
+    count = ghb_array_len(records);
+    for (ii = 0; ii < count; ii++)
+    {
+        char *line = ghb_json_dump_line(ghb_array_get(records, ii));
+        if (line != NULL)
+        {
+            fprintf(fp, "%s\n", line);
+            free(line);
+        }
+    }
+    fclose(fp);
+}
+
+static void
+queue_journal_replay (GhbValue *queue, GhbValue *record)
+{
+    const char *op    = ghb_dict_get_string(record, "Op");
+    int         index = ghb_dict_get_int(record, "Index");
+    int         count = ghb_array_len(queue);
+    GhbValue   *job;
+
+    if (op == NULL || index < 0)
+        return;
+
+    if (!strcmp(op, "insert"))
+    {
+        job = ghb_dict_get(record, "Job");
+        if (job == NULL || index > count)
+            return;
+        if (index == count)
+            ghb_array_append(queue, ghb_value_dup(job));
+        else
+            ghb_array_insert(queue, index, ghb_value_dup(job));
+    }
+    else if (!strcmp(op, "remove"))
+    {
+        if (index < count)
+            ghb_array_remove(queue, index);
+    }
+    else if (!strcmp(op, "move"))
+    {
+        int to = ghb_dict_get_int(record, "To");
+        if (index >= count || to < 0 || to >= count)
+            return;
+        job = ghb_array_get(queue, index);
+        ghb_value_incref(job);
+        ghb_array_remove(queue, index);
+        if (to == count - 1)
+            ghb_array_append(queue, job);
+        else
+            ghb_array_insert(queue, to, job);
+    }
+    else if (!strcmp(op, "update"))
+    {
+        GhbValue *state = ghb_dict_get(record, "uiSettings");
+        GhbValue *uiDict;
+        int       ii;
+
+        if (index >= count || state == NULL)
+            return;
+        job    = ghb_array_get(queue, index);
+        uiDict = ghb_dict_get(job, "uiSettings");
+        for (ii = 0; uiDict != NULL && queue_journal_keys[ii] != NULL; ii++)
+        {
+            GhbValue *val = ghb_dict_get(state, queue_journal_keys[ii]);
+            if (val != NULL)
+                ghb_dict_set(uiDict, queue_journal_keys[ii],
+                             ghb_value_dup(val));
+            else
+                ghb_dict_remove(uiDict, queue_journal_keys[ii]);
+        }
+    }
+}
+
+static gchar *
+queue_file_path (int64_t pid, const char *suffix)
+{
+    gchar *config, *path;
+
+    config = ghb_get_user_config_dir(NULL);
+    path   = g_strdup_printf("%s/queue.%" PRId64 "%s", config, pid, suffix);
+    g_free(config);
+    return path;
+}
+
 void
 ghb_save_queue(GhbValue *queue)
 {
-    pid_t  pid;
-    char  *name;
+    GhbValue *records;
+    gchar    *path, *journal;
+    int       count;
+    gboolean  compact;
 
-    pid  = getpid();
-    name = g_strdup_printf ("queue.%" PRId64, (int64_t)pid);
-    write_config_file(name, queue);
-    g_free(name);
+    // The first save of the session always writes a snapshot
+    compact = queue_journal_entries == NULL;
+    path    = queue_file_path(getpid(), "");
+    journal = queue_file_path(getpid(), ".journal");
+    records = queue_journal_diff(queue);
+    count   = ghb_array_len(records);
+
+    if (compact || queue_journal_records + count >
+                   MAX(QUEUE_JOURNAL_MIN_RECORDS, ghb_array_len(queue)))
+    {
+        // Compact. Drop the journal first, so that an interrupted
+        // compaction leaves an older but consistent queue behind.
+        g_unlink(journal);
+        ghb_write_settings_file(path, queue);
+        queue_journal_records = 0;
+    }
+    else if (count > 0)
+    {
+        queue_journal_append(journal, records);
+        queue_journal_records += count;
+    }
+    ghb_value_free(&records);
+    g_free(journal);
+    g_free(path);
 }
 
 GhbValue*
 ghb_load_old_queue(int pid)
 {
     GhbValue *queue;
-    char     *name;
+    gchar    *path, *journal;
+    gchar    *contents = NULL;
 
-    name  = g_strdup_printf ("queue.%d", pid);
-    queue = read_config_file(name);
-    g_free(name);
+    path    = queue_file_path(pid, "");
+    journal = queue_file_path(pid, ".journal");
+    queue   = ghb_read_settings_file(path);
+
+    if (g_file_get_contents(journal, &contents, NULL, NULL))
+    {
+        gchar **lines;
+        int     ii;
+
+        if (queue == NULL)
+            queue = ghb_array_new();
+        lines = g_strsplit(contents, "\n", -1);
+        for (ii = 0; lines[ii] != NULL; ii++)
+        {
+            GhbValue *record;
+
+            if (lines[ii][0] == 0)
+                continue;
+            // A truncated last line is the only expected parse failure
+            record = ghb_json_parse(lines[ii]);
+            if (record == NULL)
+                break;
+            queue_journal_replay(queue, record);
+            ghb_value_free(&record);
+        }
+        g_strfreev(lines);
+        g_free(contents);
+    }
+    g_free(journal);
+    g_free(path);
     return queue;
 }
 
@@ -1747,6 +2101,9 @@ ghb_remove_old_queue_file(int pid)
     name = g_strdup_printf ("queue.%d", pid);
     remove_config_file(name);
     g_free(name);
+    name = g_strdup_printf ("queue.%d.journal", pid);
+    remove_config_file(name);
+    g_free(name);
 }
 
 GhbValue* ghb_create_copy_mask(GhbValue *settings)
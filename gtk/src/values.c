@@ -93,6 +93,13 @@ ghb_value_cmp(const GhbValue *vala, const GhbValue *valb)
     return !json_equal((GhbValue*)vala, (GhbValue*)valb);
 }
 
+// Serialize to single line JSON, free the result with free()
+char *
+ghb_json_dump_line (const GhbValue *gval)
+{
+    return json_dumps(gval, JSON_COMPACT | JSON_SORT_KEYS);
+}
+
 GhbValue*
 ghb_string_value(const gchar *str)
 {
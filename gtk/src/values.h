@@ -78,6 +78,7 @@ typedef hb_dict_iter_t  GhbDictIter;
 #define ghb_json_parse_file             hb_value_read_json
 
 gint ghb_value_cmp(const GhbValue *vala, const GhbValue *valb);
+char * ghb_json_dump_line(const GhbValue *gval);
 void ghb_string_value_set(GhbValue *gval, const gchar *str);
 
 GhbValue* ghb_string_value(const gchar *str);
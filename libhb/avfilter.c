@@ -237,6 +237,31 @@ static hb_buffer_t* filterFrame( hb_filter_private_t * pv, hb_buffer_t ** buf_in
     return hb_buffer_list_head(&list);
 }
 
+// Filter a single frame without the one frame delay of avfilter_work.
+// Returns NULL if the graph holds the frame back, in which case calling
+// again with a NULL buf_in flushes the graph.  The graph can not be used
+// after it has been flushed.
+hb_buffer_t * hb_avfilter_filter_frame(hb_filter_object_t * filter,
+                                       hb_buffer_t ** buf_in)
+{
+    hb_filter_private_t * pv = filter->private_data;
+    hb_buffer_t         * out = NULL, * buf;
+
+    if (pv == NULL || pv->graph == NULL)
+    {
+        return NULL;
+    }
+
+    hb_avfilter_add_buf(pv->graph, buf_in);
+    while ((buf = hb_avfilter_get_buf(pv->graph)) != NULL)
+    {
+        hb_buffer_close(&out);
+        out = buf;
+    }
+
+    return out;
+}
+
 static int avfilter_work( hb_filter_object_t * filter,
                           hb_buffer_t ** buf_in, hb_buffer_t ** buf_out )
 {
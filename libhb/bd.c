@@ -13,6 +13,21 @@
 
 #include "libbluray/bluray.h"
 
+// Blu-ray m2ts data is stored in aligned units of 32 packets
+#define BD_PACKET_SIZE      192
+#define BD_UNIT_SIZE        (32 * BD_PACKET_SIZE)
+// Number of aligned units buffered by the read-ahead thread
+#define BD_READ_AHEAD_UNITS 128
+
+typedef struct
+{
+    uint8_t data[BD_UNIT_SIZE];
+    int     size;           // Bytes of whole packets, < 0 on read error
+    int     chapter;        // Last chapter event, 0 for none
+    int     discontinuity;  // A new play item starts in this unit
+    int     end_of_title;
+} hb_bd_unit_t;
+
 struct hb_bd_s
 {
     char                    * path;
@@ -26,12 +41,28 @@ struct hb_bd_s
     int                       next_chap;
     hb_handle_t             * h;
     int                       keep_duplicate_titles;
+
+    // Read-ahead ring of aligned units, filled by bd_read_ahead_thread()
+    hb_thread_t             * read_thread;
+    hb_lock_t               * read_lock;
+    hb_cond_t               * read_cond;
+    hb_bd_unit_t            * units;
+    int                       unit_head;
+    int                       unit_count;
+    int                       read_eof;
+    int                       read_die;
+
+    // Unit being demuxed by hb_bd_read()
+    hb_bd_unit_t            * unit;
+    int                       unit_pos;
+    int                       discontinuity;
 };
 
 /***********************************************************************
  * Local prototypes
  **********************************************************************/
-static int           next_packet( BLURAY *bd, uint8_t *pkt );
+static void          read_unit( BLURAY *bd, hb_bd_unit_t *unit );
+static void          bd_read_ahead_stop( hb_bd_t * d );
 static int title_info_compare_mpls(const void *, const void *);
 
 /***********************************************************************
@@ -806,6 +837,7 @@ int hb_bd_start( hb_bd_t * d, hb_title_t *title )
 
     d->duration  = title->duration;
 
+    bd_read_ahead_stop(d);
     // Calling bd_get_event initializes libbluray event queue.
     bd_select_title( d->bd, d->title_info[title->index - 1]->idx );
     bd_get_event( d->bd, &event );
@@ -826,6 +858,7 @@ int hb_bd_start( hb_bd_t * d, hb_title_t *title )
  **********************************************************************/
 void hb_bd_stop( hb_bd_t * d )
 {
+    bd_read_ahead_stop(d);
     if( d->stream ) hb_stream_close( &d->stream );
 }
 
@@ -838,6 +871,7 @@ int hb_bd_seek( hb_bd_t * d, float f )
 {
     uint64_t pos = f * d->duration;
 
+    bd_read_ahead_stop(d);
     bd_seek_time(d->bd, pos);
     d->next_chap = bd_get_current_chapter( d->bd ) + 1;
     hb_ts_stream_reset(d->stream);
@@ -846,6 +880,7 @@ int hb_bd_seek( hb_bd_t * d, float f )
 
 int hb_bd_seek_pts( hb_bd_t * d, uint64_t pts )
 {
+    bd_read_ahead_stop(d);
     bd_seek_time(d->bd, pts);
     d->next_chap = bd_get_current_chapter( d->bd ) + 1;
     hb_ts_stream_reset(d->stream);
@@ -854,114 +889,210 @@ int hb_bd_seek_pts( hb_bd_t * d, uint64_t pts )
 
 int hb_bd_seek_chapter( hb_bd_t * d, int c )
 {
+    bd_read_ahead_stop(d);
     d->next_chap = c;
     bd_seek_chapter( d->bd, c - 1 );
     hb_ts_stream_reset(d->stream);
     return 1;
 }
 
+/***********************************************************************
+ * bd_read_ahead_thread
+ ***********************************************************************
+ * Reads whole aligned units ahead of the demuxer, together with the
+ * libbluray events raised while reading them.
+ **********************************************************************/
+static void bd_read_ahead_thread( void * _d )
+{
+    hb_bd_t * d = _d;
+
+    hb_lock(d->read_lock);
+    while (!d->read_die && !d->read_eof)
+    {
+        if (d->unit_count >= BD_READ_AHEAD_UNITS)
+        {
+            hb_cond_wait(d->read_cond, d->read_lock);
+            continue;
+        }
+        hb_bd_unit_t * unit = &d->units[(d->unit_head + d->unit_count) %
+                                        BD_READ_AHEAD_UNITS];
+        hb_unlock(d->read_lock);
+
+        // The demuxer never touches units past unit_head + unit_count
+        read_unit(d->bd, unit);
+
+        hb_lock(d->read_lock);
+        d->unit_count++;
+        d->read_eof = unit->end_of_title;
+        hb_cond_broadcast(d->read_cond);
+    }
+    hb_unlock(d->read_lock);
+}
+
+static int bd_read_ahead_start( hb_bd_t * d )
+{
+    if (d->units == NULL)
+    {
+        d->units = calloc(BD_READ_AHEAD_UNITS, sizeof(hb_bd_unit_t));
+        if (d->units == NULL)
+        {
+            return -1;
+        }
+        d->read_lock = hb_lock_init();
+        d->read_cond = hb_cond_init();
+    }
+    d->read_thread = hb_thread_init("bd_read_ahead", bd_read_ahead_thread,
+                                    d, HB_NORMAL_PRIORITY);
+    return d->read_thread != NULL ? 0 : -1;
+}
+
+// Must be called before anything else moves the libbluray read position
+static void bd_read_ahead_stop( hb_bd_t * d )
+{
+    if (d->read_thread == NULL)
+    {
+        return;
+    }
+
+    hb_lock(d->read_lock);
+    d->read_die = 1;
+    hb_cond_broadcast(d->read_cond);
+    hb_unlock(d->read_lock);
+    hb_thread_close(&d->read_thread);
+
+    d->read_die      = 0;
+    d->read_eof      = 0;
+    d->unit_head     = 0;
+    d->unit_count    = 0;
+    d->unit          = NULL;
+    d->unit_pos      = 0;
+    d->discontinuity = 0;
+}
+
+// Releases the unit being demuxed and waits for the next one.
+// Returns NULL once the end of title has been consumed.
+static hb_bd_unit_t * bd_next_unit( hb_bd_t * d )
+{
+    hb_lock(d->read_lock);
+    if (d->unit != NULL)
+    {
+        d->unit_head = (d->unit_head + 1) % BD_READ_AHEAD_UNITS;
+        d->unit_count--;
+        d->unit = NULL;
+        hb_cond_broadcast(d->read_cond);
+    }
+    while (d->unit_count == 0 && !d->read_eof)
+    {
+        hb_cond_wait(d->read_cond, d->read_lock);
+    }
+    if (d->unit_count > 0)
+    {
+        d->unit     = &d->units[d->unit_head];
+        d->unit_pos = 0;
+    }
+    hb_unlock(d->read_lock);
+
+    return d->unit;
+}
+
 /***********************************************************************
  * hb_bd_read
  ***********************************************************************
- *
+ * Demuxes packets in place from the units of the read-ahead thread
  **********************************************************************/
 hb_buffer_t * hb_bd_read( hb_bd_t * d )
 {
-    int result;
     int error_count = 0;
     int retry_count = 0;
-    uint8_t buf[192];
-    BD_EVENT event;
-    uint64_t pos;
+    hb_bd_unit_t * unit;
     hb_buffer_t * out = NULL;
     uint8_t discontinuity;
 
+    if (d->read_thread == NULL && bd_read_ahead_start(d) < 0)
+    {
+        hb_error("bd: failed to start read-ahead");
+        hb_set_work_error(d->h, HB_ERROR_READ);
+        return NULL;
+    }
+
     while ( 1 )
     {
-        discontinuity = 0;
-        result = next_packet( d->bd, buf );
-        while ( bd_get_event( d->bd, &event ) )
+        unit = d->unit;
+        if (unit == NULL || d->unit_pos >= unit->size)
         {
-            switch ( event.event )
+            unit = bd_next_unit(d);
+            if (unit == NULL)
             {
-                case BD_EVENT_CHAPTER:
-                    // The muxers expect to only get chapter 2 and above
-                    // They write chapter 1 when chapter 2 is detected.
-                    if (event.param > d->chapter)
-                    {
-                        d->next_chap = event.param;
-                    }
-                    break;
-
-                case BD_EVENT_PLAYITEM:
-                    discontinuity = 1;
-                    hb_deep_log(2, "bd: Play item %u", event.param);
-                    break;
-
-                case BD_EVENT_STILL:
-                    bd_read_skip_still( d->bd );
-                    break;
-
-                case BD_EVENT_END_OF_TITLE:
-                    hb_log("bd: End of title");
-                    if (result <= 0)
-                    {
-                        return NULL;
-                    }
-                    break;
+                return NULL;
+            }
 
-                default:
-                    break;
+            // The muxers expect to only get chapter 2 and above
+            // They write chapter 1 when chapter 2 is detected.
+            if (unit->chapter > d->chapter)
+            {
+                d->next_chap = unit->chapter;
+            }
+            d->discontinuity |= unit->discontinuity;
+            if (unit->end_of_title)
+            {
+                hb_log("bd: End of title");
             }
-        }
 
-        if ( result < 0 )
-        {
-            hb_error("bd: Read Error");
-            pos = bd_tell( d->bd );
-            bd_seek( d->bd, pos + 192 );
-            error_count++;
-            if (error_count > 10)
+            if (unit->size < 0)
             {
-                hb_error("bd: Error, too many consecutive read errors");
-                hb_set_work_error(d->h, HB_ERROR_READ);
-                return NULL;
+                hb_error("bd: Read Error");
+                error_count++;
+                if (error_count > 10)
+                {
+                    hb_error("bd: Error, too many consecutive read errors");
+                    hb_set_work_error(d->h, HB_ERROR_READ);
+                    return NULL;
+                }
+                continue;
             }
-            continue;
-        }
-        else if ( result == 0 )
-        {
-            // libbluray returns 0 when it encounters and skips a bad unit.
-            // So retry a few times to be certain there is no more data
-            // to be read.
-            retry_count++;
-            if (retry_count > 1000)
+            else if (unit->size == 0)
             {
-                // A unit is 6144 bytes (32 TS packets).  Give up after we've
-                // seen > 6MB of invalid data.
-                hb_error("bd: Error, too many consecutive bad units.");
-                hb_set_work_error(d->h, HB_ERROR_READ);
-                return NULL;
+                if (unit->end_of_title)
+                {
+                    continue;
+                }
+                // libbluray returns 0 when it encounters and skips a bad unit.
+                // So retry a few times to be certain there is no more data
+                // to be read.
+                retry_count++;
+                if (retry_count > 1000)
+                {
+                    // A unit is 6144 bytes (32 TS packets).  Give up after we've
+                    // seen > 6MB of invalid data.
+                    hb_error("bd: Error, too many consecutive bad units.");
+                    hb_set_work_error(d->h, HB_ERROR_READ);
+                    return NULL;
+                }
+                continue;
             }
-            continue;
-        }
 
-        if (retry_count > 0)
-        {
-            hb_error("bd: Read Error, skipping bad data.");
-            retry_count = 0;
+            if (retry_count > 0)
+            {
+                hb_error("bd: Read Error, skipping bad data.");
+                retry_count = 0;
+            }
+            error_count = 0;
         }
 
-        error_count = 0;
-        // buf+4 to skip the BD timestamp at start of packet
+        uint8_t * pkt = unit->data + d->unit_pos;
+        d->unit_pos += BD_PACKET_SIZE;
+        discontinuity = d->discontinuity;
+        d->discontinuity = 0;
+
+        // pkt+4 to skip the BD timestamp at start of packet
         if (d->chapter != d->next_chap)
         {
             d->chapter = d->next_chap;
-            out = hb_ts_decode_pkt(d->stream, buf+4, d->chapter, discontinuity);
+            out = hb_ts_decode_pkt(d->stream, pkt+4, d->chapter, discontinuity);
         }
         else
         {
-            out = hb_ts_decode_pkt(d->stream, buf+4, 0, discontinuity);
+            out = hb_ts_decode_pkt(d->stream, pkt+4, 0, discontinuity);
         }
         if (out != NULL)
         {
@@ -997,6 +1128,10 @@ void hb_bd_close( hb_bd_t ** _d )
             bd_free_title_info( d->title_info[ii] );
         free( d->title_info );
     }
+    bd_read_ahead_stop(d);
+    hb_cond_close( &d->read_cond );
+    hb_lock_close( &d->read_lock );
+    free( d->units );
     if( d->stream ) hb_stream_close( &d->stream );
     if( d->bd ) bd_close( d->bd );
     if( d->path ) free( d->path );
@@ -1012,6 +1147,7 @@ void hb_bd_close( hb_bd_t ** _d )
  **********************************************************************/
 void hb_bd_set_angle( hb_bd_t * d, int angle )
 {
+    bd_read_ahead_stop(d);
 
     if ( !bd_select_angle( d->bd, angle) )
     {
@@ -1035,6 +1171,30 @@ static int have_ts_sync(const uint8_t *buf, int psize)
 
 #define MAX_HOLE 192*80
 
+// bd_seek seeks to the nearest access unit *before* the requested position
+// we don't want to seek backwards, so we need to read until we get
+// past that position.
+static int seek_forward(BLURAY *bd, uint64_t off)
+{
+    uint8_t buf[192];
+    int     result;
+
+    bd_seek(bd, off);
+    while (off > bd_tell(bd))
+    {
+        result = bd_read(bd, buf, 192);
+        if (result < 0)
+        {
+            return -1;
+        }
+        else if (result != 192)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 static uint64_t align_to_next_packet(BLURAY *bd, uint8_t *pkt)
 {
     int      result;
@@ -1084,60 +1244,91 @@ static uint64_t align_to_next_packet(BLURAY *bd, uint8_t *pkt)
         }
     }
     off = start + pos - 4;
-    // bd_seek seeks to the nearest access unit *before* the requested position
-    // we don't want to seek backwards, so we need to read until we get
-    // past that position.
-    bd_seek(bd, off);
-    while (off > bd_tell(bd))
+    result = seek_forward(bd, off);
+    if (result <= 0)
     {
-        result = bd_read(bd, buf, 192);
-        if (result < 0)
-        {
-            return -1;
-        }
-        else if (result != 192)
-        {
-            return 0;
-        }
+        return result;
     }
     return start - orig + pos;
 }
 
-static int next_packet( BLURAY *bd, uint8_t *pkt )
+// Reads one aligned unit and collects the events raised by reading it
+static void read_unit( BLURAY *bd, hb_bd_unit_t *unit )
 {
-    int result;
+    int      result, off;
+    uint64_t pos = bd_tell(bd);
+    BD_EVENT event;
 
-    while ( 1 )
+    result = bd_read(bd, unit->data, BD_UNIT_SIZE);
+
+    unit->chapter       = 0;
+    unit->discontinuity = 0;
+    unit->end_of_title  = 0;
+    while (bd_get_event(bd, &event))
     {
-        result = bd_read( bd, pkt, 192 );
-        if ( result < 0 )
-        {
-            return -1;
-        }
-        if ( result < 192 )
+        switch (event.event)
         {
-            return 0;
+            case BD_EVENT_CHAPTER:
+                unit->chapter = event.param;
+                break;
+
+            case BD_EVENT_PLAYITEM:
+                unit->discontinuity = 1;
+                hb_deep_log(2, "bd: Play item %u", event.param);
+                break;
+
+            case BD_EVENT_STILL:
+                bd_read_skip_still(bd);
+                break;
+
+            case BD_EVENT_END_OF_TITLE:
+                unit->end_of_title = 1;
+                break;
+
+            default:
+                break;
         }
+    }
+
+    if (result < 0)
+    {
+        // Skip the whole unit, seeking inside it would land on it again
+        unit->size = -1;
+        bd_seek(bd, pos + BD_UNIT_SIZE);
+        return;
+    }
+
+    // Whole packets only, short reads happen at the end of a clip
+    unit->size = result - result % BD_PACKET_SIZE;
+    for (off = 0; off < unit->size; off += BD_PACKET_SIZE)
+    {
         // Sync byte is byte 4.  0-3 are timestamp.
-        if (pkt[4] == 0x47)
-        {
-            return 1;
-        }
-        // lost sync - back up to where we started then try to re-establish.
-        uint64_t pos = bd_tell(bd);
-        uint64_t pos2 = align_to_next_packet(bd, pkt);
-        if (pos2 < 0)
-        {
-            return -1;
-        }
-        else if (pos2 == 0)
+        if (unit->data[off + 4] != 0x47)
         {
-            hb_log("next_packet: eof while re-establishing sync @ %"PRIu64"", pos );
-            return 0;
+            break;
         }
-        hb_log("next_packet: sync lost @ %"PRIu64", regained after %"PRIu64" bytes",
-                 pos, pos2 );
     }
+    if (off >= unit->size)
+    {
+        return;
+    }
+
+    // lost sync - keep the good packets, then back up to just after
+    // the bad one and try to re-establish.
+    unit->size = off;
+    uint64_t lost = pos + off;
+    if (seek_forward(bd, lost + BD_PACKET_SIZE) <= 0)
+    {
+        return;
+    }
+    uint64_t pos2 = align_to_next_packet(bd, unit->data + off);
+    if (pos2 == 0)
+    {
+        hb_log("bd: eof while re-establishing sync @ %"PRIu64"", lost);
+        return;
+    }
+    hb_log("bd: sync lost @ %"PRIu64", regained after %"PRIu64" bytes",
+           lost, pos2);
 }
 
 static int title_info_compare_mpls(const void *va, const void *vb)
@@ -9,9 +9,14 @@
 
 #include "handbrake/common.h"
 #include "handbrake/avfilter_priv.h"
+#include "handbrake/taskset.h"
+#include "libavutil/csp.h"
 
 static int colorspace_init(hb_filter_object_t * filter,
                            hb_filter_init_t * init);
+static int colorspace_work(hb_filter_object_t * filter,
+                           hb_buffer_t ** buf_in, hb_buffer_t ** buf_out);
+static void colorspace_close(hb_filter_object_t * filter);
 
 const char colorspace_template[] =
     "primaries=^"HB_ALL_REG"$:transfer=^"HB_ALL_REG"$:matrix=^"HB_ALL_REG"$:range=^"HB_ALL_REG"$:"
@@ -26,8 +31,8 @@ hb_filter_object_t hb_filter_colorspace =
     .short_name        = "colorspace",
     .settings          = NULL,
     .init              = colorspace_init,
-    .work              = hb_avfilter_null_work,
-    .close             = hb_avfilter_alias_close,
+    .work              = colorspace_work,
+    .close             = colorspace_close,
     .settings_template = colorspace_template,
 };
 
@@ -47,6 +52,807 @@ static double determine_signal_peak(hb_filter_init_t * init)
     return peak;
 }
 
+/*
+ * Native conversion
+ *
+ * Planar YUV software frames are converted with a 3D LUT indexed by the
+ * source Y'CbCr code values.  Each node holds the destination Y'CbCr
+ * code values, computed once with the same steps as the zscale/tonemap
+ * graph: linearize, tonemap, convert primaries, encode and quantize.
+ * Frames are then converted with integer trilinear interpolation on
+ * horizontal slices, without any floating point math per pixel.
+ * The graph is still used when the LUT output does not match it on a
+ * test frame, see colorspace_lut_check().
+ */
+
+#define LUT_SIZE_Y    65
+#define LUT_SIZE_C    33
+#define LUT_FRAC_BITS 10
+
+enum
+{
+    TONEMAP_NONE,
+    TONEMAP_LINEAR,
+    TONEMAP_GAMMA,
+    TONEMAP_CLIP,
+    TONEMAP_REINHARD,
+    TONEMAP_HABLE,
+    TONEMAP_MOBIUS,
+};
+
+typedef struct
+{
+    taskset_thread_arg_t          arg;
+    struct hb_colorspace_lut_s  * lut;
+    hb_buffer_t                 * in;
+    hb_buffer_t                 * out;
+} colorspace_thread_arg_t;
+
+typedef struct hb_colorspace_lut_s
+{
+    int                        depth;
+    int                        max;
+    int                        x_shift;
+    int                        y_shift;
+    int                        tonemap;
+
+    // [LUT_SIZE_Y][LUT_SIZE_C][LUT_SIZE_C][3] destination Y'CbCr
+    uint16_t                 * table;
+
+    int                        threads;
+    taskset_t                  taskset;
+    colorspace_thread_arg_t ** thread_data;
+} hb_colorspace_lut_t;
+
+typedef struct
+{
+    int idx;
+    int frac;
+} lut_pos_t;
+
+typedef struct
+{
+    int    depth;
+    int    range;
+    double kr, kg, kb;
+} ycc_params_t;
+
+static inline void lut_index(const hb_colorspace_lut_t * lut, int code,
+                             int size, lut_pos_t * pos)
+{
+    int t = MIN(code, lut->max) * (size - 1);
+
+    pos->idx  = t >> lut->depth;
+    t        &= (1 << lut->depth) - 1;
+    pos->frac = lut->depth >= LUT_FRAC_BITS ? t >> (lut->depth - LUT_FRAC_BITS) :
+                                              t << (LUT_FRAC_BITS - lut->depth);
+}
+
+static inline int lut_lerp(int a, int b, int frac)
+{
+    return a + (((b - a) * frac + (1 << (LUT_FRAC_BITS - 1))) >> LUT_FRAC_BITS);
+}
+
+static inline int lut_interp(const uint16_t * table, const lut_pos_t * py,
+                             const lut_pos_t * pb, const lut_pos_t * pr, int c)
+{
+    const int sr = 3;
+    const int sb = LUT_SIZE_C * sr;
+    const int sy = LUT_SIZE_C * sb;
+    const uint16_t * p = table + py->idx * sy + pb->idx * sb + pr->idx * sr + c;
+
+    int c00 = lut_lerp(p[0],       p[sr],           pr->frac);
+    int c01 = lut_lerp(p[sb],      p[sb + sr],      pr->frac);
+    int c10 = lut_lerp(p[sy],      p[sy + sr],      pr->frac);
+    int c11 = lut_lerp(p[sy + sb], p[sy + sb + sr], pr->frac);
+
+    return lut_lerp(lut_lerp(c00, c01, pb->frac),
+                    lut_lerp(c10, c11, pb->frac), py->frac);
+}
+
+#define BIT_DEPTH 8
+#include "templates/colorspace_template.c"
+#undef BIT_DEPTH
+
+#define BIT_DEPTH 16
+#include "templates/colorspace_template.c"
+#undef BIT_DEPTH
+
+static int tonemap_from_name(const char * name)
+{
+    if (name == NULL || !strcmp(name, "hable"))
+        return TONEMAP_HABLE;
+    if (!strcmp(name, "none"))
+        return TONEMAP_NONE;
+    if (!strcmp(name, "linear"))
+        return TONEMAP_LINEAR;
+    if (!strcmp(name, "gamma"))
+        return TONEMAP_GAMMA;
+    if (!strcmp(name, "clip"))
+        return TONEMAP_CLIP;
+    if (!strcmp(name, "reinhard"))
+        return TONEMAP_REINHARD;
+    if (!strcmp(name, "mobius"))
+        return TONEMAP_MOBIUS;
+    return -1;
+}
+
+// Same defaults as the libavfilter tonemap filter
+static double tonemap_param(int tonemap, double param)
+{
+    if (param == 0)
+    {
+        switch (tonemap)
+        {
+            case TONEMAP_GAMMA:    param = 1.8; break;
+            case TONEMAP_REINHARD: param = 0.5; break;
+            case TONEMAP_MOBIUS:   param = 0.3; break;
+            default:               param = 1.0; break;
+        }
+    }
+    if (tonemap == TONEMAP_REINHARD)
+    {
+        param = (1.0 - param) / param;
+    }
+    return param;
+}
+
+static double hable(double in)
+{
+    double a = 0.15, b = 0.50, c = 0.10, d = 0.20, e = 0.02, f = 0.30;
+    return (in * (in * a + b * c) + d * e) / (in * (in * a + b) + d * f) - e / f;
+}
+
+static double mobius(double in, double j, double peak)
+{
+    double a, b;
+
+    if (in <= j)
+        return in;
+
+    a = -j * j * (peak - 1.0) / (j * j - 2.0 * j + peak);
+    b = (j * j - 2.0 * j * peak + peak) / MAX(peak - 1.0, 1e-6);
+
+    return (b * b + 2.0 * b * j + j * j) / (b - a) * (in + a) / (in + b);
+}
+
+static double tonemap_signal(int tonemap, double sig, double peak, double param)
+{
+    switch (tonemap)
+    {
+        case TONEMAP_LINEAR:
+            return sig * param / peak;
+        case TONEMAP_GAMMA:
+            return sig > 0.05 ? pow(sig / peak, 1.0 / param) :
+                                sig * pow(0.05 / peak, 1.0 / param) / 0.05;
+        case TONEMAP_CLIP:
+            return MIN(MAX(sig * param, 0), 1.0);
+        case TONEMAP_REINHARD:
+            return sig / (sig + param) * (peak + param) / peak;
+        case TONEMAP_HABLE:
+            return hable(sig) / hable(peak);
+        case TONEMAP_MOBIUS:
+            return mobius(sig, param, peak);
+        default:
+            return sig;
+    }
+}
+
+static int transfer_supported(int transfer)
+{
+    switch (transfer)
+    {
+        case HB_COLR_TRA_BT709:
+        case HB_COLR_TRA_GAMMA22:
+        case HB_COLR_TRA_GAMMA28:
+        case HB_COLR_TRA_SMPTE170M:
+        case HB_COLR_TRA_LINEAR:
+        case HB_COLR_TRA_IEC61966_2_1:
+        case HB_COLR_TRA_BT2020_10:
+        case HB_COLR_TRA_BT2020_12:
+        case HB_COLR_TRA_SMPTEST2084:
+        case HB_COLR_TRA_ARIB_STD_B67:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int transfer_is_hdr(int transfer)
+{
+    return transfer == HB_COLR_TRA_SMPTEST2084 ||
+           transfer == HB_COLR_TRA_ARIB_STD_B67;
+}
+
+#define BT709_ALPHA 1.09929682680944
+#define BT709_BETA  0.018053968510807
+
+// Encoded value to linear light.  HDR transfers return nits / npl,
+// like zscale with transfer=linear.
+static double transfer_to_linear(int transfer, double v, double npl,
+                                 const double rgb[3], const ycc_params_t * ycc)
+{
+    switch (transfer)
+    {
+        case HB_COLR_TRA_GAMMA22:
+            return pow(v, 2.2);
+        case HB_COLR_TRA_GAMMA28:
+            return pow(v, 2.8);
+        case HB_COLR_TRA_LINEAR:
+            return v;
+        case HB_COLR_TRA_IEC61966_2_1:
+            return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+        case HB_COLR_TRA_SMPTEST2084:
+        {
+            const double m1 = 2610.0 / 16384, m2 = 2523.0 / 4096 * 128;
+            const double c1 = 3424.0 / 4096,  c2 = 2413.0 / 4096 * 32;
+            const double c3 = 2392.0 / 4096 * 32;
+            double p = pow(v, 1.0 / m2);
+            return pow(MAX(p - c1, 0) / (c2 - c3 * p), 1.0 / m1) * 10000.0 / npl;
+        }
+        case HB_COLR_TRA_ARIB_STD_B67:
+        {
+            // Inverse OETF followed by the OOTF of a 1000 nits display
+            const double a = 0.17883277, b = 0.28466892, c = 0.55991073;
+            double e[3], ys;
+            for (int ii = 0; ii < 3; ii++)
+            {
+                e[ii] = rgb[ii] <= 0.5 ? rgb[ii] * rgb[ii] / 3.0 :
+                                         (exp((rgb[ii] - c) / a) + b) / 12.0;
+            }
+            ys = ycc->kr * e[0] + ycc->kg * e[1] + ycc->kb * e[2];
+            e[0] = v <= 0.5 ? v * v / 3.0 : (exp((v - c) / a) + b) / 12.0;
+            return 1000.0 / npl * pow(MAX(ys, 0), 0.2) * e[0];
+        }
+        default:
+            return v < BT709_BETA * 4.5 ? v / 4.5 :
+                   pow((v + BT709_ALPHA - 1.0) / BT709_ALPHA, 1.0 / 0.45);
+    }
+}
+
+static double transfer_from_linear(int transfer, double v)
+{
+    v = MAX(v, 0);
+    switch (transfer)
+    {
+        case HB_COLR_TRA_GAMMA22:
+            return pow(v, 1.0 / 2.2);
+        case HB_COLR_TRA_GAMMA28:
+            return pow(v, 1.0 / 2.8);
+        case HB_COLR_TRA_LINEAR:
+            return v;
+        case HB_COLR_TRA_IEC61966_2_1:
+            return v <= 0.0031308 ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+        default:
+            return v < BT709_BETA ? v * 4.5 :
+                   BT709_ALPHA * pow(v, 0.45) - (BT709_ALPHA - 1.0);
+    }
+}
+
+static int ycc_params_init(ycc_params_t * ycc, int matrix, int range, int depth)
+{
+    const AVLumaCoefficients * coeffs;
+
+    if (matrix == AVCOL_SPC_BT2020_CL || matrix == AVCOL_SPC_RGB)
+    {
+        return -1;
+    }
+    coeffs = av_csp_luma_coeffs_from_avcsp(matrix);
+    if (coeffs == NULL)
+    {
+        return -1;
+    }
+    ycc->kr    = av_q2d(coeffs->cr);
+    ycc->kg    = av_q2d(coeffs->cg);
+    ycc->kb    = av_q2d(coeffs->cb);
+    ycc->range = range;
+    ycc->depth = depth;
+
+    return 0;
+}
+
+static void ycc_to_rgb(const ycc_params_t * ycc, const double code[3], double rgb[3])
+{
+    double scale = 1 << (ycc->depth - 8), y, cb, cr;
+
+    if (ycc->range == AVCOL_RANGE_JPEG)
+    {
+        double max = (1 << ycc->depth) - 1;
+        y  = code[0] / max;
+        cb = (code[1] - (1 << (ycc->depth - 1))) / max;
+        cr = (code[2] - (1 << (ycc->depth - 1))) / max;
+    }
+    else
+    {
+        y  = (code[0] / scale - 16.0)  / 219.0;
+        cb = (code[1] / scale - 128.0) / 224.0;
+        cr = (code[2] / scale - 128.0) / 224.0;
+    }
+
+    rgb[0] = y + 2.0 * (1.0 - ycc->kr) * cr;
+    rgb[2] = y + 2.0 * (1.0 - ycc->kb) * cb;
+    rgb[1] = (y - ycc->kr * rgb[0] - ycc->kb * rgb[2]) / ycc->kg;
+}
+
+static void rgb_to_ycc(const ycc_params_t * ycc, const double rgb[3], uint16_t code[3])
+{
+    double scale = 1 << (ycc->depth - 8), max = (1 << ycc->depth) - 1;
+    double y, cb, cr, out[3];
+
+    y  = ycc->kr * rgb[0] + ycc->kg * rgb[1] + ycc->kb * rgb[2];
+    cb = (rgb[2] - y) / (2.0 * (1.0 - ycc->kb));
+    cr = (rgb[0] - y) / (2.0 * (1.0 - ycc->kr));
+
+    if (ycc->range == AVCOL_RANGE_JPEG)
+    {
+        out[0] = y * max;
+        out[1] = cb * max + (1 << (ycc->depth - 1));
+        out[2] = cr * max + (1 << (ycc->depth - 1));
+    }
+    else
+    {
+        out[0] = (y  * 219.0 + 16.0)  * scale;
+        out[1] = (cb * 224.0 + 128.0) * scale;
+        out[2] = (cr * 224.0 + 128.0) * scale;
+    }
+    for (int ii = 0; ii < 3; ii++)
+    {
+        code[ii] = (uint16_t)MIN(MAX(lrint(out[ii]), 0), max);
+    }
+}
+
+static int rgb_to_xyz(int primaries, double m[3][3])
+{
+    const AVColorPrimariesDesc * desc = av_csp_primaries_desc_from_id(primaries);
+    double p[3][3], inv[3][3], w[3], s[3], det;
+
+    if (desc == NULL)
+    {
+        return -1;
+    }
+
+    const AVCIExy * xy[3] = { &desc->prim.r, &desc->prim.g, &desc->prim.b };
+    for (int ii = 0; ii < 3; ii++)
+    {
+        double x = av_q2d(xy[ii]->x), y = av_q2d(xy[ii]->y);
+        p[0][ii] = x / y;
+        p[1][ii] = 1.0;
+        p[2][ii] = (1.0 - x - y) / y;
+    }
+    w[0] = av_q2d(desc->wp.x) / av_q2d(desc->wp.y);
+    w[1] = 1.0;
+    w[2] = (1.0 - av_q2d(desc->wp.x) - av_q2d(desc->wp.y)) / av_q2d(desc->wp.y);
+
+    det = p[0][0] * (p[1][1] * p[2][2] - p[1][2] * p[2][1]) -
+          p[0][1] * (p[1][0] * p[2][2] - p[1][2] * p[2][0]) +
+          p[0][2] * (p[1][0] * p[2][1] - p[1][1] * p[2][0]);
+    if (det == 0)
+    {
+        return -1;
+    }
+    for (int ii = 0; ii < 3; ii++)
+    {
+        for (int jj = 0; jj < 3; jj++)
+        {
+            int r0 = (jj + 1) % 3, r1 = (jj + 2) % 3;
+            int c0 = (ii + 1) % 3, c1 = (ii + 2) % 3;
+            inv[ii][jj] = (p[r0][c0] * p[r1][c1] - p[r0][c1] * p[r1][c0]) / det;
+        }
+    }
+    for (int ii = 0; ii < 3; ii++)
+    {
+        s[ii] = inv[ii][0] * w[0] + inv[ii][1] * w[1] + inv[ii][2] * w[2];
+    }
+    for (int ii = 0; ii < 3; ii++)
+    {
+        for (int jj = 0; jj < 3; jj++)
+        {
+            m[ii][jj] = p[ii][jj] * s[jj];
+        }
+    }
+    return 0;
+}
+
+static void matrix_invert(const double m[3][3], double inv[3][3])
+{
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                 m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+    for (int ii = 0; ii < 3; ii++)
+    {
+        for (int jj = 0; jj < 3; jj++)
+        {
+            int r0 = (jj + 1) % 3, r1 = (jj + 2) % 3;
+            int c0 = (ii + 1) % 3, c1 = (ii + 2) % 3;
+            inv[ii][jj] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+        }
+    }
+}
+
+static void colorspace_lut_thread(void * thread_args_v)
+{
+    colorspace_thread_arg_t * thread_data = thread_args_v;
+    hb_colorspace_lut_t     * lut = thread_data->lut;
+    hb_buffer_t             * in  = thread_data->in;
+    hb_buffer_t             * out = thread_data->out;
+    int segment = thread_data->arg.segment;
+
+    // Split on chroma rows so that slices do not share chroma samples
+    int height = in->plane[1].height;
+    int cy0 = height * segment / lut->threads;
+    int cy1 = height * (segment + 1) / lut->threads;
+    int y0  = cy0 << lut->y_shift;
+    int y1  = segment == lut->threads - 1 ? in->plane[0].height :
+                                            cy1 << lut->y_shift;
+
+    if (lut->depth > 8)
+    {
+        colorspace_lut_luma_16(lut, in, out, y0, y1);
+        colorspace_lut_chroma_16(lut, in, out, cy0, cy1);
+    }
+    else
+    {
+        colorspace_lut_luma_8(lut, in, out, y0, y1);
+        colorspace_lut_chroma_8(lut, in, out, cy0, cy1);
+    }
+}
+
+static void colorspace_lut_close(hb_colorspace_lut_t ** _lut)
+{
+    hb_colorspace_lut_t * lut = *_lut;
+
+    if (lut == NULL)
+    {
+        return;
+    }
+    if (lut->thread_data != NULL)
+    {
+        taskset_fini(&lut->taskset);
+    }
+    free(lut->thread_data);
+    av_free(lut->table);
+    free(lut);
+    *_lut = NULL;
+}
+
+// Returns NULL if the conversion is not supported natively
+static hb_colorspace_lut_t * colorspace_lut_init(hb_filter_init_t * init,
+                                                 int color_prim, int color_transfer,
+                                                 int color_matrix, int color_range,
+                                                 int tonemap, double param,
+                                                 double desat, double npl)
+{
+    const AVPixFmtDescriptor * desc = av_pix_fmt_desc_get(init->pix_fmt);
+    hb_colorspace_lut_t      * lut;
+    ycc_params_t               ycc_in, ycc_out;
+    double                     to_xyz[3][3], xyz[3][3], from_xyz[3][3];
+    double                     prim[3][3];
+    double                     peak = 1;
+    int                        depth;
+
+    if (init->hw_pix_fmt != AV_PIX_FMT_NONE || desc == NULL ||
+        desc->nb_components != 3 ||
+        (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_BE |
+                        AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                        AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_FLOAT)))
+    {
+        return NULL;
+    }
+    depth = desc->comp[0].depth;
+    for (int ii = 0; ii < 3; ii++)
+    {
+        if (desc->comp[ii].plane != ii || desc->comp[ii].shift != 0 ||
+            desc->comp[ii].offset != 0 || desc->comp[ii].depth != depth)
+        {
+            return NULL;
+        }
+    }
+    if (depth < 8 || depth > 16)
+    {
+        return NULL;
+    }
+
+    // HDR sources are only handled when they are tonemapped to SDR
+    if (!transfer_supported(init->color_transfer) ||
+        !transfer_supported(color_transfer) || transfer_is_hdr(color_transfer) ||
+        (transfer_is_hdr(init->color_transfer) && tonemap < 0))
+    {
+        return NULL;
+    }
+
+    if (ycc_params_init(&ycc_in, init->color_matrix,
+                        init->color_range == AVCOL_RANGE_JPEG ?
+                        AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG, depth) < 0 ||
+        ycc_params_init(&ycc_out, color_matrix,
+                        color_range == AVCOL_RANGE_JPEG ?
+                        AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG, depth) < 0)
+    {
+        return NULL;
+    }
+
+    if (rgb_to_xyz(init->color_prim, to_xyz) < 0 ||
+        rgb_to_xyz(color_prim, xyz) < 0)
+    {
+        return NULL;
+    }
+    matrix_invert(xyz, from_xyz);
+    for (int ii = 0; ii < 3; ii++)
+    {
+        for (int jj = 0; jj < 3; jj++)
+        {
+            prim[ii][jj] = from_xyz[ii][0] * to_xyz[0][jj] +
+                           from_xyz[ii][1] * to_xyz[1][jj] +
+                           from_xyz[ii][2] * to_xyz[2][jj];
+        }
+    }
+
+    lut = calloc(1, sizeof(hb_colorspace_lut_t));
+    if (lut == NULL)
+    {
+        return NULL;
+    }
+    lut->depth   = depth;
+    lut->max     = (1 << depth) - 1;
+    lut->x_shift = desc->log2_chroma_w;
+    lut->y_shift = desc->log2_chroma_h;
+    lut->tonemap = tonemap;
+    lut->table   = av_malloc(sizeof(uint16_t) * 3 *
+                             LUT_SIZE_Y * LUT_SIZE_C * LUT_SIZE_C);
+    if (lut->table == NULL)
+    {
+        goto fail;
+    }
+
+    if (tonemap >= 0)
+    {
+        peak  = determine_signal_peak(init);
+        param = tonemap_param(tonemap, param);
+    }
+
+    // Node i of an axis with n nodes is at code value i * 2^depth / (n - 1)
+    uint16_t * node = lut->table;
+    for (int iy = 0; iy < LUT_SIZE_Y; iy++)
+    {
+        for (int ib = 0; ib < LUT_SIZE_C; ib++)
+        {
+            for (int ir = 0; ir < LUT_SIZE_C; ir++, node += 3)
+            {
+                double code[3], rgb[3], lin[3], out[3];
+
+                code[0] = (double)(iy << depth) / (LUT_SIZE_Y - 1);
+                code[1] = (double)(ib << depth) / (LUT_SIZE_C - 1);
+                code[2] = (double)(ir << depth) / (LUT_SIZE_C - 1);
+
+                // Keep SDR headroom, HDR curves are only defined up to 1
+                ycc_to_rgb(&ycc_in, code, rgb);
+                for (int ii = 0; ii < 3; ii++)
+                {
+                    rgb[ii] = MAX(rgb[ii], 0);
+                    if (transfer_is_hdr(init->color_transfer))
+                    {
+                        rgb[ii] = MIN(rgb[ii], 1.0);
+                    }
+                }
+                for (int ii = 0; ii < 3; ii++)
+                {
+                    lin[ii] = transfer_to_linear(init->color_transfer, rgb[ii],
+                                                 npl, rgb, &ycc_in);
+                }
+
+                if (tonemap >= 0)
+                {
+                    if (desat > 0)
+                    {
+                        double luma = ycc_in.kr * lin[0] + ycc_in.kg * lin[1] +
+                                      ycc_in.kb * lin[2];
+                        double overbright = MAX(luma - desat, 1e-6) / MAX(luma, 1e-6);
+                        for (int ii = 0; ii < 3; ii++)
+                        {
+                            lin[ii] = lin[ii] * (1.0 - overbright) + luma * overbright;
+                        }
+                    }
+                    double sig = MAX(MAX(MAX(lin[0], lin[1]), lin[2]), 1e-6);
+                    double mapped = tonemap_signal(tonemap, sig, peak, param);
+                    for (int ii = 0; ii < 3; ii++)
+                    {
+                        lin[ii] *= mapped / sig;
+                    }
+                }
+
+                for (int ii = 0; ii < 3; ii++)
+                {
+                    out[ii] = prim[ii][0] * lin[0] + prim[ii][1] * lin[1] +
+                              prim[ii][2] * lin[2];
+                    out[ii] = transfer_from_linear(color_transfer, out[ii]);
+                }
+                rgb_to_ycc(&ycc_out, out, node);
+            }
+        }
+    }
+
+    lut->threads = MAX(1, MIN(hb_get_cpu_count(), 16));
+    lut->thread_data = calloc(lut->threads, sizeof(colorspace_thread_arg_t *));
+    if (lut->thread_data == NULL)
+    {
+        goto fail;
+    }
+    if (taskset_init(&lut->taskset, "colorspace_filter_segment", lut->threads,
+                     sizeof(colorspace_thread_arg_t), colorspace_lut_thread) == 0)
+    {
+        hb_error("colorspace could not initialize taskset");
+        free(lut->thread_data);
+        lut->thread_data = NULL;
+        goto fail;
+    }
+    for (int ii = 0; ii < lut->threads; ii++)
+    {
+        lut->thread_data[ii] = taskset_thread_args(&lut->taskset, ii);
+        lut->thread_data[ii]->lut = lut;
+        lut->thread_data[ii]->arg.taskset = &lut->taskset;
+        lut->thread_data[ii]->arg.segment = ii;
+    }
+
+    return lut;
+
+fail:
+    colorspace_lut_close(&lut);
+    return NULL;
+}
+
+static void colorspace_lut_run(hb_colorspace_lut_t * lut,
+                               hb_buffer_t * in, hb_buffer_t * out)
+{
+    for (int ii = 0; ii < lut->threads; ii++)
+    {
+        lut->thread_data[ii]->in  = in;
+        lut->thread_data[ii]->out = out;
+    }
+    taskset_cycle(&lut->taskset);
+}
+
+#define LUT_CHECK_WIDTH     128
+#define LUT_CHECK_HEIGHT    64
+#define LUT_CHECK_MAX_ERROR 1.5 // mean absolute error, in 8 bit code values
+
+static inline int lut_check_sample(const hb_buffer_t * buf, int depth,
+                                   int pp, int x, int y)
+{
+    const uint8_t * row = buf->plane[pp].data + y * buf->plane[pp].stride;
+    return depth > 8 ? ((const uint16_t *)row)[x] : row[x];
+}
+
+static inline void lut_check_set(hb_buffer_t * buf, int depth,
+                                 int pp, int x, int y, int v)
+{
+    uint8_t * row = buf->plane[pp].data + y * buf->plane[pp].stride;
+    if (depth > 8)
+        ((uint16_t *)row)[x] = v;
+    else
+        row[x] = v;
+}
+
+/*
+ * The LUT interpolates the conversion and approximates chroma instead
+ * of resampling it, so it is compared with the libavfilter graph it
+ * replaces before it is used.  The test frame has smooth luma and
+ * chroma ramps in its top half, and luma edges that do not line up
+ * with the chroma samples in its bottom half.
+ * Returns 0 if the LUT output is close enough to the graph output.
+ */
+static int colorspace_lut_check(hb_colorspace_lut_t * lut,
+                                hb_value_t * avfilters,
+                                const hb_filter_init_t * init)
+{
+    hb_filter_init_t      graph_init = *init;
+    hb_avfilter_graph_t * graph;
+    hb_buffer_t         * in, * lut_out, * graph_out = NULL;
+    int                   depth = lut->depth, scale = 1 << (depth - 8);
+    int                   y_lo, y_hi, c_lo, c_hi, result = -1;
+
+    if (init->color_range == AVCOL_RANGE_JPEG)
+    {
+        y_lo = 0;
+        y_hi = lut->max;
+    }
+    else
+    {
+        y_lo = 16 * scale;
+        y_hi = 235 * scale;
+    }
+    // Moderately saturated colors, so that clipping of out of gamut
+    // colors does not dominate the comparison
+    c_lo = (128 - 48) * scale;
+    c_hi = (128 + 48) * scale;
+
+    in      = hb_frame_buffer_init(init->pix_fmt, LUT_CHECK_WIDTH, LUT_CHECK_HEIGHT);
+    lut_out = hb_frame_buffer_init(init->pix_fmt, LUT_CHECK_WIDTH, LUT_CHECK_HEIGHT);
+    if (in == NULL || lut_out == NULL)
+    {
+        goto done;
+    }
+    in->f.color_prim      = init->color_prim;
+    in->f.color_transfer  = init->color_transfer;
+    in->f.color_matrix    = init->color_matrix;
+    in->f.color_range     = init->color_range;
+    in->f.chroma_location = init->chroma_location;
+
+    for (int y = 0; y < in->plane[0].height; y++)
+    {
+        for (int x = 0; x < in->plane[0].width; x++)
+        {
+            int v;
+            if (y < in->plane[0].height / 2)
+                v = y_lo + (y_hi - y_lo) * x / (in->plane[0].width - 1);
+            else
+                v = (x / 3) & 1 ? y_hi - (y_hi - y_lo) / 4 : y_lo + (y_hi - y_lo) / 4;
+            lut_check_set(in, depth, 0, x, y, v);
+        }
+    }
+    for (int y = 0; y < in->plane[1].height; y++)
+    {
+        for (int x = 0; x < in->plane[1].width; x++)
+        {
+            lut_check_set(in, depth, 1, x, y,
+                          c_lo + (c_hi - c_lo) * x / (in->plane[1].width - 1));
+            lut_check_set(in, depth, 2, x, y,
+                          c_lo + (c_hi - c_lo) * y / (in->plane[2].height - 1));
+        }
+    }
+
+    colorspace_lut_run(lut, in, lut_out);
+
+    graph_init.geometry.width   = LUT_CHECK_WIDTH;
+    graph_init.geometry.height  = LUT_CHECK_HEIGHT;
+    graph_init.geometry.par.num = 1;
+    graph_init.geometry.par.den = 1;
+    graph = hb_avfilter_graph_init(avfilters, &graph_init);
+    if (graph == NULL)
+    {
+        goto done;
+    }
+    hb_avfilter_add_buf(graph, &in);
+    hb_avfilter_add_buf(graph, NULL);
+    graph_out = hb_avfilter_get_buf(graph);
+    hb_avfilter_graph_close(&graph);
+
+    if (graph_out == NULL || graph_out->f.fmt != init->pix_fmt ||
+        graph_out->f.width  != LUT_CHECK_WIDTH ||
+        graph_out->f.height != LUT_CHECK_HEIGHT)
+    {
+        goto done;
+    }
+
+    result = 0;
+    for (int pp = 0; pp < 3; pp++)
+    {
+        int64_t sum = 0, count = 0;
+        double  error;
+
+        for (int y = 0; y < lut_out->plane[pp].height; y++)
+        {
+            for (int x = 0; x < lut_out->plane[pp].width; x++)
+            {
+                sum += abs(lut_check_sample(lut_out, depth, pp, x, y) -
+                           lut_check_sample(graph_out, depth, pp, x, y));
+                count++;
+            }
+        }
+        error = (double)sum / MAX(count, 1) / scale;
+        hb_deep_log(2, "colorspace: plane %d LUT mean error %.2f", pp, error);
+        if (error > LUT_CHECK_MAX_ERROR)
+        {
+            result = -1;
+        }
+    }
+
+done:
+    hb_buffer_close(&in);
+    hb_buffer_close(&lut_out);
+    hb_buffer_close(&graph_out);
+    return result;
+}
+
 static int colorspace_init(hb_filter_object_t * filter, hb_filter_init_t * init)
 {
     hb_filter_private_t * pv = NULL;
@@ -122,6 +928,12 @@ static int colorspace_init(hb_filter_object_t * filter, hb_filter_init_t * init)
         return 0;
     }
 
+    int tonemap_id = -1;
+    if (transfer && init->color_transfer != color_transfer &&
+        transfer_is_hdr(init->color_transfer))
+    {
+        tonemap_id = tonemap_from_name(tonemap);
+    }
     hb_value_array_t * avfilters = hb_value_array_init();
     hb_dict_t * avfilter   = NULL;
     hb_dict_t * avsettings = NULL;
@@ -196,6 +1008,22 @@ static int colorspace_init(hb_filter_object_t * filter, hb_filter_init_t * init)
 
     pv->avfilters = avfilters;
 
+    pv->lut = colorspace_lut_init(init, color_prim, color_transfer,
+                                  color_matrix, color_range,
+                                  tonemap_id, param, desat, npl);
+    if (pv->lut != NULL && colorspace_lut_check(pv->lut, avfilters, init) < 0)
+    {
+        hb_log("colorspace: LUT does not match libavfilter, "
+               "using libavfilter instead");
+        colorspace_lut_close(&pv->lut);
+    }
+    if (pv->lut != NULL)
+    {
+        // Converted natively, not an avfilter alias
+        hb_value_free(&pv->avfilters);
+        filter->skip = 0;
+    }
+
     init->color_prim = color_prim;
     init->color_transfer = color_transfer;
     init->color_matrix = color_matrix;
@@ -205,3 +1033,61 @@ static int colorspace_init(hb_filter_object_t * filter, hb_filter_init_t * init)
 
     return 0;
 }
+
+static int colorspace_work(hb_filter_object_t * filter,
+                           hb_buffer_t ** buf_in, hb_buffer_t ** buf_out)
+{
+    hb_filter_private_t * pv = filter->private_data;
+    hb_colorspace_lut_t * lut = pv->lut;
+    hb_buffer_t         * in = *buf_in, * out;
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        *buf_out = in;
+        *buf_in = NULL;
+        return HB_FILTER_DONE;
+    }
+
+    // The LUT and its slices are set up for the input format
+    if (in->f.fmt != pv->input.pix_fmt)
+    {
+        hb_error("colorspace: %s frame, expected %s",
+                 av_get_pix_fmt_name(in->f.fmt),
+                 av_get_pix_fmt_name(pv->input.pix_fmt));
+        return HB_FILTER_FAILED;
+    }
+
+    out = hb_frame_buffer_init(pv->output.pix_fmt, in->f.width, in->f.height);
+    if (out == NULL)
+    {
+        return HB_FILTER_FAILED;
+    }
+    hb_buffer_copy_props(out, in);
+    out->f.color_prim      = pv->output.color_prim;
+    out->f.color_transfer  = pv->output.color_transfer;
+    out->f.color_matrix    = pv->output.color_matrix;
+    out->f.color_range     = pv->output.color_range;
+    out->f.chroma_location = in->f.chroma_location;
+    if (lut->tonemap >= 0)
+    {
+        hb_buffer_remove_side_data(out, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+        hb_buffer_remove_side_data(out, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+    }
+
+    colorspace_lut_run(lut, in, out);
+
+    *buf_out = out;
+
+    return HB_FILTER_OK;
+}
+
+static void colorspace_close(hb_filter_object_t * filter)
+{
+    hb_filter_private_t * pv = filter->private_data;
+
+    if (pv != NULL)
+    {
+        colorspace_lut_close(&pv->lut);
+    }
+    hb_avfilter_alias_close(filter);
+}
@@ -0,0 +1,542 @@
+/* complexity.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/*
+ * Quick complexity analysis for single pass average bitrate encodes.
+ *
+ * Instead of a full analysis pass, a few frames are decoded at evenly
+ * spaced points of the encoded range, and measured on a heavily
+ * subsampled luma grid. The resulting complexity curve is turned into
+ * rate control zones, so that the encoder moves bits from the easy
+ * parts of the title to the hard ones while keeping the average bitrate.
+ *
+ * Zones are given in output frame numbers, which only map linearly to
+ * source time for constant frame rate output.
+ */
+
+#include "handbrake/handbrake.h"
+#include "handbrake/hbffmpeg.h"
+#include "libavutil/intreadwrite.h"
+
+#define COMPLEXITY_SAMPLE_PERIOD    (10 * 90000) // one sample per 10 seconds
+#define COMPLEXITY_MIN_SAMPLES      16
+#define COMPLEXITY_MAX_SAMPLES      240
+#define COMPLEXITY_PACKET_LIMIT     2000 // packets read to get 2 frames
+#define COMPLEXITY_STEP             8    // luma subsampling
+#define COMPLEXITY_QCOMP            0.6  // same as x264 and x265 defaults
+#define COMPLEXITY_MIN_FACTOR       0.5
+#define COMPLEXITY_MAX_FACTOR       2.0
+
+typedef struct
+{
+    hb_job_t         * job;
+    hb_title_t       * title;
+
+    hb_bd_t          * bd;
+    hb_dvd_t         * dvd;
+    hb_stream_t      * stream;
+    hb_work_object_t * decoder;
+} complexity_t;
+
+typedef struct
+{
+    int64_t start;      // 90 kHz, relative to the start of the title
+    double  complexity;
+    double  factor;
+} complexity_sample_t;
+
+static int64_t chapter_end_pts( hb_title_t * title, int chapter_end )
+{
+    hb_chapter_t * chapter;
+    int64_t        duration = 0;
+    int            ii;
+
+    for (ii = 0; ii < chapter_end; ii++)
+    {
+        chapter = hb_list_item(title->list_chapter, ii);
+        duration += chapter->duration;
+    }
+    return duration;
+}
+
+static void complexity_range( hb_job_t * job, int64_t * start, int64_t * stop )
+{
+    hb_title_t * title = job->title;
+
+    if (job->pts_to_start || job->pts_to_stop)
+    {
+        *start = job->pts_to_start;
+        *stop  = job->pts_to_stop > 0 ? *start + job->pts_to_stop :
+                                        title->duration;
+    }
+    else if (job->frame_to_start || job->frame_to_stop)
+    {
+        *start = (int64_t)job->frame_to_start * title->vrate.den * 90000 /
+                                                title->vrate.num;
+        *stop  = job->frame_to_stop > 0 ?
+                 *start + (int64_t)job->frame_to_stop * title->vrate.den *
+                                   90000 / title->vrate.num :
+                 title->duration;
+    }
+    else
+    {
+        *start = chapter_end_pts(title, job->chapter_start - 1);
+        *stop  = chapter_end_pts(title, job->chapter_end);
+    }
+    if (*stop <= 0 || *stop > title->duration)
+    {
+        *stop = title->duration;
+    }
+}
+
+static void complexity_close( complexity_t * c )
+{
+    if (c->decoder != NULL)
+    {
+        c->decoder->close(c->decoder);
+        free(c->decoder);
+        c->decoder = NULL;
+    }
+    hb_bd_close(&c->bd);
+    hb_dvd_close(&c->dvd);
+    hb_stream_close(&c->stream);
+}
+
+static int complexity_open( complexity_t * c )
+{
+    hb_title_t * title = c->title;
+
+    if (title->type == HB_BD_TYPE)
+    {
+        c->bd = hb_bd_init(c->job->h, title->path,
+                           c->job->keep_duplicate_titles);
+        if (c->bd == NULL || !hb_bd_start(c->bd, title))
+        {
+            return 1;
+        }
+        if (c->job->angle > 1)
+        {
+            hb_bd_set_angle(c->bd, c->job->angle - 1);
+        }
+    }
+    else if (title->type == HB_DVD_TYPE)
+    {
+        c->dvd = hb_dvd_init(c->job->h, title->path);
+        if (c->dvd == NULL || !hb_dvd_start(c->dvd, title, 1))
+        {
+            return 1;
+        }
+        if (c->job->angle)
+        {
+            hb_dvd_set_angle(c->dvd, c->job->angle);
+        }
+    }
+    else if (title->type == HB_STREAM_TYPE ||
+             title->type == HB_FF_STREAM_TYPE)
+    {
+        c->stream = hb_stream_open(c->job->h, title->path, title, 0);
+        if (c->stream == NULL)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        return 1;
+    }
+
+    // Software decoding in scan mode, only the luma plane is looked at
+    c->decoder = hb_get_work(c->job->h, title->video_codec);
+    if (c->decoder == NULL)
+    {
+        return 1;
+    }
+    c->decoder->codec_param = title->video_codec_param;
+    c->decoder->title       = title;
+    if (c->decoder->init(c->decoder, NULL))
+    {
+        free(c->decoder);
+        c->decoder = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+static int complexity_seek( complexity_t * c, int64_t pts )
+{
+    float frac = (float)pts / c->title->duration;
+
+    if (c->bd != NULL)
+    {
+        return hb_bd_seek_pts(c->bd, pts);
+    }
+    else if (c->dvd != NULL)
+    {
+        return hb_dvd_seek(c->dvd, frac);
+    }
+    else if (hb_stream_seek_ts(c->stream, pts) >= 0)
+    {
+        return 1;
+    }
+    // TS and PS streams have no index, seek to a byte position instead
+    if (!hb_stream_seek(c->stream, frac))
+    {
+        return 0;
+    }
+    hb_stream_set_need_keyframe(c->stream, 1);
+    return 1;
+}
+
+static hb_buffer_t * complexity_read( complexity_t * c )
+{
+    if (c->bd != NULL)
+    {
+        return hb_bd_read(c->bd);
+    }
+    else if (c->dvd != NULL)
+    {
+        return hb_dvd_read(c->dvd);
+    }
+    return hb_stream_read(c->stream);
+}
+
+/*
+ * Decodes the first 2 frames found after the seek point
+ */
+static int complexity_decode( complexity_t * c, hb_buffer_list_t * frames )
+{
+    hb_buffer_list_t   list_es;
+    hb_buffer_t      * buf, * buf_es, * out;
+    int                packets = 0;
+
+    hb_buffer_list_clear(&list_es);
+    if (c->decoder->flush != NULL)
+    {
+        c->decoder->flush(c->decoder);
+    }
+
+    while (hb_buffer_list_count(frames) < 2 &&
+           packets++ < COMPLEXITY_PACKET_LIMIT && !*c->job->die)
+    {
+        if ((buf = complexity_read(c)) == NULL)
+        {
+            break;
+        }
+        if (buf->size <= 0)
+        {
+            hb_buffer_close(&buf);
+            continue;
+        }
+
+        (hb_demux[c->title->demuxer])(buf, &list_es, 0);
+
+        while ((buf_es = hb_buffer_list_rem_head(&list_es)) != NULL)
+        {
+            if (buf_es->s.id == c->title->video_id &&
+                hb_buffer_list_count(frames) < 2)
+            {
+                out = NULL;
+                c->decoder->work(c->decoder, &buf_es, &out);
+                hb_buffer_list_append(frames, out);
+            }
+            hb_buffer_close(&buf_es);
+        }
+    }
+    hb_buffer_list_close(&list_es);
+
+    return hb_buffer_list_count(frames) >= 2;
+}
+
+typedef struct
+{
+    int step;
+    int offset;
+    int shift;
+    int depth;
+} luma_layout_t;
+
+static inline int luma_sample( const uint8_t * row, int x,
+                               const luma_layout_t * l )
+{
+    const uint8_t * p = row + x * l->step + l->offset;
+
+    if (l->depth > 8)
+    {
+        // High bit depth samples are scaled to 8 bits
+        return (AV_RN16(p) >> l->shift) >> (l->depth - 8);
+    }
+    return *p >> l->shift;
+}
+
+/*
+ * Complexity of a sample: the mean temporal difference between two
+ * consecutive frames, which is what inter frames have to code, plus
+ * a share of the spatial detail, which drives the cost of intra frames.
+ * Both are measured on a COMPLEXITY_STEP subsampled luma grid.
+ */
+static double complexity_measure( hb_buffer_t * a, hb_buffer_t * b )
+{
+    const AVPixFmtDescriptor * desc = av_pix_fmt_desc_get(a->f.fmt);
+    luma_layout_t              l;
+    int                        x, y;
+    uint64_t                   spatial = 0, temporal = 0, count = 0;
+
+    if (desc == NULL || (desc->flags & AV_PIX_FMT_FLAG_RGB) ||
+        (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) ||
+        a->f.fmt != b->f.fmt ||
+        a->f.width != b->f.width || a->f.height != b->f.height)
+    {
+        return -1;
+    }
+    l.step   = desc->comp[0].step;
+    l.offset = desc->comp[0].offset;
+    l.shift  = desc->comp[0].shift;
+    l.depth  = desc->comp[0].depth;
+
+    for (y = 0; y + COMPLEXITY_STEP < a->f.height; y += COMPLEXITY_STEP)
+    {
+        const uint8_t * ra = a->plane[0].data + y * a->plane[0].stride;
+        const uint8_t * rb = b->plane[0].data + y * b->plane[0].stride;
+        const uint8_t * rn = ra + COMPLEXITY_STEP * a->plane[0].stride;
+
+        for (x = 0; x + COMPLEXITY_STEP < a->f.width; x += COMPLEXITY_STEP)
+        {
+            int pa = luma_sample(ra, x, &l);
+
+            spatial  += abs(luma_sample(ra, x + COMPLEXITY_STEP, &l) - pa) +
+                        abs(luma_sample(rn, x, &l) - pa);
+            temporal += abs(luma_sample(rb, x, &l) - pa);
+            count++;
+        }
+    }
+    if (count == 0)
+    {
+        return -1;
+    }
+    // +1 keeps static black frames from getting no bits at all
+    return (temporal + spatial / 8.0) / count + 1.0;
+}
+
+/*
+ * Converts the complexity curve to per sample bitrate factors.
+ * Like the 2-pass rate control of x264 and x265, bits are spent
+ * in proportion to complexity^qcomp, and the duration weighted
+ * average factor is kept at 1.
+ */
+static void complexity_factors( complexity_sample_t * samples, int count,
+                                int64_t stop )
+{
+    double sum = 0, weight = 0;
+    int    ii, pass;
+
+    for (ii = 0; ii < count; ii++)
+    {
+        samples[ii].factor = pow(samples[ii].complexity, COMPLEXITY_QCOMP);
+    }
+    // Normalize, clamp, and normalize again to absorb the clamping
+    for (pass = 0; pass < 2; pass++)
+    {
+        sum = weight = 0;
+        for (ii = 0; ii < count; ii++)
+        {
+            int64_t end = ii + 1 < count ? samples[ii + 1].start : stop;
+            sum    += samples[ii].factor * (end - samples[ii].start);
+            weight += end - samples[ii].start;
+        }
+        for (ii = 0; ii < count && sum > 0; ii++)
+        {
+            samples[ii].factor = samples[ii].factor * weight / sum;
+            if (pass == 0)
+            {
+                samples[ii].factor = MAX(COMPLEXITY_MIN_FACTOR,
+                                     MIN(COMPLEXITY_MAX_FACTOR,
+                                         samples[ii].factor));
+            }
+        }
+    }
+}
+
+/*
+ * Formats the zones in the "start,end,b=factor/..." syntax understood
+ * by both x264 and x265. Zone boundaries are output frame numbers,
+ * job->vrate is the exact output rate since the output is CFR.
+ */
+static char * complexity_zones_string( hb_job_t * job,
+                                       complexity_sample_t * samples,
+                                       int count, int64_t start, int64_t stop )
+{
+    char    * zones = NULL, * tmp;
+    int       ii, last, first_frame, end_frame, nzones = 0;
+    int64_t   end, frame_den = (int64_t)job->vrate.den * 90000;
+    double    factor;
+
+    for (ii = 0; ii < count; ii = last)
+    {
+        // Merge neighbours that round to the same factor
+        factor = floor(samples[ii].factor * 100 + 0.5) / 100;
+        last   = ii + 1;
+        while (last < count &&
+               floor(samples[last].factor * 100 + 0.5) / 100 == factor)
+        {
+            last++;
+        }
+        if (factor == 1.0)
+        {
+            continue;
+        }
+
+        end         = last < count ? samples[last].start : stop;
+        first_frame = (samples[ii].start - start) * job->vrate.num / frame_den;
+        end_frame   = (end - start) * job->vrate.num / frame_den - 1;
+        if (end_frame < first_frame)
+        {
+            continue;
+        }
+
+        tmp = hb_strdup_printf("%s%s%d,%d,b=%.2f", zones ? zones : "",
+                               zones ? "/" : "", first_frame, end_frame, factor);
+        free(zones);
+        zones = tmp;
+        if (zones == NULL)
+        {
+            return NULL;
+        }
+        nzones++;
+    }
+    hb_log("complexity: %d rate control zones", nzones);
+    return zones;
+}
+
+/*
+ * The analysis runs before the encode starts, report it as the
+ * beginning of the encode so that the job does not look stalled.
+ */
+static void complexity_update_state( hb_job_t * job, int done, int count,
+                                     uint64_t date )
+{
+    hb_state_t state;
+    uint64_t   now = hb_get_date();
+
+    hb_get_state2(job->h, &state);
+    state.state = HB_STATE_WORKING;
+
+#define p state.param.working
+    p.progress = (float)done / count;
+    p.rate_cur = 0;
+    p.rate_avg = 0;
+    if (done > 0 && now > date)
+    {
+        int eta = (now - date) * (count - done) / done / 1000;
+        p.eta_seconds = eta;
+        p.hours       = eta / 3600;
+        p.minutes     = (eta % 3600) / 60;
+        p.seconds     = eta % 60;
+    }
+    else
+    {
+        p.eta_seconds = 0;
+        p.hours       = -1;
+        p.minutes     = -1;
+        p.seconds     = -1;
+    }
+#undef p
+
+    hb_set_state(job->h, &state);
+}
+
+/*
+ * Returns the rate control zones for a single pass average bitrate
+ * encode of the job, or NULL if the title could not be analyzed.
+ * The string must be freed by the caller.
+ */
+char * hb_complexity_zones( hb_job_t * job )
+{
+    complexity_t          c = { .job = job, .title = job->title };
+    complexity_sample_t * samples;
+    hb_buffer_list_t      frames;
+    int64_t               start, stop, pts;
+    int                   ii, count, nsamples = 0;
+    uint64_t              date = hb_get_date();
+    char                * zones = NULL;
+
+    if (job->cfr != 1)
+    {
+        hb_log("complexity: variable frame rate output, analysis skipped");
+        return NULL;
+    }
+    complexity_range(job, &start, &stop);
+    if (stop <= start || job->vrate.num <= 0 || job->vrate.den <= 0)
+    {
+        return NULL;
+    }
+    count = (stop - start) / COMPLEXITY_SAMPLE_PERIOD;
+    count = MAX(COMPLEXITY_MIN_SAMPLES, MIN(COMPLEXITY_MAX_SAMPLES, count));
+
+    samples = calloc(count, sizeof(complexity_sample_t));
+    if (samples == NULL)
+    {
+        return NULL;
+    }
+    if (complexity_open(&c))
+    {
+        hb_log("complexity: can't open the source, analysis skipped");
+        complexity_close(&c);
+        free(samples);
+        return NULL;
+    }
+
+    hb_buffer_list_clear(&frames);
+    for (ii = 0; ii < count && !*job->die; ii++)
+    {
+        double complexity;
+
+        complexity_update_state(job, ii, count, date);
+        pts = start + (stop - start) * ii / count;
+        if (!complexity_seek(&c, pts + (stop - start) / (2 * count)) ||
+            !complexity_decode(&c, &frames))
+        {
+            hb_buffer_list_close(&frames);
+            continue;
+        }
+        complexity = complexity_measure(hb_buffer_list_head(&frames),
+                                        hb_buffer_list_head(&frames)->next);
+        hb_buffer_list_close(&frames);
+        if (complexity < 0)
+        {
+            continue;
+        }
+        samples[nsamples].start      = pts;
+        samples[nsamples].complexity = complexity;
+        nsamples++;
+    }
+    complexity_close(&c);
+
+    if (*job->die)
+    {
+        free(samples);
+        return NULL;
+    }
+    if (nsamples < COMPLEXITY_MIN_SAMPLES / 2)
+    {
+        hb_log("complexity: only %d of %d samples decoded, analysis skipped",
+               nsamples, count);
+        free(samples);
+        return NULL;
+    }
+    // Samples that failed to decode are covered by the previous one
+    samples[0].start = start;
+
+    complexity_factors(samples, nsamples, stop);
+    zones = complexity_zones_string(job, samples, nsamples, start, stop);
+    free(samples);
+
+    hb_log("complexity: %d samples analyzed in %.1f s", nsamples,
+           (hb_get_date() - date) / 1000.);
+    return zones;
+}
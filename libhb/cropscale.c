@@ -16,6 +16,8 @@
 
 static int crop_scale_init(hb_filter_object_t * filter,
                            hb_filter_init_t * init);
+static int crop_scale_work(hb_filter_object_t * filter,
+                           hb_buffer_t ** buf_in, hb_buffer_t ** buf_out);
 static hb_filter_info_t * crop_scale_info( hb_filter_object_t * filter );
 
 static const char crop_scale_template[] =
@@ -32,7 +34,7 @@ hb_filter_object_t hb_filter_crop_scale =
     .short_name        = "cropscale",
     .settings          = NULL,
     .init              = crop_scale_init,
-    .work              = hb_avfilter_null_work,
+    .work              = crop_scale_work,
     .close             = hb_avfilter_alias_close,
     .info              = crop_scale_info,
     .settings_template = crop_scale_template,
@@ -48,7 +50,27 @@ hb_filter_object_t hb_filter_crop_scale =
  *  crop-left   - left crop margin
  *  crop-right  - right crop margin
  *
+ * When only cropping is requested on software frames, the filter is not
+ * an avfilter alias.  It crops by offsetting the plane pointers of the
+ * frame instead, and is run as a regular filter.  Aliases before and
+ * after it are combined into separate graphs, see hb_avfilter_combine().
  */
+
+// Pointer based cropping needs offsets on the chroma grid
+static int crop_native_supported(hb_filter_init_t * init, int top, int left)
+{
+    const AVPixFmtDescriptor * desc = av_pix_fmt_desc_get(init->pix_fmt);
+
+    if (init->hw_pix_fmt != AV_PIX_FMT_NONE || desc == NULL ||
+        (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                        AV_PIX_FMT_FLAG_PAL)))
+    {
+        return 0;
+    }
+    return (left & ((1 << desc->log2_chroma_w) - 1)) == 0 &&
+           (top  & ((1 << desc->log2_chroma_h) - 1)) == 0;
+}
+
 static int crop_scale_init(hb_filter_object_t * filter, hb_filter_init_t * init)
 {
     hb_filter_private_t * pv = NULL;
@@ -74,6 +96,21 @@ static int crop_scale_init(hb_filter_object_t * filter, hb_filter_init_t * init)
     hb_dict_extract_int(&right, settings, "crop-right");
     cropped_width  = init->geometry.width - left - right;
     cropped_height = init->geometry.height - top - bottom;
+
+    width  = cropped_width;
+    height = cropped_height;
+    hb_dict_extract_int(&width, settings, "width");
+    hb_dict_extract_int(&height, settings, "height");
+
+    if (width == cropped_width && height == cropped_height &&
+        crop_native_supported(init, top, left))
+    {
+        // No scaling, crop without a libavfilter graph
+        hb_value_free(&avfilters);
+        filter->skip = 0;
+        goto done;
+    }
+
     if (top > 0 || bottom > 0 || left > 0 || right > 0)
     {
         hb_dict_t * avfilter   = hb_dict_init();
@@ -87,13 +124,7 @@ static int crop_scale_init(hb_filter_object_t * filter, hb_filter_init_t * init)
         hb_value_array_append(avfilters, avfilter);
     }
 
-    width  = cropped_width;
-    height = cropped_height;
-
     // Convert scale settings to 'scale' avfilter
-    hb_dict_extract_int(&width, settings, "width");
-    hb_dict_extract_int(&height, settings, "height");
-
     hb_dict_t * avfilter   = hb_dict_init();
     hb_dict_t * avsettings = hb_dict_init();
 
@@ -167,6 +198,7 @@ static int crop_scale_init(hb_filter_object_t * filter, hb_filter_init_t * init)
     
     hb_value_array_append(avfilters, avfilter);
 
+done:
     init->crop[0] = top;
     init->crop[1] = bottom;
     init->crop[2] = left;
@@ -184,6 +216,55 @@ static int crop_scale_init(hb_filter_object_t * filter, hb_filter_init_t * init)
     return 0;
 }
 
+static int crop_scale_work(hb_filter_object_t * filter,
+                           hb_buffer_t ** buf_in, hb_buffer_t ** buf_out)
+{
+    hb_filter_private_t * pv = filter->private_data;
+    hb_buffer_t         * in = *buf_in, * out;
+    hb_buffer_settings_t  s;
+    AVFrame             * frame;
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        *buf_out = in;
+        *buf_in = NULL;
+        return HB_FILTER_DONE;
+    }
+
+    frame = av_frame_alloc();
+    if (frame == NULL)
+    {
+        hb_error("crop_scale_work: allocation failure");
+        return HB_FILTER_FAILED;
+    }
+
+    // Wrap the buffer in a refcounted frame and move its data pointers
+    // to the cropped window.  No picture data is copied.
+    s = in->s;
+    hb_video_buffer_to_avframe(frame, buf_in);
+    frame->crop_top    = pv->output.crop[0];
+    frame->crop_bottom = pv->output.crop[1];
+    frame->crop_left   = pv->output.crop[2];
+    frame->crop_right  = pv->output.crop[3];
+    if (av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED) < 0)
+    {
+        hb_error("crop_scale_work: failed to crop frame");
+        av_frame_free(&frame);
+        return HB_FILTER_FAILED;
+    }
+
+    out = hb_avframe_to_video_buffer(frame, (AVRational){1, 90000});
+    av_frame_free(&frame);
+    if (out == NULL)
+    {
+        return HB_FILTER_FAILED;
+    }
+    out->s = s;
+
+    *buf_out = out;
+    return HB_FILTER_OK;
+}
+
 static hb_filter_info_t * crop_scale_info( hb_filter_object_t * filter )
 {
     hb_filter_private_t * pv = filter->private_data;
@@ -84,6 +84,8 @@ typedef struct
     int                    scr_sequence;
     int                    new_chap;
     int                    discard;
+    double                 duration; // 90KHz ticks, 0 if unknown
+    AVBufferRef          * ref;   // Borrowed from the input buffer, may be NULL
 } packet_info_t;
 
 typedef struct reordered_data_s reordered_data_t;
@@ -99,6 +101,18 @@ struct reordered_data_s
 #define REORDERED_HASH_SZ   (2 << 7)
 #define REORDERED_HASH_MASK (REORDERED_HASH_SZ - 1)
 
+/*
+ * Additional output of a shared audio decoder. Each output resamples
+ * the decoded audio to its own mixdown and is pushed directly to the
+ * raw audio fifo of its track.
+ */
+typedef struct
+{
+    hb_audio_t          * audio;
+    hb_audio_resample_t * resample;
+    int                   drop_samples;
+} audio_output_t;
+
 struct video_filters_s
 {
     hb_avfilter_graph_t * graph;
@@ -120,6 +134,7 @@ struct hb_work_private_s
     AVPacket             * pkt;
     hb_buffer_t          * palette;
     int                    threads;
+    int                    fast_scan;
     int                    video_codec_opened;
     hb_buffer_list_t       list;
     double                 duration;        // frame duration (for video)
@@ -143,6 +158,8 @@ struct hb_work_private_s
     hb_audio_resample_t  * resample;
     int                    drop_samples;
     uint64_t               downmix_mask;
+    hb_list_t            * list_output;
+    uint32_t               passthru_frames;  // passed through undecoded
 
     AVFrame              * hw_frame;
     enum AVPixelFormat     hw_pix_fmt;
@@ -152,6 +169,21 @@ struct hb_work_private_s
 
 static void decodeAudio( hb_work_private_t *pv, packet_info_t * packet_info );
 
+// Returns the libav reference backing data when data is the whole
+// payload of a packet wrapping input buffer, NULL otherwise.
+// Partial payloads are left to libav to copy since the decoders
+// expect zero padding after the data.
+static AVBufferRef * packet_data_ref(const hb_buffer_t *in,
+                                     const uint8_t *data, int size)
+{
+    if (in->storage_type == AVPACKET &&
+        data == in->data && size == in->size)
+    {
+        return ((AVPacket *)in->storage)->buf;
+    }
+    return NULL;
+}
+
 #define HB_AV_CH_SIDE_MASK (AV_CH_SIDE_LEFT|AV_CH_SIDE_RIGHT)
 #define HB_AV_CH_BACK_MASK (AV_CH_BACK_LEFT|AV_CH_BACK_RIGHT)
 #define HB_AV_CH_BOTH_MASK (HB_AV_CH_SIDE_MASK|HB_AV_CH_BACK_MASK)
@@ -359,6 +391,32 @@ static char* channel_layout_name_from_mask(uint64_t mask, char *buf, size_t size
     return NULL;
 }
 
+static uint64_t decoder_downmix_mask(int codec_param, hb_audio_t *audio,
+                                     const char **dmix_mode)
+{
+    switch (codec_param)
+    {
+        case AV_CODEC_ID_AC3:
+        case AV_CODEC_ID_EAC3:
+            return ac3_downmix_mask(audio->config.out.mixdown,
+                                    audio->config.out.normalize_mix_level,
+                                    audio->config.in.ch_layout, dmix_mode);
+
+        case AV_CODEC_ID_DTS:
+            return dca_downmix_mask(audio->config.out.mixdown,
+                                    audio->config.out.normalize_mix_level,
+                                    audio->config.in.ch_layout);
+
+        case AV_CODEC_ID_TRUEHD:
+            return truehd_downmix_mask(audio->config.out.mixdown,
+                                       audio->config.out.normalize_mix_level,
+                                       audio->config.in.ch_layout);
+
+        default:
+            return 0;
+    }
+}
+
 /***********************************************************************
  * hb_work_decavcodec_init
  ***********************************************************************
@@ -425,6 +483,35 @@ static int decavcodecaInit( hb_work_object_t * w, hb_job_t * job )
             return 1;
         }
 
+        // Other tracks sharing this decoder
+        for (int ii = 0; ii < hb_list_count(w->list_audio); ii++)
+        {
+            audio_output_t *output = calloc(1, sizeof(audio_output_t));
+            if (output == NULL)
+            {
+                hb_error("decavcodecaInit: output allocation failed");
+                return 1;
+            }
+            if (pv->list_output == NULL)
+            {
+                pv->list_output = hb_list_init();
+            }
+            hb_list_add(pv->list_output, output);
+
+            output->audio        = hb_list_item(w->list_audio, ii);
+            output->drop_samples = output->audio->config.in.encoder_delay;
+            output->resample     =
+                hb_audio_resample_init(AV_SAMPLE_FMT_FLT,
+                                       output->audio->config.in.samplerate,
+                                       output->audio->config.out.mixdown,
+                                       output->audio->config.out.normalize_mix_level);
+            if (output->resample == NULL)
+            {
+                hb_error("decavcodecaInit: hb_audio_resample_init() failed");
+                return 1;
+            }
+        }
+
         /*
          * Audio decoder downmix.
          *
@@ -437,29 +524,27 @@ static int decavcodecaInit( hb_work_object_t * w, hb_job_t * job )
         char *downmix = NULL;
         uint64_t downmix_mask = 0;
         const char *dmix_mode = NULL;
-        switch (w->codec_param)
-        {
-            case AV_CODEC_ID_AC3:
-            case AV_CODEC_ID_EAC3:
-                downmix_mask = ac3_downmix_mask(w->audio->config.out.mixdown,
-                                                w->audio->config.out.normalize_mix_level,
-                                                w->audio->config.in.ch_layout, &dmix_mode);
-                break;
-
-            case AV_CODEC_ID_DTS:
-                downmix_mask = dca_downmix_mask(w->audio->config.out.mixdown,
-                                                w->audio->config.out.normalize_mix_level,
-                                                w->audio->config.in.ch_layout);
-                break;
-
-            case AV_CODEC_ID_TRUEHD:
-                downmix_mask = truehd_downmix_mask(w->audio->config.out.mixdown,
-                                                   w->audio->config.out.normalize_mix_level,
-                                                   w->audio->config.in.ch_layout);
-                break;
-
-            default:
+        downmix_mask = decoder_downmix_mask(w->codec_param, w->audio, &dmix_mode);
+
+        // A shared decoder can only downmix if all of its outputs
+        // want the same downmix. Otherwise each output downmixes
+        // the full layout itself.
+        for (int ii = 0; ii < hb_list_count(pv->list_output); ii++)
+        {
+            audio_output_t *output = hb_list_item(pv->list_output, ii);
+            const char *output_dmix_mode = NULL;
+            uint64_t output_mask = decoder_downmix_mask(w->codec_param,
+                                                        output->audio,
+                                                        &output_dmix_mode);
+            if (output_mask != downmix_mask ||
+                (dmix_mode != output_dmix_mode &&
+                 (dmix_mode == NULL || output_dmix_mode == NULL ||
+                  strcmp(dmix_mode, output_dmix_mode))))
+            {
+                downmix_mask = 0;
+                dmix_mode    = NULL;
                 break;
+            }
         }
         if (downmix_mask)
         {
@@ -505,6 +590,11 @@ static int decavcodecaInit( hb_work_object_t * w, hb_job_t * job )
                    w->audio->config.out.track,
                    w->audio->config.out.dynamic_range_compression, drc_scale_max);
             w->audio->config.out.dynamic_range_compression = drc_scale_max;
+            for (int ii = 0; ii < hb_list_count(pv->list_output); ii++)
+            {
+                audio_output_t *output = hb_list_item(pv->list_output, ii);
+                output->audio->config.out.dynamic_range_compression = drc_scale_max;
+            }
         }
 
         char drc_scale[5]; // "?.??\n"
@@ -569,6 +659,11 @@ static void closePrivData( hb_work_private_t ** ppv )
         {
             hb_log( "%s-decoder done: %u frames, %u decoder errors",
                     pv->context->codec->name, pv->nframes, pv->decode_errors);
+            if (pv->passthru_frames > 0)
+            {
+                hb_log("%s-decoder: %u frames passed through without decoding",
+                       pv->context->codec->name, pv->passthru_frames);
+            }
         }
         av_frame_free(&pv->frame);
         av_frame_free(&pv->hw_frame);
@@ -592,6 +687,15 @@ static void closePrivData( hb_work_private_t ** ppv )
         av_packet_free(&pv->pkt);
         hb_audio_resample_free(pv->resample);
 
+        audio_output_t *output;
+        while ((output = hb_list_item(pv->list_output, 0)) != NULL)
+        {
+            hb_list_rem(pv->list_output, output);
+            hb_audio_resample_free(output->resample);
+            free(output);
+        }
+        hb_list_close(&pv->list_output);
+
         int ii;
         for (ii = 0; ii < REORDERED_HASH_SZ; ii++)
         {
@@ -616,6 +720,47 @@ static void decavcodecClose( hb_work_object_t * w )
     }
 }
 
+static int audio_samplerate(hb_work_private_t *pv)
+{
+    if (pv->context->sample_rate > 0)
+    {
+        return pv->context->sample_rate;
+    }
+    return pv->audio->config.in.samplerate;
+}
+
+// Duration of the frame the parser just returned, 0 if unknown
+static double parser_duration(hb_work_private_t *pv)
+{
+    int samplerate = audio_samplerate(pv);
+
+    if (pv->parser->duration > 0 && samplerate > 0)
+    {
+        return 90000. * pv->parser->duration / samplerate;
+    }
+    return 0;
+}
+
+// Demuxer packet duration, 0 unless it is a whole number of samples.
+// Containers with coarse timebases (e.g. 1ms in mkv) round it, and
+// passing such durations on would make sync see gaps and overlaps.
+static double packet_duration(hb_work_private_t *pv, double duration)
+{
+    int    samplerate = audio_samplerate(pv);
+    double samples;
+
+    if (duration <= 0 || samplerate <= 0)
+    {
+        return 0;
+    }
+    samples = duration * samplerate / 90000.;
+    if (fabs(samples - llrint(samples)) > 0.01)
+    {
+        return 0;
+    }
+    return 90000. * llrint(samples) / samplerate;
+}
+
 static void audioParserFlush(hb_work_object_t * w)
 {
     hb_work_private_t * pv = w->private_data;
@@ -638,6 +783,8 @@ static void audioParserFlush(hb_work_object_t * w)
             pv->packet_info.data         = pout;
             pv->packet_info.size         = pout_len;
             pv->packet_info.pts          = parser_pts;
+            pv->packet_info.duration     = parser_duration(pv);
+            pv->packet_info.ref          = NULL;
 
             decodeAudio(pv, &pv->packet_info);
         }
@@ -658,7 +805,8 @@ static int decavcodecaWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
     // libavcodec/mpeg12dec.c requires buffers to be zero padded.
     // If not zero padded, it can get stuck in an infinite loop.
     // It's likely there are other decoders that expect the same.
-    if (in->data != NULL)
+    // Buffers wrapping libav packets are already padded.
+    if (in->data != NULL && in->storage_type == STANDARD)
     {
         memset(in->data + in->size, 0, in->alloc - in->size);
     }
@@ -668,6 +816,11 @@ static int decavcodecaWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
         /* EOF on input stream - send it downstream & say that we're done */
         audioParserFlush(w);
         decodeAudio(pv, NULL);
+        for (int ii = 0; ii < hb_list_count(pv->list_output); ii++)
+        {
+            audio_output_t *output = hb_list_item(pv->list_output, ii);
+            hb_fifo_push(output->audio->priv.fifo_raw, hb_buffer_eof_init());
+        }
         hb_buffer_list_append(&pv->list, in);
         *buf_in = NULL;
         *buf_out = hb_buffer_list_clear(&pv->list);
@@ -704,6 +857,7 @@ static int decavcodecaWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
         uint8_t * pout = NULL;
         int       pout_len = 0;
         int64_t   parser_pts;
+        double    duration;
 
         if ( pv->parser != NULL )
         {
@@ -711,6 +865,7 @@ static int decavcodecaWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
                                    in->data + pos, in->size - pos,
                                    pts, pts, 0 );
             parser_pts = pv->parser->pts;
+            duration = parser_duration(pv);
             pts = AV_NOPTS_VALUE;
         }
         else
@@ -718,14 +873,18 @@ static int decavcodecaWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
             pout = in->data;
             len = pout_len = in->size;
             parser_pts = in->s.start;
+            duration = packet_duration(pv, in->s.duration);
         }
         if (pout != NULL && pout_len > 0)
         {
             pv->packet_info.data         = pout;
             pv->packet_info.size         = pout_len;
             pv->packet_info.pts          = parser_pts;
+            pv->packet_info.duration     = duration;
+            pv->packet_info.ref          = packet_data_ref(in, pout, pout_len);
 
             decodeAudio(pv, &pv->packet_info);
+            pv->packet_info.ref          = NULL;
 
             // There could have been an unfinished packet when we entered
             // decodeAudio that is now finished.  The next packet is associated
@@ -1700,6 +1859,36 @@ static void filter_video(hb_work_private_t *pv)
     }
 }
 
+// Margin for timestamp adjustments sync makes after the start point
+// was published
+#define LEAD_IN_MARGIN 90000
+
+// Sync drops the frames before the start point of a point-to-point
+// encode.  Of those, only reference frames are needed to decode the
+// frames that follow, so the decoder can skip the others.
+static int is_lead_in(hb_work_private_t * pv, packet_info_t * packet_info)
+{
+    hb_job_t * job = pv->job;
+    int64_t    start;
+    int        scr_sequence;
+
+    if (job == NULL || job->pts_to_start_lock == NULL ||
+        packet_info->pts == AV_NOPTS_VALUE || packet_info->new_chap)
+    {
+        return 0;
+    }
+    hb_lock(job->pts_to_start_lock);
+    start        = job->pts_to_start_input;
+    scr_sequence = job->pts_to_start_scr;
+    hb_unlock(job->pts_to_start_lock);
+
+    if (start == AV_NOPTS_VALUE || packet_info->scr_sequence != scr_sequence)
+    {
+        return 0;
+    }
+    return packet_info->pts < start - LEAD_IN_MARGIN;
+}
+
 /*
  * Decodes a video frame from the specified raw packet data
  *      ('data', 'size').
@@ -1726,6 +1915,11 @@ static int decodeFrame( hb_work_private_t * pv, packet_info_t * packet_info )
 
     if (packet_info != NULL)
     {
+        if (packet_info->ref != NULL)
+        {
+            // Let the decoder share the packet instead of copying it
+            avp->buf = av_buffer_ref(packet_info->ref);
+        }
         avp->data = packet_info->data;
         avp->size = packet_info->size;
         avp->pts  = pv->sequence;
@@ -1748,6 +1942,12 @@ static int decodeFrame( hb_work_private_t * pv, packet_info_t * packet_info )
             avp->flags |= AV_PKT_FLAG_KEY;
         }
         avp->flags  |= packet_info->discard * AV_PKT_FLAG_DISCARD;
+
+        if (!pv->fast_scan)
+        {
+            pv->context->skip_frame = is_lead_in(pv, packet_info) ?
+                                      AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+        }
     }
     else
     {
@@ -1826,6 +2026,17 @@ static int decodeFrame( hb_work_private_t * pv, packet_info_t * packet_info )
 }
 
 
+// Fast scan only needs keyframes for previews, crop and comb detection,
+// and can live without the in-loop filters
+static void set_fast_scan_options( hb_work_private_t * pv )
+{
+    if (pv->fast_scan)
+    {
+        pv->context->skip_frame       = AVDISCARD_NONKEY;
+        pv->context->skip_loop_filter = AVDISCARD_ALL;
+    }
+}
+
 static int decavcodecvInit( hb_work_object_t * w, hb_job_t * job )
 {
 
@@ -1838,7 +2049,10 @@ static int decavcodecvInit( hb_work_object_t * w, hb_job_t * job )
     if ( job )
         pv->title = job->title;
     else
-        pv->title = w->title;
+    {
+        pv->title     = w->title;
+        pv->fast_scan = w->fast_scan;
+    }
     if (pv->title->flags & HBTF_RAW_VIDEO)
         pv->next_pts = 0;
     hb_buffer_list_clear(&pv->list);
@@ -1868,6 +2082,7 @@ static int decavcodecvInit( hb_work_object_t * w, hb_job_t * job )
     pv->context->workaround_bugs = FF_BUG_AUTODETECT;
     pv->context->err_recognition = AV_EF_CRCCHECK;
     pv->context->error_concealment = FF_EC_GUESS_MVS|FF_EC_DEBLOCK;
+    set_fast_scan_options(pv);
 
     if (w->hw_device_ctx)
     {
@@ -2103,6 +2318,7 @@ static int decodePacket( hb_work_object_t * w )
         pv->context->workaround_bugs   = FF_BUG_AUTODETECT;
         pv->context->err_recognition   = AV_EF_CRCCHECK;
         pv->context->error_concealment = FF_EC_GUESS_MVS|FF_EC_DEBLOCK;
+        set_fast_scan_options(pv);
 
         if (w->hw_device_ctx)
         {
@@ -2167,6 +2383,7 @@ static void videoParserFlush(hb_work_object_t * w)
             pv->packet_info.size         = pout_len;
             pv->packet_info.pts          = parser_pts;
             pv->packet_info.dts          = parser_dts;
+            pv->packet_info.ref          = NULL;
 
             result = decodePacket(w);
             if (result != HB_WORK_OK)
@@ -2190,7 +2407,8 @@ static int decavcodecvWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
     // libavcodec/mpeg12dec.c requires buffers to be zero padded.
     // If not zero padded, it can get stuck in an infinite loop.
     // It's likely there are other decoders that expect the same.
-    if (in->data != NULL)
+    // Buffers wrapping libav packets are already padded.
+    if (in->data != NULL && in->storage_type == STANDARD)
     {
         memset(in->data + in->size, 0, in->alloc - in->size);
     }
@@ -2303,8 +2521,10 @@ static int decavcodecvWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
             pv->packet_info.size         = pout_len;
             pv->packet_info.pts          = parser_pts;
             pv->packet_info.dts          = parser_dts;
+            pv->packet_info.ref          = packet_data_ref(in, pout, pout_len);
 
             result = decodePacket(w);
+            pv->packet_info.ref          = NULL;
             if (result != HB_WORK_OK)
             {
                 break;
@@ -2532,6 +2752,150 @@ static void log_decoder_downmix_mismatch(uint64_t downmix_mask, uint64_t decoded
                 req ? req : "(null)", got ? got : "(null)");
 }
 
+/*
+ * Converts a decoded frame to the sample format and mixdown of 'audio',
+ * dropping any samples that are part of the encoder delay.
+ * Returns non-zero on failure.
+ */
+static int resample_frame(AVFrame *frame, hb_audio_t *audio,
+                          hb_audio_resample_t *resample, int *drop_samples,
+                          int64_t *pts, double *duration, hb_buffer_t **buf)
+{
+    AVFrameSideData *side_data;
+    AVChannelLayout  channel_layout;
+    hb_buffer_t     *out;
+
+    *buf = NULL;
+    if ((side_data =
+         av_frame_get_side_data(frame,
+                        AV_FRAME_DATA_DOWNMIX_INFO)) != NULL)
+    {
+        double          surround_mix_level, center_mix_level;
+        AVDownmixInfo * downmix_info;
+
+        downmix_info = (AVDownmixInfo*)side_data->data;
+        if (audio->config.out.mixdown == HB_AMIXDOWN_DOLBY ||
+            audio->config.out.mixdown == HB_AMIXDOWN_DOLBYPLII)
+        {
+            surround_mix_level = downmix_info->surround_mix_level_ltrt;
+            center_mix_level   = downmix_info->center_mix_level_ltrt;
+        }
+        else
+        {
+            surround_mix_level = downmix_info->surround_mix_level;
+            center_mix_level   = downmix_info->center_mix_level;
+        }
+        hb_audio_resample_set_mix_levels(resample,
+                                         surround_mix_level,
+                                         center_mix_level,
+                                         downmix_info->lfe_mix_level);
+    }
+    channel_layout = frame->ch_layout;
+    if (channel_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+    {
+        AVChannelLayout default_ch_layout;
+        av_channel_layout_default(&default_ch_layout, frame->ch_layout.nb_channels);
+        channel_layout = default_ch_layout;
+    }
+    hb_audio_resample_set_ch_layout(resample, &channel_layout);
+    hb_audio_resample_set_sample_fmt(resample, frame->format);
+    hb_audio_resample_set_sample_rate(resample, frame->sample_rate);
+    if (hb_audio_resample_update(resample))
+    {
+        hb_log("decavcodec: hb_audio_resample_update() failed");
+        return 1;
+    }
+    out = hb_audio_resample(resample,
+                            (const uint8_t **)frame->extended_data,
+                            frame->nb_samples);
+    if (out != NULL && *drop_samples > 0)
+    {
+        /* drop audio samples that are part of the encoder delay */
+        int channels = hb_mixdown_get_discrete_channel_count(
+                                        audio->config.out.mixdown);
+        int sample_size = channels * sizeof(float);
+        int samples = out->size / sample_size;
+        if (samples <= *drop_samples)
+        {
+            hb_buffer_close(&out);
+            *drop_samples -= samples;
+        }
+        else
+        {
+            int size = *drop_samples * sample_size;
+            double drop_duration = *drop_samples * 90000L /
+                                   audio->config.out.samplerate;
+            memmove(out->data, out->data + size, out->size - size);
+            out->size -= size;
+            *pts += drop_duration;
+            *duration -= drop_duration;
+            *drop_samples = 0;
+        }
+    }
+    *buf = out;
+    return 0;
+}
+
+// Passthru only needs each frame's duration, which the parser or the
+// demuxer usually know.  Frames with a known duration are passed through
+// without decoding them.  Other frames are decoded to learn their
+// duration, and dropped if they fail to decode.
+static int passthruAudio(hb_work_private_t *pv, packet_info_t *packet_info)
+{
+    AVPacket    * avp = pv->pkt;
+    hb_buffer_t * out;
+    double        duration = packet_info->duration;
+
+    if (!(duration > 0))
+    {
+        return 0;
+    }
+    if (packet_info->discard)
+    {
+        return 1;
+    }
+
+    if (packet_info->ref != NULL)
+    {
+        avp->buf  = av_buffer_ref(packet_info->ref);
+        avp->data = packet_info->data;
+        avp->size = packet_info->size;
+        out = hb_avpacket_to_buffer(avp);
+        av_packet_unref(avp);
+    }
+    else
+    {
+        out = hb_buffer_init(packet_info->size);
+        memcpy(out->data, packet_info->data, packet_info->size);
+    }
+    if (out == NULL)
+    {
+        return 1;
+    }
+
+    out->s.scr_sequence = packet_info->scr_sequence;
+    out->s.start        = packet_info->pts;
+    out->s.duration     = duration;
+    if (out->s.start == AV_NOPTS_VALUE)
+    {
+        out->s.start = pv->next_pts;
+    }
+    else
+    {
+        pv->next_pts = out->s.start;
+    }
+    if (pv->next_pts != (int64_t)AV_NOPTS_VALUE)
+    {
+        pv->next_pts += duration;
+        out->s.stop  = pv->next_pts;
+    }
+    hb_buffer_list_append(&pv->list, out);
+    ++pv->nframes;
+    ++pv->passthru_frames;
+
+    return 1;
+}
+
 static void decodeAudio(hb_work_private_t *pv, packet_info_t * packet_info)
 {
     AVCodecContext * context = pv->context;
@@ -2546,8 +2910,19 @@ static void decodeAudio(hb_work_private_t *pv, packet_info_t * packet_info)
     {
         pv->next_pts = packet_info->pts;
     }
+    if (packet_info != NULL &&
+        (pv->audio->config.out.codec & HB_ACODEC_PASS_FLAG) &&
+        passthruAudio(pv, packet_info))
+    {
+        return;
+    }
     if (packet_info != NULL)
     {
+        if (packet_info->ref != NULL)
+        {
+            // Let the decoder share the packet instead of copying it
+            avp->buf = av_buffer_ref(packet_info->ref);
+        }
         avp->data = packet_info->data;
         avp->size = packet_info->size;
         avp->pts  = packet_info->pts;
@@ -2601,86 +2976,60 @@ static void decodeAudio(hb_work_private_t *pv, packet_info_t * packet_info)
             // Note that even though we are doing passthru, we had to decode
             // so that we know the stop time and the pts of the next audio
             // packet.
-            out = hb_buffer_init(avp->size);
-            memcpy(out->data, avp->data, avp->size);
-        }
-        else
-        {
-            AVFrameSideData *side_data;
-            AVChannelLayout  channel_layout;
-            if ((side_data =
-                 av_frame_get_side_data(pv->frame,
-                                AV_FRAME_DATA_DOWNMIX_INFO)) != NULL)
+            if (avp->buf != NULL)
             {
-                double          surround_mix_level, center_mix_level;
-                AVDownmixInfo * downmix_info;
-
-                downmix_info = (AVDownmixInfo*)side_data->data;
-                if (pv->audio->config.out.mixdown == HB_AMIXDOWN_DOLBY ||
-                    pv->audio->config.out.mixdown == HB_AMIXDOWN_DOLBYPLII)
-                {
-                    surround_mix_level = downmix_info->surround_mix_level_ltrt;
-                    center_mix_level   = downmix_info->center_mix_level_ltrt;
-                }
-                else
-                {
-                    surround_mix_level = downmix_info->surround_mix_level;
-                    center_mix_level   = downmix_info->center_mix_level;
-                }
-                hb_audio_resample_set_mix_levels(pv->resample,
-                                                 surround_mix_level,
-                                                 center_mix_level,
-                                                 downmix_info->lfe_mix_level);
+                out = hb_avpacket_to_buffer(avp);
             }
-            channel_layout = pv->frame->ch_layout;
-            if (pv->downmix_mask && pv->downmix_mask != channel_layout.u.mask)
+            else
             {
-                log_decoder_downmix_mismatch(pv->downmix_mask, channel_layout.u.mask);
-                pv->downmix_mask = 0; // don't spam the log
+                out = hb_buffer_init(avp->size);
+                memcpy(out->data, avp->data, avp->size);
             }
-            if (channel_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+        }
+        else
+        {
+            if (pv->downmix_mask && pv->downmix_mask != pv->frame->ch_layout.u.mask)
             {
-                AVChannelLayout default_ch_layout;
-                av_channel_layout_default(&default_ch_layout, pv->frame->ch_layout.nb_channels);
-                channel_layout = default_ch_layout;
+                log_decoder_downmix_mismatch(pv->downmix_mask, pv->frame->ch_layout.u.mask);
+                pv->downmix_mask = 0; // don't spam the log
             }
-            hb_audio_resample_set_ch_layout(pv->resample, &channel_layout);
-            hb_audio_resample_set_sample_fmt(pv->resample,
-                                             pv->frame->format);
-            hb_audio_resample_set_sample_rate(pv->resample,
-                                             pv->frame->sample_rate);
-            if (hb_audio_resample_update(pv->resample))
+            if (resample_frame(pv->frame, pv->audio, pv->resample,
+                               &pv->drop_samples, &pts, &duration, &out))
             {
-                hb_log("decavcodec: hb_audio_resample_update() failed");
                 av_frame_unref(pv->frame);
                 av_packet_unref(avp);
                 return;
             }
-            out = hb_audio_resample(pv->resample,
-                                    (const uint8_t **)pv->frame->extended_data,
-                                    pv->frame->nb_samples);
-            if (out != NULL && pv->drop_samples > 0)
+            for (int ii = 0; ii < hb_list_count(pv->list_output); ii++)
             {
-                /* drop audio samples that are part of the encoder delay */
-                int channels = hb_mixdown_get_discrete_channel_count(
-                                                pv->audio->config.out.mixdown);
-                int sample_size = channels * sizeof(float);
-                int samples = out->size / sample_size;
-                if (samples <= pv->drop_samples)
+                audio_output_t *output = hb_list_item(pv->list_output, ii);
+                hb_buffer_t    *output_buf;
+                int64_t         output_pts = pv->frame->pts;
+                double          output_duration = pv->duration;
+
+                if (resample_frame(pv->frame, output->audio, output->resample,
+                                   &output->drop_samples, &output_pts,
+                                   &output_duration, &output_buf))
                 {
-                    hb_buffer_close(&out);
-                    pv->drop_samples -= samples;
+                    continue;
                 }
-                else
+                if (output_buf != NULL)
                 {
-                    int size = pv->drop_samples * sample_size;
-                    double drop_duration = pv->drop_samples * 90000L /
-                                           pv->audio->config.out.samplerate;
-                    memmove(out->data, out->data + size, out->size - size);
-                    out->size -= size;
-                    pts += drop_duration;
-                    duration -= drop_duration;
-                    pv->drop_samples = 0;
+                    if (packet_info != NULL)
+                    {
+                        output_buf->s.scr_sequence = packet_info->scr_sequence;
+                    }
+                    output_buf->s.start    = output_pts;
+                    output_buf->s.duration = output_duration;
+                    if (output_buf->s.start == AV_NOPTS_VALUE)
+                    {
+                        output_buf->s.start = pv->next_pts;
+                    }
+                    if (output_buf->s.start != (int64_t)AV_NOPTS_VALUE)
+                    {
+                        output_buf->s.stop = output_buf->s.start + pv->duration;
+                    }
+                    hb_fifo_push(output->audio->priv.fifo_raw, output_buf);
                 }
             }
         }
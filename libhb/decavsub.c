@@ -582,6 +582,13 @@ int decavsubWork( hb_decavsub_context_t * ctx,
             {
                 out->s.flags = HB_BUF_FLAG_EOS;
             }
+            else if (forced_sub && ctx->subtitle->search_candidate)
+            {
+                // Foreign audio search candidates are decoded with
+                // forced-only disabled. Mark forced subtitles so that
+                // decavsubForcedOnly() can filter the selected track.
+                out->s.flags |= HB_FLAG_FORCED_SUB;
+            }
         }
         else
         {
@@ -695,6 +702,48 @@ int decavsubWork( hb_decavsub_context_t * ctx,
     return HB_WORK_OK;
 }
 
+/***********************************************************************
+ * decavsubForcedOnly
+ ***********************************************************************
+ * Reduces passthru subtitles, as output by sync, to the forced
+ * subtitles.  This applies the same rules as the forced-only decoding
+ * above, to subtitles that were decoded with forced-only disabled and
+ * marked with HB_FLAG_FORCED_SUB.  Called for each subtitle in order,
+ * seen_forced_sub keeps the state between calls and starts at 0.
+ * Returns buf, or NULL if it was dropped.
+ **********************************************************************/
+hb_buffer_t * decavsubForcedOnly( hb_buffer_t * buf, int source,
+                                  int * seen_forced_sub )
+{
+    if (buf->s.flags & HB_FLAG_FORCED_SUB)
+    {
+        *seen_forced_sub = 1;
+    }
+    else if (buf->s.flags & HB_BUF_FLAG_EOS)
+    {
+        // Terminates the last forced sub
+        if (!*seen_forced_sub)
+        {
+            hb_buffer_close(&buf);
+        }
+        *seen_forced_sub = 0;
+    }
+    else if (*seen_forced_sub && source == PGSSUB)
+    {
+        // Neither forced nor empty, but it replaces the last
+        // forced sub on screen.  Replace it with an empty sub.
+        make_empty_pgs(buf);
+        *seen_forced_sub = 0;
+    }
+    else
+    {
+        // VOBSUB stop times have already been set by sync
+        *seen_forced_sub = 0;
+        hb_buffer_close(&buf);
+    }
+    return buf;
+}
+
 static int decsubWork( hb_work_object_t * w,
                        hb_buffer_t ** buf_in,
                        hb_buffer_t ** buf_out )
@@ -562,6 +562,15 @@ int encx264Init( hb_work_object_t * w, hb_job_t * job )
                 param.rc.psz_stat_in  = pv->filename;
                 break;
         }
+        /* Zones from the complexity analysis, unless set by the user */
+        if (job->rc_zones != NULL && job->pass_id == HB_PASS_ENCODE &&
+            param.rc.psz_zones == NULL && param.rc.i_zones == 0)
+        {
+            if (pv->api->param_parse(&param, "zones", job->rc_zones) < 0)
+            {
+                hb_log( "encx264: invalid rate control zones, ignored" );
+            }
+        }
     }
 
     switch (job->output_pix_fmt)
@@ -458,6 +458,14 @@ int encx265Init(hb_work_object_t *w, hb_job_t *job)
                 }
             }
         }
+        /* Zones from the complexity analysis, unless set by the user */
+        else if (job->rc_zones != NULL && param->rc.zoneCount == 0)
+        {
+            if (param_parse(pv, param, "zones", job->rc_zones))
+            {
+                hb_log("encx265: invalid rate control zones, ignored");
+            }
+        }
     }
 
     /* statsfile (but not 2-pass) */
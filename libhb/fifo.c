@@ -47,6 +47,8 @@ struct hb_fifo_s
     hb_cond_t    * cond_empty;
     int            wait_empty;
     hb_cond_t    * cond_alert_full;
+    hb_fifo_alert_t * alert_push;
+    hb_fifo_alert_t * alert_drain;
     uint32_t       capacity;
     uint32_t       thresh;
     uint32_t       size;
@@ -459,6 +461,25 @@ hb_buffer_t * hb_buffer_eof_init(void)
 
 void hb_buffer_realloc( hb_buffer_t * b, int size )
 {
+    if (b->storage_type == AVPACKET)
+    {
+        // The payload belongs to libav, move it to memory we own
+        AVPacket *pkt  = b->storage;
+        int       used = b->size;
+
+        b->storage_type = STANDARD;
+        b->storage      = NULL;
+        b->data         = NULL;
+        b->alloc        = 0;
+        hb_buffer_realloc(b, MAX(size, used + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (b->data != NULL)
+        {
+            memcpy(b->data, pkt->data, used);
+            memset(b->data + used, 0, b->alloc - used);
+        }
+        av_packet_free(&pkt);
+        return;
+    }
     if ( size > b->alloc || b->data == NULL )
     {
         uint8_t   * tmp;
@@ -629,6 +650,9 @@ int hb_buffer_is_writable(const hb_buffer_t *buf)
             return av_frame_is_writable((AVFrame *)buf->storage);
         case STANDARD:
             return 1;
+        case AVPACKET:
+            return ((AVPacket *)buf->storage)->buf != NULL &&
+                   av_buffer_is_writable(((AVPacket *)buf->storage)->buf);
 #ifdef __APPLE__
         case COREMEDIA:
             return hb_cv_get_io_surface_usage_count(buf) == 1;
@@ -714,6 +738,28 @@ hb_buffer_t * hb_buffer_shallow_dup(const hb_buffer_t *src)
             }
         }
     }
+    else if (src->storage_type == AVPACKET)
+    {
+        buf = hb_buffer_wrapper_init();
+        if (buf)
+        {
+            AVPacket *pkt_copy = av_packet_alloc();
+            if (pkt_copy == NULL ||
+                av_packet_ref(pkt_copy, src->storage) < 0)
+            {
+                hb_buffer_close(&buf);
+                av_packet_free(&pkt_copy);
+                return NULL;
+            }
+
+            buf->storage_type = AVPACKET;
+            buf->storage = pkt_copy;
+            buf->data = src->data;
+            buf->size = src->size;
+            buf->f = src->f;
+            hb_buffer_copy_props(buf, src);
+        }
+    }
     else
     {
         buf = hb_buffer_dup(src);
@@ -731,7 +777,7 @@ hb_buffer_t * hb_buffer_dup(const hb_buffer_t *src)
         return NULL;
     }
 
-    if (src->storage_type == STANDARD)
+    if (src->storage_type == STANDARD || src->storage_type == AVPACKET)
     {
         buf = hb_buffer_init(src->size);
         if (buf)
@@ -1020,6 +1066,11 @@ static void free_buffer_resources(hb_buffer_t *b)
         av_frame_unref((AVFrame *)b->storage);
         av_frame_free((AVFrame **)&b->storage);
     }
+    else if (b->storage_type == AVPACKET)
+    {
+        av_packet_free((AVPacket **)&b->storage);
+        b->data = NULL;
+    }
 #ifdef __APPLE__
     else if (b->storage_type == COREMEDIA && b->storage != NULL)
     {
@@ -1214,6 +1265,81 @@ void hb_fifo_register_full_cond( hb_fifo_t * f, hb_cond_t * c )
     f->cond_alert_full = c;
 }
 
+// An alert wakes a thread that services several fifos.  It is
+// remembered until the thread waits, so that an alert signaled while
+// the thread is still checking its fifos is not lost.
+struct hb_fifo_alert_s
+{
+    hb_lock_t * lock;
+    hb_cond_t * cond;
+    int         signaled;
+};
+
+hb_fifo_alert_t * hb_fifo_alert_init( void )
+{
+    hb_fifo_alert_t * a = calloc( 1, sizeof( hb_fifo_alert_t ) );
+
+    if ( a == NULL )
+    {
+        return NULL;
+    }
+    a->lock = hb_lock_init();
+    a->cond = hb_cond_init();
+    return a;
+}
+
+void hb_fifo_alert_close( hb_fifo_alert_t ** _a )
+{
+    hb_fifo_alert_t * a = *_a;
+
+    if ( a == NULL )
+    {
+        return;
+    }
+    hb_cond_close( &a->cond );
+    hb_lock_close( &a->lock );
+    free( a );
+    *_a = NULL;
+}
+
+void hb_fifo_alert_signal( hb_fifo_alert_t * a )
+{
+    hb_lock( a->lock );
+    a->signaled = 1;
+    hb_cond_broadcast( a->cond );
+    hb_unlock( a->lock );
+}
+
+// Waits till the alert is signaled, returns immediately if it was
+// signaled since the last wait.
+void hb_fifo_alert_wait( hb_fifo_alert_t * a )
+{
+    hb_lock( a->lock );
+    while ( !a->signaled )
+    {
+        hb_cond_wait( a->cond, a->lock );
+    }
+    a->signaled = 0;
+    hb_unlock( a->lock );
+}
+
+// Registers an alert that is signaled each time data is pushed.
+void hb_fifo_register_push_alert( hb_fifo_t * f, hb_fifo_alert_t * a )
+{
+    hb_lock( f->lock );
+    f->alert_push = a;
+    hb_unlock( f->lock );
+}
+
+// Registers an alert that is signaled when a full fifo has drained
+// to the same level that wakes hb_fifo_push_wait().
+void hb_fifo_register_drain_alert( hb_fifo_t * f, hb_fifo_alert_t * a )
+{
+    hb_lock( f->lock );
+    f->alert_drain = a;
+    hb_unlock( f->lock );
+}
+
 int hb_fifo_size_bytes( hb_fifo_t * f )
 {
     int ret = 0;
@@ -1290,6 +1416,10 @@ hb_buffer_t * hb_fifo_get_wait( hb_fifo_t * f )
         f->wait_full = 0;
         hb_cond_signal( f->cond_full );
     }
+    if( f->alert_drain != NULL && f->size == f->capacity - f->thresh )
+    {
+        hb_fifo_alert_signal( f->alert_drain );
+    }
     hb_unlock( f->lock );
 
     return b;
@@ -1315,6 +1445,10 @@ hb_buffer_t * hb_fifo_get( hb_fifo_t * f )
         f->wait_full = 0;
         hb_cond_signal( f->cond_full );
     }
+    if( f->alert_drain != NULL && f->size == f->capacity - f->thresh )
+    {
+        hb_fifo_alert_signal( f->alert_drain );
+    }
     hb_unlock( f->lock );
 
     return b;
@@ -1429,6 +1563,10 @@ void hb_fifo_push_wait( hb_fifo_t * f, hb_buffer_t * b )
         f->wait_empty = 0;
         hb_cond_signal( f->cond_empty );
     }
+    if (f->alert_push != NULL)
+    {
+        hb_fifo_alert_signal( f->alert_push );
+    }
     hb_unlock( f->lock );
 }
 
@@ -1466,6 +1604,10 @@ void hb_fifo_push( hb_fifo_t * f, hb_buffer_t * b )
         f->wait_empty = 0;
         hb_cond_signal( f->cond_empty );
     }
+    if (f->alert_push != NULL)
+    {
+        hb_fifo_alert_signal( f->alert_push );
+    }
     hb_unlock( f->lock );
 }
 
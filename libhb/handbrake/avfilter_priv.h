@@ -25,6 +25,9 @@ struct hb_filter_private_s
     hb_value_t          * avfilters;
     hb_filter_init_t      input;
     hb_filter_init_t      output;
+
+    // Native conversion used by colorspace instead of avfilters
+    struct hb_colorspace_lut_s * lut;
 };
 
 int  hb_avfilter_null_work( hb_filter_object_t * filter,
@@ -801,6 +801,11 @@ struct hb_job_s
     PRIVATE int     pass_id;
     int             multipass;        // Enable multi-pass encode. Boolean
     int             fastanalysispass;
+    int             multipass_cache;  // MiB of analysis pass output to reuse
+                                      // in the final pass. 0 disables
+    int             complexity_analysis; // Single pass average bitrate,
+                                         // guided by a quick analysis of
+                                         // the title. Boolean
     char           *encoder_preset;
     char           *encoder_tune;
     char           *encoder_options;
@@ -972,6 +977,11 @@ struct hb_job_s
 
     int                     indepth_scan;
     hb_subtitle_config_t    select_subtitle_config;
+    int                     select_subtitle_single_pass;
+                                        // Run foreign audio search during
+                                        // the final encode pass and add the
+                                        // selected track afterwards instead
+                                        // of adding a subtitle scan pass.
 
     int             angle;              // dvd angle to encode
     int             frame_to_start;     // declare eof when we hit this frame
@@ -1011,6 +1021,8 @@ struct hb_job_s
     int             init_delay;
     hb_data_t     * extradata;
 
+    int             decimate;     /* Video frames sync keeps 1 of, see vfr.c */
+
     hb_fifo_t     * fifo_in;      /* Input to video decoder */
     hb_fifo_t     * fifo_raw;     /* Raw pictures */
     hb_fifo_t     * fifo_sync;    /* Raw pictures, framerate corrected */
@@ -1021,9 +1033,20 @@ struct hb_job_s
 
     hb_mux_data_t * mux_data;
 
+    struct hb_pass_cache_s * pass_cache; // set while recording the
+                                         // analysis pass output
+    char          * rc_zones;     // rate control zones from the
+                                  // complexity analysis
+
     int64_t         reader_pts_offset; // Reader can discard some video.
                                        // Other pipeline stages need to know
                                        // this.  E.g. sync and decsrtsub
+    int64_t         pts_to_start_input; // Start point in decoder input
+    int             pts_to_start_scr;   // timestamps, set by sync.  The
+                                        // video decoder skips work on
+                                        // frames before it.
+    hb_lock_t     * pts_to_start_lock;  // Protects the 2 above, NULL
+                                        // when there is no start point
 
     void           *hw_device_ctx;
     hb_hwaccel_t   *hw_accel;
@@ -1328,6 +1351,9 @@ struct hb_subtitle_s
     hb_fifo_t     * fifo_sync; /* Sync output, input to encoder */
     hb_fifo_t     * fifo_out;  /* Encoder output, input to mux */
     hb_mux_data_t * mux_data;
+
+    int             search_candidate; /* Foreign audio search candidate,
+                                         spooled by the muxer */
 #endif
 };
 
@@ -1575,6 +1601,9 @@ struct hb_work_object_s
     /* Pointer hb_audio_t so we have access to the info in the audio worker threads. */
     hb_audio_t        * audio;
 
+    /* Additional hb_audio_t outputs fed by a shared audio decoder. */
+    hb_list_t         * list_audio;
+
     /* Pointer hb_subtitle_t so we have access to the info in the subtitle worker threads. */
     hb_subtitle_t     * subtitle;
 
@@ -1589,6 +1618,7 @@ struct hb_work_object_s
     void              * hw_device_ctx;
     hb_hwaccel_t      * hw_accel;
     hb_title_t        * title;
+    int                 fast_scan;  // scan decodes keyframes only
 
     hb_work_object_t  * next;
 
@@ -1624,6 +1654,8 @@ extern hb_work_object_t hb_encca_aac;
 extern hb_work_object_t hb_encca_haac;
 extern hb_work_object_t hb_encavcodeca;
 extern hb_work_object_t hb_reader;
+extern hb_work_object_t hb_pass_cache_writer;
+extern hb_work_object_t hb_pass_cache_reader;
 
 #define HB_FILTER_OK      0
 #define HB_FILTER_DELAY   1
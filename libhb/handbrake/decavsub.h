@@ -18,5 +18,7 @@ hb_decavsub_context_t * decavsubInit( hb_work_object_t * w, hb_job_t * job );
 int                     decavsubWork( hb_decavsub_context_t * ctx,
                                    hb_buffer_t ** in, hb_buffer_t ** out );
 void                    decavsubClose( hb_decavsub_context_t * ctx );
+hb_buffer_t           * decavsubForcedOnly( hb_buffer_t * buf, int source,
+                                            int * seen_forced_sub );
 
 #endif // HANDBRAKE_DECAVSUB_H
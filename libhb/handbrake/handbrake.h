@@ -50,6 +50,7 @@ void          hb_scan( hb_handle_t * h, hb_list_t * paths, int title_index,
                       int crop_threshold_frames, int crop_threshold_pixels,
                       hb_list_t * exclude_extensions, int hw_decode, int keep_duplicate_titles);
 
+void          hb_scan_set_fast( hb_handle_t *, int enable );
 void          hb_scan_stop( hb_handle_t * );
 void          hb_force_rescan( hb_handle_t * );
 uint64_t      hb_first_duration( hb_handle_t * );
@@ -87,6 +88,11 @@ hb_image_t  * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
                              int picture, int rescale, int pix_fmt);
 hb_image_t  * hb_get_preview3(hb_handle_t * h, int picture,
                               hb_dict_t * job_dict);
+hb_preview_session_t * hb_preview_session_init(hb_handle_t * h);
+hb_image_t  * hb_preview_session_get(hb_preview_session_t * session,
+                                     hb_dict_t * job_dict, int picture,
+                                     int rescale, int pix_fmt);
+void          hb_preview_session_close(hb_preview_session_t ** session);
 void          hb_rotate_geometry( hb_geometry_crop_t * geo,
                                   hb_geometry_crop_t * result,
                                   int angle, int hflip);
@@ -128,6 +134,7 @@ typedef struct hb_interjob_s
     hb_rational_t vrate;     /* measured output vrate              */
 
     hb_subtitle_t *select_subtitle; /* foreign language scan subtitle */
+    struct hb_pass_cache_s *pass_cache; /* analysis pass output */
 
     void *context;
     int   context_size;
@@ -136,11 +143,29 @@ typedef struct hb_interjob_s
 hb_interjob_t * hb_interjob_get( hb_handle_t * );
 
 /* hb_get_state()
-   Should be regularly called by the UI (like 5 or 10 times a second).
-   Look at test/test.c to see how to use it. */
+   Should be regularly called by the UI (like 5 or 10 times a second),
+   or use hb_wait_state() or hb_set_state_callback() below to be woken
+   up on changes. Look at test/test.c to see how to use it. */
 void hb_get_state( hb_handle_t *, hb_state_t * );
 void hb_get_state2( hb_handle_t *, hb_state_t * );
 
+/* hb_wait_state()
+   Blocks until the state changes (or msec elapses, < 0 waits forever),
+   then returns it like hb_get_state(). Returns 1 if the state changed.
+   hb_wait_state2() does not consume SCANDONE/WORKDONE, and returns
+   right away if the state differs from s->state. */
+int  hb_wait_state( hb_handle_t *, hb_state_t *, int msec );
+int  hb_wait_state2( hb_handle_t *, hb_state_t *, int msec );
+
+/* hb_set_state_callback()
+   Registers a function called on each state change, from the libhb
+   thread that made the change. It must return quickly, e.g. by waking
+   up the UI main loop. Progress updates within a state are coalesced
+   to about 10 per second. Pass NULL to unregister. */
+typedef void (*hb_state_callback_t)( hb_handle_t * h, const hb_state_t * state,
+                                     void * opaque );
+void hb_set_state_callback( hb_handle_t *, hb_state_callback_t, void * opaque );
+
 /* hb_close()
    Aborts all current jobs if any, frees memory. */
 void          hb_close( hb_handle_t ** );
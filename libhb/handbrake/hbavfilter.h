@@ -46,6 +46,8 @@ void    hb_avfilter_append_dict(hb_value_array_t * filters,
                                 const char * name, hb_dict_t * settings);
 
 void    hb_avfilter_combine(hb_list_t * list);
+hb_buffer_t * hb_avfilter_filter_frame(hb_filter_object_t * filter,
+                                       hb_buffer_t ** buf_in);
 void    hb_avfilter_audio_combine(hb_list_t *list);
 
 #endif // HANDBRAKE_AVFILTER_H
@@ -73,6 +73,8 @@ hb_buffer_t   * hb_avframe_to_video_buffer(AVFrame *frame,
 void            hb_avframe_set_video_buffer_flags(hb_buffer_t * buf,
                                            AVFrame *frame,
                                            AVRational time_base);
+hb_buffer_t   * hb_avpacket_to_buffer(const AVPacket *pkt);
+void            hb_buffer_to_avpacket(AVPacket *pkt, hb_buffer_t **buf);
 
 int hb_av_encoder_present(int encoder);
 const char* const* hb_av_profile_get_names(int encoder);
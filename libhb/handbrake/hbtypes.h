@@ -11,6 +11,7 @@
 #define HANDBRAKE_TYPES_H
 
 typedef struct hb_handle_s hb_handle_t;
+typedef struct hb_preview_session_s hb_preview_session_t;
 typedef struct hb_list_s hb_list_t;
 typedef struct hb_buffer_list_s hb_buffer_list_t;
 typedef struct hb_rate_s hb_rate_t;
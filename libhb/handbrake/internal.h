@@ -50,6 +50,9 @@ void hb_set_state( hb_handle_t *, hb_state_t * );
 void hb_set_work_error( hb_handle_t * h, hb_error_code err );
 void hb_job_setup_passes(hb_handle_t *h, hb_job_t *job, hb_list_t *list_pass);
 
+typedef struct hb_ssa_cache_s hb_ssa_cache_t;
+hb_ssa_cache_t * hb_ssa_cache_get( hb_handle_t * );
+
 /***********************************************************************
  * fifo.c
  **********************************************************************/
@@ -105,6 +108,7 @@ struct hb_buffer_settings_s
 #define HB_FLAG_FRAMETYPE_KEY       0x1000
 #define HB_FLAG_FRAMETYPE_REF       0x2000
 #define HB_FLAG_DISCARD             0x4000
+#define HB_FLAG_FORCED_SUB          0x8000
     uint16_t      flags;
 
 #define HB_COMB_NONE  0
@@ -149,8 +153,9 @@ struct hb_buffer_s
         int           size;
     } plane[4]; // 3 Color components + alpha
 
+    // AVPACKET buffers reference a libav packet, data points into it
     void  *storage;
-    enum  { STANDARD, AVFRAME, COREMEDIA } storage_type;
+    enum  { STANDARD, AVFRAME, COREMEDIA, AVPACKET } storage_type;
 
     // libav may attach AV_PKT_DATA_PALETTE side data to some AVPackets
     // Store this data here when read and pass to decoder.
@@ -199,8 +204,16 @@ void          hb_buffer_copy_props(hb_buffer_t *dst, const hb_buffer_t *src);
 
 int           hb_buffer_is_writable(const hb_buffer_t *buf);
 
+typedef struct hb_fifo_alert_s hb_fifo_alert_t;
+hb_fifo_alert_t * hb_fifo_alert_init( void );
+void          hb_fifo_alert_close( hb_fifo_alert_t ** );
+void          hb_fifo_alert_signal( hb_fifo_alert_t * );
+void          hb_fifo_alert_wait( hb_fifo_alert_t * );
+
 hb_fifo_t   * hb_fifo_init( int capacity, int thresh );
 void          hb_fifo_register_full_cond( hb_fifo_t * f, hb_cond_t * c );
+void          hb_fifo_register_push_alert( hb_fifo_t * f, hb_fifo_alert_t * a );
+void          hb_fifo_register_drain_alert( hb_fifo_t * f, hb_fifo_alert_t * a );
 int           hb_fifo_size( hb_fifo_t * );
 int           hb_fifo_size_bytes( hb_fifo_t * );
 int           hb_fifo_is_full( hb_fifo_t * );
@@ -283,7 +296,8 @@ hb_thread_t * hb_scan_init( hb_handle_t *, volatile int * die,
                             hb_title_set_t * title_set, int preview_count,
                             int store_previews, uint64_t min_duration, uint64_t max_duration,
                             int crop_auto_switch_threshold, int crop_median_threshold,
-                            hb_list_t * exclude_extensions, int hw_decode, int keep_duplicate_titles);
+                            hb_list_t * exclude_extensions, int hw_decode, int keep_duplicate_titles,
+                            int fast);
 hb_thread_t * hb_work_init( hb_list_t * jobs,
                             volatile int * die, hb_error_code * error, hb_job_t ** job );
 void ReadLoop( void * _w );
@@ -294,12 +308,39 @@ hb_work_object_t * hb_audio_decoder( hb_handle_t *, int );
 hb_work_object_t * hb_audio_encoder( hb_handle_t *, int );
 hb_work_object_t * hb_video_decoder( hb_handle_t *, int, int, void *, hb_hwaccel_t *hw_accel);
 hb_work_object_t * hb_video_encoder( hb_handle_t *, int );
+hb_subtitle_t    * hb_subtitle_search_select( hb_list_t * list_subtitle,
+                                              int force );
 
 /***********************************************************************
  * sync.c
  **********************************************************************/
 hb_work_object_t * hb_sync_init( hb_job_t * job );
 
+/***********************************************************************
+ * passcache.c
+ **********************************************************************/
+typedef struct hb_pass_cache_s hb_pass_cache_t;
+
+hb_pass_cache_t * hb_pass_cache_init( hb_job_t * job );
+int               hb_pass_cache_write( hb_pass_cache_t * cache, int track,
+                                       const hb_buffer_t * buf );
+void              hb_pass_cache_finish( hb_pass_cache_t * cache,
+                                        hb_job_t * job );
+int               hb_pass_cache_can_replay( hb_pass_cache_t * cache,
+                                            hb_job_t * job );
+void              hb_pass_cache_close( hb_pass_cache_t ** cache );
+
+/***********************************************************************
+ * rendersub.c
+ **********************************************************************/
+hb_ssa_cache_t * hb_ssa_cache_init( void );
+void             hb_ssa_cache_close( hb_ssa_cache_t ** cache );
+
+/***********************************************************************
+ * complexity.c
+ **********************************************************************/
+char * hb_complexity_zones( hb_job_t * job );
+
 /***********************************************************************
  * mpegdemux.c
  **********************************************************************/
@@ -435,7 +476,9 @@ enum
     WORK_MUX,
     WORK_READER,
     WORK_DECAVSUB,
-    WORK_ENCAVSUB
+    WORK_ENCAVSUB,
+    WORK_PASS_CACHE_WRITER,
+    WORK_PASS_CACHE_READER
 };
 
 extern hb_filter_object_t hb_filter_detelecine;
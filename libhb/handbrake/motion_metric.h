@@ -0,0 +1,32 @@
+/* motion_metric.h
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#ifndef HANDBRAKE_MOTION_METRIC_H
+#define HANDBRAKE_MOTION_METRIC_H
+
+// All strides are in bytes, width and height in pixels.
+typedef struct
+{
+    // Sum of squared errors of the gamma adjusted pixels
+    // of all 16x16 blocks of a and b.
+    uint64_t (*sse)(const unsigned *gamma_lut,
+                    int width, int height,
+                    int stride_a, int stride_b,
+                    const uint8_t *a, const uint8_t *b);
+
+    // Downscale by 4 in each direction, width and height are
+    // the dimensions of dest.
+    void     (*approximate)(const uint8_t *source, uint8_t *dest,
+                            int source_stride, int dest_stride,
+                            int width, int height);
+} MotionMetricFunctions;
+
+void motion_metric_init_x86(MotionMetricFunctions *functions, int depth);
+
+#endif // HANDBRAKE_MOTION_METRIC_H
@@ -209,6 +209,10 @@ void        hb_cond_signal( hb_cond_t * );
 void        hb_cond_broadcast( hb_cond_t * c );
 void        hb_cond_close( hb_cond_t ** );
 
+/* Broadcast cond (while holding lock) when the thread exits */
+void        hb_thread_notify_exit( hb_thread_t * t, hb_lock_t * lock,
+                                   hb_cond_t * cond );
+
 /************************************************************************
  * Network
  ***********************************************************************/
@@ -19,6 +19,7 @@
 #define HB_PRESET_TYPE_ALL      2
 
 typedef struct hb_preset_index_s hb_preset_index_t;
+typedef struct hb_job_template_s hb_job_template_t;
 
 // A preset index is a list of indexes that specifies a path to a
 // specific preset in a preset list.  Since a preset list can have
@@ -34,8 +35,9 @@ struct hb_preset_index_s
 // Preset APIs reserved for libhb
 
 // Initialize the hb_value_array_t that holds HandBrake builtin presets
-// These presets come from a json string embedded in libhb and can be
-// retrieved with hb_presets_builtin_get() after initialization.
+// These presets come from a table of json strings embedded in libhb and
+// can be retrieved with hb_presets_builtin_get() after initialization.
+// They are parsed when first used.
 void         hb_presets_builtin_init(void);
 
 // Free all libhb presets. This should only be called when closing
@@ -73,6 +75,11 @@ hb_value_t * hb_presets_builtin_get(void);
 // Get HandBrake builtin presets list as json string
 char       * hb_presets_builtin_get_json(void);
 
+// Find a builtin preset by "Name" or "Folder/Name" without building the
+// whole builtin presets list. Returns a new cleaned preset dict that the
+// caller must free, or NULL if there is no such builtin preset.
+hb_value_t * hb_presets_builtin_search(const char *name);
+
 // Load default builtin presets list over the top of any builtins in the
 // current preset list. This should be used by a frontend when it recognizes
 // that it's preset file is from an older version of HandBrake.
@@ -146,6 +153,21 @@ int hb_preset_apply_title(hb_handle_t *h, int title_index,
 hb_dict_t  * hb_preset_job_init(hb_handle_t *h, int title_index,
                                 const hb_dict_t *preset);
 
+// Compile a preset once into a job template, then create jobs for
+// many titles from it. Jobs are the same as hb_preset_job_init() makes,
+// but the title independent parts of the preset are only interpreted
+// and validated by hb_job_template_init().
+hb_job_template_t * hb_job_template_init(const hb_dict_t *preset);
+void                hb_job_template_close(hb_job_template_t **tmpl);
+hb_dict_t         * hb_job_template_job_init(hb_handle_t *h, int title_index,
+                                             const hb_job_template_t *tmpl);
+
+// Create a job from a job template and add it to the hb queue.
+// Returns the job sequence id, or -1 on failure.
+int                 hb_job_template_add(hb_handle_t *h, int title_index,
+                                        const hb_job_template_t *tmpl,
+                                        const char *file);
+
 // Reinitialize subtitles from preset defaults.
 int hb_preset_job_add_subtitles(hb_handle_t *h, int title_index,
                                 const hb_dict_t *preset, hb_dict_t *job_dict);
@@ -29,6 +29,9 @@
 #endif
 #endif
 
+// Minimum time in ms between two progress notifications
+#define HB_STATE_NOTIFY_INTERVAL 100
+
 struct hb_handle_s
 {
     int            id;
@@ -53,22 +56,40 @@ struct hb_handle_s
     hb_thread_t  * work_thread;
 
     hb_lock_t    * state_lock;
+    hb_cond_t    * state_cond;
     hb_state_t     state;
 
+    /* Bumped on every state change, state_cond is broadcast with it.
+       state_serial_seen is the last serial hb_wait_state() returned */
+    uint64_t       state_serial;
+    uint64_t       state_serial_seen;
+    int64_t        state_notify_date;
+    hb_state_callback_t state_callback;
+    void         * state_callback_opaque;
+
     int            paused;
     hb_lock_t    * pause_lock;
     int64_t        pause_date;
     int64_t        pause_duration;
 
     volatile int   scan_die;
+    int            scan_fast;
 
     /* Stash of persistent data between jobs, for stuff
        like correcting frame count and framerate estimates
        on multi-pass encodes where frames get dropped.     */
     hb_interjob_t * interjob;
 
+    // libass fonts and renderers shared by the jobs of this handle
+    hb_ssa_cache_t * ssa_cache;
+
     // power management opaque pointer
     void         * system_sleep_opaque;
+
+    /* Preview session used by hb_get_preview(), and a counter
+       bumped whenever the stored previews are removed */
+    hb_preview_session_t * preview_session;
+    int            preview_generation;
 };
 
 hb_work_object_t * hb_objects = NULL;
@@ -76,6 +97,7 @@ int hb_instance_counter = 0;
 int disable_hardware = 0;
 
 static void thread_func( void * );
+static void notify_state( hb_handle_t * h );
 
 int hb_avcodec_open(AVCodecContext *avctx, const AVCodec *codec,
                     AVDictionary **av_opts, int thread_count)
@@ -220,12 +242,14 @@ hb_handle_t * hb_init( int verbose )
     h->jobs       = hb_list_init();
 
     h->state_lock  = hb_lock_init();
+    h->state_cond  = hb_cond_init();
     h->state.state = HB_STATE_IDLE;
 
     h->pause_lock = hb_lock_init();
     h->pause_date = -1;
 
     h->interjob = calloc( sizeof( hb_interjob_t ), 1 );
+    h->ssa_cache = hb_ssa_cache_init();
 
     /* Start library thread */
     hb_log( "hb_init: starting libhb thread" );
@@ -323,6 +347,8 @@ void hb_remove_previews( hb_handle_t * h )
     DIR           * dir;
     struct dirent * entry;
 
+    h->preview_generation++;
+
     dirname = hb_get_temporary_directory();
     dir = opendir( dirname );
     if (dir == NULL)
@@ -414,6 +440,7 @@ void hb_scan( hb_handle_t * h, hb_list_t * paths, int title_index,
                     hb_lock( h->state_lock );
                     h->state.state = HB_STATE_SCANDONE;
                     hb_unlock( h->state_lock );
+                    notify_state( h );
                     return;
                 }
             }
@@ -474,7 +501,22 @@ void hb_scan( hb_handle_t * h, hb_list_t * paths, int title_index,
                                    &h->title_set, preview_count,
                                    store_previews, min_duration, max_duration,
                                    crop_threshold_frames, crop_threshold_pixels,
-                                   exclude_extensions, hw_decode, keep_duplicate_titles);
+                                   exclude_extensions, hw_decode, keep_duplicate_titles,
+                                   h->scan_fast);
+    hb_thread_notify_exit( h->scan_thread, h->state_lock, h->state_cond );
+}
+
+/**
+ * Enables the fast scan mode of the next scans. Previews are decoded
+ * from keyframes only and without the in-loop filters, which makes
+ * scanning of high resolution sources much cheaper. Closed captions
+ * that are not carried by keyframes may be missed.
+ * @param h Handle to hb_handle_t
+ * @param enable 1 to enable, 0 to disable
+ */
+void hb_scan_set_fast( hb_handle_t * h, int enable )
+{
+    h->scan_fast = !!enable;
 }
 
 void hb_force_rescan( hb_handle_t * h )
@@ -797,28 +839,41 @@ static void process_filter(hb_filter_object_t * filter)
     }
 }
 
-// Get preview and apply applicable filters
-hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
-                             int picture, int rescale, int pix_fmt)
+struct hb_preview_session_s
+{
+    hb_handle_t         * h;
+    hb_lock_t           * lock;
+    int                   generation;
+
+    // Source preview, read once per title and picture
+    int                   title_index;
+    int                   picture;
+    hb_buffer_t         * source;
+
+    // Filter chain, kept while the settings it was built from are unchanged
+    char                * settings;
+    hb_job_t            * job;
+    int64_t               pts;
+    int                   width;
+    int                   height;
+};
+
+// Unpack the job and initialize the filters that apply to a single
+// preview frame.
+static hb_job_t * preview_job_init(hb_handle_t * h, hb_dict_t * job_dict,
+                                   int rescale, int pix_fmt)
 {
     hb_job_t    * job;
-    hb_title_t  * title = NULL;
-    hb_buffer_t * in = NULL, * out;
+    hb_title_t  * title;
 
     job = hb_dict_to_job(h, job_dict);
     if (job == NULL)
     {
         hb_error("hb_get_preview3: failed to unpack job");
-        goto fail;
+        return NULL;
     }
     title = job->title;
 
-    in = hb_read_preview( h, title, picture, HB_PREVIEW_FORMAT_JPG );
-    if (in == NULL)
-    {
-        goto fail;
-    }
-
     // Initialize supported filters
     hb_list_t        * list_filter = job->list_filter;
     hb_filter_init_t   init;
@@ -975,6 +1030,35 @@ hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
         ii++;
     }
 
+    return job;
+}
+
+static void preview_job_close(hb_job_t ** _job)
+{
+    hb_job_t * job = *_job;
+    int        ii;
+
+    if (job == NULL)
+    {
+        return;
+    }
+    for (ii = 0; ii < hb_list_count(job->list_filter); ii++)
+    {
+        hb_filter_object_t * filter = hb_list_item(job->list_filter, ii);
+        filter->close(filter);
+    }
+    hb_job_close(_job);
+}
+
+// Run a preview frame through the filters of job and wait for EOF.
+// The filters are done afterwards and can not be reused.
+static hb_buffer_t * preview_filter_eof(hb_job_t * job, hb_buffer_t * in)
+{
+    hb_list_t          * list_filter = job->list_filter;
+    hb_filter_object_t * filter;
+    hb_buffer_t        * out;
+    int                  ii;
+
     // Set up filter fifos
     hb_fifo_t *fifo_in, * fifo_first, * fifo_last;
 
@@ -1006,13 +1090,6 @@ hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
     // Retrieve the filtered preview frame
     out = hb_fifo_get(fifo_last);
 
-    // Close filters
-    for (ii = 0; ii < hb_list_count(list_filter); ii++)
-    {
-        filter = hb_list_item(list_filter, ii);
-        filter->close(filter);
-    }
-
     // Close fifos
     hb_fifo_close(&fifo_first);
     for( ii = 0; ii < hb_list_count( list_filter ); ii++)
@@ -1021,45 +1098,284 @@ hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
         hb_fifo_close(&filter->fifo_out);
     }
 
+    return out;
+}
+
+// Run a preview frame through the session's filter chain, one filter
+// at a time.  The filters are kept for the next frame unless a graph had
+// to be flushed to produce output (e.g. yadif holds frames back), in
+// which case *flushed is set.
+static hb_buffer_t * preview_filter_frame(hb_preview_session_t * session,
+                                          hb_buffer_t * in, int * flushed)
+{
+    hb_list_t   * list_filter = session->job->list_filter;
+    hb_buffer_t * out;
+    int           ii;
+
+    // The buffer source requires increasing timestamps
+    in->s.start    = session->pts;
+    in->s.duration = 3003;
+    in->s.stop     = in->s.start + in->s.duration;
+    session->pts  += in->s.duration;
+
+    for (ii = 0; ii < hb_list_count(list_filter) && in != NULL; ii++)
+    {
+        hb_filter_object_t * filter = hb_list_item(list_filter, ii);
+
+        if (filter->skip)
+        {
+            continue;
+        }
+        if (filter->id == HB_FILTER_AVFILTER)
+        {
+            out = hb_avfilter_filter_frame(filter, &in);
+            if (out == NULL)
+            {
+                out = hb_avfilter_filter_frame(filter, NULL);
+                *flushed = 1;
+            }
+        }
+        else
+        {
+            out = NULL;
+            filter->work(filter, &in, &out);
+        }
+        hb_buffer_close(&in);
+        in = out;
+    }
+
+    return in;
+}
+
+// Single frame filters that keep no state between frames can process
+// a frame without waiting for EOF and be reused across previews.
+static int preview_chain_reusable(hb_list_t * list_filter)
+{
+    int ii;
+
+    for (ii = 0; ii < hb_list_count(list_filter); ii++)
+    {
+        hb_filter_object_t * filter = hb_list_item(list_filter, ii);
+        if (filter->skip)
+        {
+            // Aliases that were combined into an avfilter
+            continue;
+        }
+        if (filter->id != HB_FILTER_AVFILTER &&
+            filter->id != HB_FILTER_CROP_SCALE)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// The parts of the job that the preview filter chain depends on
+static char * preview_settings_key(hb_dict_t * job_dict,
+                                   int rescale, int pix_fmt)
+{
+    hb_dict_t * dict = hb_dict_init();
+    const char * keys[] = { "Source", "PAR", "Filters" };
+    char       * json, * key;
+    int          ii;
+
+    for (ii = 0; ii < (int)(sizeof(keys) / sizeof(keys[0])); ii++)
+    {
+        hb_value_t * value = hb_dict_get(job_dict, keys[ii]);
+        if (value != NULL)
+        {
+            hb_dict_set(dict, keys[ii], hb_value_dup(value));
+        }
+    }
+    json = hb_value_get_json(dict);
+    hb_value_free(&dict);
+    if (json == NULL)
+    {
+        return NULL;
+    }
+    key = hb_strdup_printf("%d:%d:%s", rescale, pix_fmt, json);
+    free(json);
+
+    return key;
+}
+
+static void preview_session_reset(hb_preview_session_t * session)
+{
+    free(session->settings);
+    session->settings = NULL;
+    preview_job_close(&session->job);
+}
+
+hb_preview_session_t * hb_preview_session_init(hb_handle_t * h)
+{
+    hb_preview_session_t * session;
+
+    session = calloc(1, sizeof(hb_preview_session_t));
+    if (session == NULL)
+    {
+        return NULL;
+    }
+    session->h          = h;
+    session->lock       = hb_lock_init();
+    session->generation = h->preview_generation;
+    session->width      = 854;
+    session->height     = 480;
+
+    return session;
+}
+
+void hb_preview_session_close(hb_preview_session_t ** _session)
+{
+    hb_preview_session_t * session = *_session;
+
+    if (session == NULL)
+    {
+        return;
+    }
+    preview_session_reset(session);
+    hb_buffer_close(&session->source);
+    hb_lock_close(&session->lock);
+    free(session);
+    *_session = NULL;
+}
+
+// Get preview and apply applicable filters
+hb_image_t * hb_preview_session_get(hb_preview_session_t * session,
+                                    hb_dict_t * job_dict, int picture,
+                                    int rescale, int pix_fmt)
+{
+    hb_handle_t * h = session->h;
+    hb_job_t    * job = NULL;
+    hb_title_t  * title;
+    hb_buffer_t * in, * out = NULL;
+    hb_image_t  * image;
+    char        * settings;
+    hb_dict_t   * source_dict;
+    int           title_index = -1;
+
+    hb_lock(session->lock);
+
+    // Previews were removed, e.g. by a new scan.  Titles may be gone.
+    if (session->generation != h->preview_generation)
+    {
+        preview_session_reset(session);
+        hb_buffer_close(&session->source);
+        session->generation = h->preview_generation;
+    }
+
+    source_dict = hb_dict_get(job_dict, "Source");
+    if (source_dict != NULL)
+    {
+        title_index = hb_dict_get_int(source_dict, "Title");
+    }
+
+    settings = preview_settings_key(job_dict, rescale, pix_fmt);
+    if (settings == NULL || session->settings == NULL ||
+        strcmp(settings, session->settings))
+    {
+        preview_session_reset(session);
+        job = preview_job_init(h, job_dict, rescale, pix_fmt);
+        if (job == NULL)
+        {
+            free(settings);
+            goto fail;
+        }
+        title = job->title;
+        title_index = title->index;
+        session->width  = title->geometry.width * title->geometry.par.num /
+                          title->geometry.par.den;
+        session->height = title->geometry.height;
+
+        if (settings != NULL && preview_chain_reusable(job->list_filter))
+        {
+            session->settings = settings;
+            settings = NULL;
+            session->job = job;
+            session->pts = 0;
+            job = NULL;
+        }
+        free(settings);
+    }
+    else
+    {
+        free(settings);
+    }
+
+    if (session->source == NULL || session->title_index != title_index ||
+        session->picture != picture)
+    {
+        hb_buffer_close(&session->source);
+        title = hb_find_title_by_index(h, title_index);
+        if (title == NULL)
+        {
+            goto fail;
+        }
+        session->source = hb_read_preview(h, title, picture,
+                                          HB_PREVIEW_FORMAT_JPG);
+        if (session->source == NULL)
+        {
+            goto fail;
+        }
+        session->title_index = title_index;
+        session->picture     = picture;
+    }
+
+    in = hb_buffer_dup(session->source);
+    if (job != NULL)
+    {
+        out = preview_filter_eof(job, in);
+        preview_job_close(&job);
+    }
+    else
+    {
+        int flushed = 0;
+
+        out = preview_filter_frame(session, in, &flushed);
+        if (flushed)
+        {
+            preview_session_reset(session);
+        }
+    }
+
     if (out == NULL)
     {
         hb_error("hb_get_preview3: Failed to filter preview");
+        preview_session_reset(session);
         goto fail;
     }
 
-    hb_image_t *image = hb_buffer_to_image(out);
+    image = hb_buffer_to_image(out);
     hb_buffer_close(&out);
     if (image->width < 16 || image->height < 16)
     {
         // Guard against broken filter generating degenerate images
         hb_error("hb_get_preview3: bad preview image output by filters");
         hb_image_close(&image);
+        preview_session_reset(session);
         goto fail;
     }
 
-    // Clean up
-    hb_job_close(&job);
+    hb_unlock(session->lock);
 
     return image;
 
 fail:
+    preview_job_close(&job);
+    image = hb_image_init(pix_fmt, session->width, session->height);
+    hb_unlock(session->lock);
 
-    {
-        int width = 854, height = 480;
-
-        if (title != NULL)
-        {
-            hb_geometry_t * geo = &title->geometry;
-
-            width = geo->width * geo->par.num / geo->par.den;
-            height = geo->height;
-        }
+    return image;
+}
 
-        image = hb_image_init(pix_fmt, width, height);
+hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
+                             int picture, int rescale, int pix_fmt)
+{
+    if (h->preview_session == NULL)
+    {
+        h->preview_session = hb_preview_session_init(h);
     }
-    hb_job_close(&job);
-
-    return image;
+    return hb_preview_session_get(h->preview_session, job_dict,
+                                  picture, rescale, pix_fmt);
 }
 
 hb_image_t * hb_get_preview3(hb_handle_t * h, int picture,
@@ -1772,6 +2088,118 @@ hb_job_t * hb_current_job( hb_handle_t * h )
     return( h->current_job );
 }
 
+/*
+ * Foreign Audio Search candidates: all subtitles matching the language of
+ * the first audio track being encoded. Returns NULL if there is nothing to
+ * search.
+ */
+static hb_list_t * subtitle_search_candidates( hb_job_t * job )
+{
+    hb_list_t     * list_subtitle;
+    hb_audio_t    * audio;
+    hb_subtitle_t * subtitle;
+    int             i;
+    char            audio_lang[4];
+
+    memset( audio_lang, 0, sizeof( audio_lang ) );
+
+    /* Find the first audio language that is being encoded, then add all the
+     * matching subtitles for that language. */
+    for( i = 0; i < hb_list_count( job->list_audio ); i++ )
+    {
+        if( ( audio = hb_list_item( job->list_audio, i ) ) )
+        {
+            strncpy( audio_lang, audio->config.lang.iso639_2, sizeof( audio_lang ) );
+            break;
+        }
+    }
+
+    list_subtitle = hb_list_init();
+
+    for( i = 0; i < hb_list_count( job->title->list_subtitle ); i++ )
+    {
+        subtitle = hb_list_item( job->title->list_subtitle, i );
+        if( strcmp( subtitle->iso639_2, audio_lang ) == 0 &&
+            hb_subtitle_can_force( subtitle->source ) )
+        {
+            /* Matched subtitle language with audio language, so add this to
+             * our list to scan. */
+            hb_list_add( list_subtitle, hb_subtitle_copy( subtitle ) );
+        }
+    }
+    int count = hb_list_count(list_subtitle);
+    if (count == 0 ||
+        (count == 1 && !job->select_subtitle_config.force))
+    {
+        while ((subtitle = hb_list_item(list_subtitle, 0)) != NULL)
+        {
+            hb_list_rem(list_subtitle, subtitle);
+            hb_subtitle_close(&subtitle);
+        }
+        hb_list_close(&list_subtitle);
+    }
+    return list_subtitle;
+}
+
+// Whether the muxer can create one stream that fits both subtitles
+static int subtitle_search_same_stream( hb_subtitle_t * a, hb_subtitle_t * b )
+{
+    if (a->source != b->source || a->width != b->width ||
+        a->height != b->height)
+    {
+        return 0;
+    }
+    if (a->extradata == NULL || b->extradata == NULL)
+    {
+        return a->extradata == b->extradata;
+    }
+    return a->extradata->size == b->extradata->size &&
+           !memcmp(a->extradata->bytes, b->extradata->bytes,
+                   a->extradata->size);
+}
+
+/*
+ * Foreign Audio Search can run during the encode pass if the selected
+ * track is going to be passed through to the output file.  Burning it in
+ * requires knowing the track before the video is encoded.
+ *
+ * The muxer reserves one stream for the selected track when it writes
+ * the header and writes its samples at the end, so all candidates must
+ * fit that stream.  Only MP4 indexes samples by time, in Matroska the
+ * subtitles would end up behind all the other packets of the file.
+ */
+static int subtitle_search_single_pass( hb_job_t * job )
+{
+    hb_list_t     * candidates;
+    hb_subtitle_t * subtitle, * first;
+    int             result = 1;
+
+    if (job->select_subtitle_config.dest != PASSTHRUSUB ||
+        job->select_subtitle_config.external_filename != NULL ||
+        !(job->mux & HB_MUX_MASK_ISOBFF_FAMILY))
+    {
+        return 0;
+    }
+    candidates = subtitle_search_candidates(job);
+    first      = hb_list_item(candidates, 0);
+    for (int ii = 0; ii < hb_list_count(candidates); ii++)
+    {
+        subtitle = hb_list_item(candidates, ii);
+        if (!hb_subtitle_can_pass(subtitle->source, job->mux) ||
+            !subtitle_search_same_stream(first, subtitle))
+        {
+            result = 0;
+        }
+    }
+    while ((subtitle = hb_list_item(candidates, 0)) != NULL)
+    {
+        hb_list_rem(candidates, subtitle);
+        hb_subtitle_close(&subtitle);
+    }
+    hb_list_close(&candidates);
+    return result;
+}
+
 /**
  * Adds a job to the job list.
  * @param h Handle to hb_handle_t.
@@ -1780,10 +2208,7 @@ hb_job_t * hb_current_job( hb_handle_t * h )
 static void hb_add_internal( hb_handle_t * h, hb_job_t * job, hb_list_t *list_pass )
 {
     hb_job_t      * job_copy;
-    hb_audio_t    * audio;
     hb_subtitle_t * subtitle;
-    int             i;
-    char            audio_lang[4];
 
     /* Copy the job */
     job_copy                  = calloc( sizeof( hb_job_t ), 1 );
@@ -1812,46 +2237,17 @@ static void hb_add_internal( hb_handle_t * h, hb_job_t * job, hb_list_t *list_pa
      * Otherwise, copy all subtitles found in the input job (which can be
      * manually selected by the user, or added after the Foreign Audio
      * Search pass). */
-    memset( audio_lang, 0, sizeof( audio_lang ) );
-
     if( job->indepth_scan )
     {
-
-        /* Find the first audio language that is being encoded, then add all the
-         * matching subtitles for that language. */
-        for( i = 0; i < hb_list_count( job->list_audio ); i++ )
-        {
-            if( ( audio = hb_list_item( job->list_audio, i ) ) )
-            {
-                strncpy( audio_lang, audio->config.lang.iso639_2, sizeof( audio_lang ) );
-                break;
-            }
-        }
-
         /*
          * If doing a subtitle scan then add all the matching subtitles for this
          * language.
+         *
+         * We will update the subtitle list on the next pass later, after
+         * the subtitle scan pass has completed.
          */
-        job_copy->list_subtitle = hb_list_init();
-
-        for( i = 0; i < hb_list_count( job->title->list_subtitle ); i++ )
-        {
-            subtitle = hb_list_item( job->title->list_subtitle, i );
-            if( strcmp( subtitle->iso639_2, audio_lang ) == 0 &&
-                hb_subtitle_can_force( subtitle->source ) )
-            {
-                /* Matched subtitle language with audio language, so add this to
-                 * our list to scan.
-                 *
-                 * We will update the subtitle list on the next pass later, after
-                 * the subtitle scan pass has completed. */
-                hb_list_add( job_copy->list_subtitle,
-                             hb_subtitle_copy( subtitle ) );
-            }
-        }
-        int count = hb_list_count(job_copy->list_subtitle);
-        if (count == 0 ||
-            (count == 1 && !job_copy->select_subtitle_config.force))
+        job_copy->list_subtitle = subtitle_search_candidates( job );
+        if (job_copy->list_subtitle == NULL)
         {
             hb_log("Skipping subtitle scan.  No suitable subtitle tracks.");
             hb_job_close(&job_copy);
@@ -1862,6 +2258,29 @@ static void hb_add_internal( hb_handle_t * h, hb_job_t * job, hb_list_t *list_pa
     {
         /* Copy all subtitles from the input job to title_copy/job_copy. */
         job_copy->list_subtitle = hb_subtitle_list_copy( job->list_subtitle );
+
+        if (job->select_subtitle_single_pass &&
+            (job->pass_id == HB_PASS_ENCODE ||
+             job->pass_id == HB_PASS_ENCODE_FINAL))
+        {
+            /* Foreign Audio Search during the encode pass. The candidates
+             * are decoded along with the other subtitles, then the muxer
+             * adds the selected one to the output once the encode is done.
+             * Decode all of their subtitles, forced-only is applied after
+             * the selection. */
+            hb_list_t * candidates = subtitle_search_candidates( job );
+
+            while ((subtitle = hb_list_item(candidates, 0)) != NULL)
+            {
+                hb_list_rem(candidates, subtitle);
+                subtitle->config.dest          = PASSTHRUSUB;
+                subtitle->config.force         = 0;
+                subtitle->config.default_track = 0;
+                subtitle->search_candidate     = 1;
+                hb_list_add(job_copy->list_subtitle, subtitle);
+            }
+            hb_list_close(&candidates);
+        }
     }
 
     job_copy->list_chapter = hb_chapter_list_copy( job->list_chapter );
@@ -1950,11 +2369,28 @@ void hb_job_setup_passes(hb_handle_t * h, hb_job_t * job, hb_list_t * list_pass)
     }
     if (job->indepth_scan)
     {
-        hb_deep_log(2, "Adding subtitle scan pass");
-        job->pass_id = HB_PASS_SUBTITLE;
-        hb_add_internal(h, job, list_pass);
+        if (job->select_subtitle_single_pass &&
+            subtitle_search_single_pass(job))
+        {
+            hb_deep_log(2, "Running subtitle scan during the encode pass");
+        }
+        else
+        {
+            if (job->select_subtitle_single_pass)
+            {
+                hb_log("Single pass subtitle scan not possible, adding subtitle scan pass");
+            }
+            job->select_subtitle_single_pass = 0;
+            hb_deep_log(2, "Adding subtitle scan pass");
+            job->pass_id = HB_PASS_SUBTITLE;
+            hb_add_internal(h, job, list_pass);
+        }
         job->indepth_scan = 0;
     }
+    else
+    {
+        job->select_subtitle_single_pass = 0;
+    }
     if (job->multipass)
     {
         hb_deep_log(2, "Adding multi-pass encode");
@@ -2008,6 +2444,7 @@ void hb_start( hb_handle_t * h )
     p.paused       = 0;
 #undef p
     hb_unlock( h->state_lock );
+    notify_state( h );
 
     h->paused         = 0;
     h->pause_date     = -1;
@@ -2015,6 +2452,7 @@ void hb_start( hb_handle_t * h )
     h->work_die       = 0;
     h->work_error     = HB_ERROR_NONE;
     h->work_thread    = hb_work_init( h->jobs, &h->work_die, &h->work_error, &h->current_job );
+    hb_thread_notify_exit( h->work_thread, h->state_lock, h->state_cond );
 }
 
 /**
@@ -2033,6 +2471,7 @@ void hb_pause( hb_handle_t * h )
         hb_lock( h->state_lock );
         h->state.state = HB_STATE_PAUSED;
         hb_unlock( h->state_lock );
+        notify_state( h );
     }
 }
 
@@ -2058,6 +2497,9 @@ void hb_resume( hb_handle_t * h )
 
         hb_unlock( h->pause_lock );
         h->paused = 0;
+
+        // Stop the paused time updates in the libhb thread
+        notify_state( h );
     }
 }
 
@@ -2094,6 +2536,7 @@ void hb_get_state( hb_handle_t * h, hb_state_t * s )
     memcpy( s, &h->state, sizeof( hb_state_t ) );
     if ( h->state.state == HB_STATE_SCANDONE || h->state.state == HB_STATE_WORKDONE )
         h->state.state = HB_STATE_IDLE;
+    h->state_serial_seen = h->state_serial;
 
     hb_unlock( h->state_lock );
 }
@@ -2107,6 +2550,115 @@ void hb_get_state2( hb_handle_t * h, hb_state_t * s )
     hb_unlock( h->state_lock );
 }
 
+/**
+ * Waits for a state change, then returns the state like hb_get_state().
+ * Returns immediately if the state changed since the last call to
+ * hb_get_state() or hb_wait_state().
+ * @param h Handle to hb_handle_t.
+ * @param s Handle to hb_state_t which to copy the state data.
+ * @param msec Maximum time to wait in milliseconds, < 0 waits forever.
+ * @returns 1 if the state changed, 0 on timeout.
+ */
+int hb_wait_state( hb_handle_t * h, hb_state_t * s, int msec )
+{
+    int changed;
+
+    hb_lock( h->state_lock );
+    if (h->state_serial == h->state_serial_seen)
+    {
+        if (msec < 0)
+        {
+            hb_cond_wait(h->state_cond, h->state_lock);
+        }
+        else if (msec > 0)
+        {
+            hb_cond_timedwait(h->state_cond, h->state_lock, msec);
+        }
+    }
+    changed = h->state_serial != h->state_serial_seen;
+    hb_unlock( h->state_lock );
+
+    hb_get_state( h, s );
+    return changed;
+}
+
+/**
+ * Like hb_wait_state(), but does not consume the SCANDONE and WORKDONE
+ * states, see hb_get_state2(). Returns immediately if s->state differs
+ * from the current state, otherwise waits for the next state change.
+ * @param h Handle to hb_handle_t.
+ * @param s Last state seen by the caller, updated with the current state.
+ * @param msec Maximum time to wait in milliseconds, < 0 waits forever.
+ * @returns 1 if the state changed, 0 on timeout.
+ */
+int hb_wait_state2( hb_handle_t * h, hb_state_t * s, int msec )
+{
+    uint64_t serial;
+    int      changed;
+
+    hb_lock( h->state_lock );
+    serial = h->state_serial;
+    if (h->state.state == s->state)
+    {
+        if (msec < 0)
+        {
+            hb_cond_wait(h->state_cond, h->state_lock);
+        }
+        else if (msec > 0)
+        {
+            hb_cond_timedwait(h->state_cond, h->state_lock, msec);
+        }
+    }
+    changed = h->state.state != s->state || h->state_serial != serial;
+    memcpy( s, &h->state, sizeof( hb_state_t ) );
+    hb_unlock( h->state_lock );
+
+    return changed;
+}
+
+/**
+ * Registers a function called on every state change. The callback runs
+ * on the libhb thread that changed the state, so it must not block;
+ * typically it only wakes up the caller's own event loop.
+ * @param h Handle to hb_handle_t.
+ * @param callback Function to call, or NULL to unregister.
+ * @param opaque Passed to callback.
+ */
+void hb_set_state_callback( hb_handle_t * h, hb_state_callback_t callback,
+                            void * opaque )
+{
+    hb_lock( h->state_lock );
+    h->state_callback        = callback;
+    h->state_callback_opaque = opaque;
+    hb_unlock( h->state_lock );
+}
+
+/**
+ * Wakes up state waiters and calls the state callback.
+ * Must be called without state_lock held, after each state change.
+ * @param h Handle to hb_handle_t.
+ */
+static void notify_state( hb_handle_t * h )
+{
+    hb_state_callback_t callback;
+    void              * opaque;
+    hb_state_t          state;
+
+    hb_lock( h->state_lock );
+    h->state_serial++;
+    h->state_notify_date = hb_get_date();
+    hb_cond_broadcast( h->state_cond );
+    callback = h->state_callback;
+    opaque   = h->state_callback_opaque;
+    memcpy( &state, &h->state, sizeof( hb_state_t ) );
+    hb_unlock( h->state_lock );
+
+    if (callback != NULL)
+    {
+        callback( h, &state, opaque );
+    }
+}
+
 /**
  * Closes access to libhb by freeing the hb_handle_t handle contained in hb_init.
  * @param _h Pointer to handle to hb_handle_t.
@@ -2116,7 +2668,10 @@ void hb_close( hb_handle_t ** _h )
     hb_handle_t * h = *_h;
     hb_title_t * title;
 
+    hb_lock( h->state_lock );
     h->die = 1;
+    hb_cond_broadcast( h->state_cond );
+    hb_unlock( h->state_lock );
 
     hb_thread_close( &h->main_thread );
 
@@ -2130,12 +2685,15 @@ void hb_close( hb_handle_t ** _h )
     h->title_set.path = NULL;
 
     hb_list_close( &h->jobs );
+    hb_cond_close( &h->state_cond );
     hb_lock_close( &h->state_lock );
     hb_lock_close( &h->pause_lock );
 
     hb_system_sleep_opaque_close(&h->system_sleep_opaque);
 
+    hb_preview_session_close(&h->preview_session);
     free( h->interjob );
+    hb_ssa_cache_close( &h->ssa_cache );
 
     free( h );
     *_h = NULL;
@@ -2168,6 +2726,8 @@ int hb_global_init()
     hb_register(&hb_workpass);
     hb_register(&hb_muxer);
     hb_register(&hb_reader);
+    hb_register(&hb_pass_cache_writer);
+    hb_register(&hb_pass_cache_reader);
     hb_register(&hb_sync_video);
     hb_register(&hb_sync_audio);
     hb_register(&hb_sync_subtitle);
@@ -2264,6 +2824,27 @@ static void thread_func( void * _h )
 
     while( !h->die )
     {
+        /* Sleep until the scan or work thread exits or hb_close()
+           is called. Both threads broadcast state_cond when they exit,
+           and the check is done under state_lock so no exit is missed.
+           While paused, wake up once a second to update the paused
+           time. */
+        hb_lock( h->state_lock );
+        if (!h->die &&
+            !(h->scan_thread && hb_thread_has_exited(h->scan_thread)) &&
+            !(h->work_thread && hb_thread_has_exited(h->work_thread)))
+        {
+            if (h->paused)
+            {
+                hb_cond_timedwait( h->state_cond, h->state_lock, 1000 );
+            }
+            else
+            {
+                hb_cond_wait( h->state_cond, h->state_lock );
+            }
+        }
+        hb_unlock( h->state_lock );
+
         /* Check if the scan thread is done */
         if( h->scan_thread &&
             hb_thread_has_exited( h->scan_thread ) )
@@ -2291,6 +2872,7 @@ static void thread_func( void * _h )
             hb_lock( h->state_lock );
             h->state.state = HB_STATE_SCANDONE;
             hb_unlock( h->state_lock );
+            notify_state( h );
         }
 
         /* Check if the work thread is done */
@@ -2305,14 +2887,17 @@ static void thread_func( void * _h )
             h->state.param.working.error = h->work_error;
 
             hb_unlock( h->state_lock );
+            notify_state( h );
         }
 
-        if (h->paused)
+        if (h->paused && h->pause_date != -1)
         {
+            hb_lock( h->state_lock );
             h->state.param.working.paused = h->pause_duration +
                                             hb_get_date() - h->pause_date;
+            hb_unlock( h->state_lock );
+            notify_state( h );
         }
-        hb_snooze( 50 );
     }
 
     if( h->scan_thread )
@@ -2387,8 +2972,14 @@ int hb_get_instance_id( hb_handle_t * h )
  */
 void hb_set_state( hb_handle_t * h, hb_state_t * s )
 {
+    int notify;
+
     hb_lock( h->pause_lock );
     hb_lock( h->state_lock );
+    // Progress is reported for every frame, only wake up state
+    // waiters for it every HB_STATE_NOTIFY_INTERVAL ms
+    notify = h->state.state != s->state ||
+             hb_get_date() - h->state_notify_date >= HB_STATE_NOTIFY_INTERVAL;
     memcpy( &h->state, s, sizeof( hb_state_t ) );
     if( h->state.state == HB_STATE_WORKING ||
         h->state.state == HB_STATE_SEARCHING )
@@ -2399,6 +2990,10 @@ void hb_set_state( hb_handle_t * h, hb_state_t * s )
     }
     hb_unlock( h->state_lock );
     hb_unlock( h->pause_lock );
+    if (notify)
+    {
+        notify_state( h );
+    }
 }
 
 void hb_set_work_error( hb_handle_t * h, hb_error_code err )
@@ -2422,6 +3017,11 @@ hb_interjob_t * hb_interjob_get( hb_handle_t * h )
     return h->interjob;
 }
 
+hb_ssa_cache_t * hb_ssa_cache_get( hb_handle_t * h )
+{
+    return h != NULL ? h->ssa_cache : NULL;
+}
+
 int hb_is_hardware_disabled(void)
 {
     return disable_hardware;
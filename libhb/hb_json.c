@@ -647,8 +647,9 @@ hb_dict_t* hb_job_to_dict( const hb_job_t * job )
     "s:{s:o, s:o, s:o, s:o},"
     // Audio {CopyMask, FallbackEncoder, AudioList []}
     "s:{s:[], s:o, s:[]},"
-    // Subtitles {Search {Enable, Forced, Default, Burn}, SubtitleList []}
-    "s:{s:{s:o, s:o, s:o, s:o}, s:[]},"
+    // Subtitles {Search {Enable, Forced, Default, Burn, SinglePass},
+    //            SubtitleList []}
+    "s:{s:{s:o, s:o, s:o, s:o, s:o}, s:[]},"
     // Metadata
     "s:o,"
     // Filters {FilterList []}
@@ -685,6 +686,7 @@ hb_dict_t* hb_job_to_dict( const hb_job_t * job )
                 "Forced",       hb_value_bool(job->select_subtitle_config.force),
                 "Default",      hb_value_bool(job->select_subtitle_config.default_track),
                 "Burn",         hb_value_bool(subtitle_search_burn),
+                "SinglePass",   hb_value_bool(job->select_subtitle_single_pass),
             "SubtitleList",
         "Metadata",             hb_value_dup(job->metadata->dict),
         "Filters",
@@ -896,6 +898,10 @@ hb_dict_t* hb_job_to_dict( const hb_job_t * job )
         hb_dict_set(video_dict, "MultiPass", hb_value_bool(job->multipass));
         hb_dict_set(video_dict, "Turbo",
                             hb_value_bool(job->fastanalysispass));
+        hb_dict_set(video_dict, "MultiPassCache",
+                            hb_value_int(job->multipass_cache));
+        hb_dict_set(video_dict, "ComplexityAnalysis",
+                            hb_value_bool(job->complexity_analysis));
     }
     hb_dict_set(video_dict, "PasshtruHDRDynamicMetadata",
                         hb_value_int(job->passthru_dynamic_hdr_metadata));
@@ -1175,8 +1181,7 @@ void hb_json_job_scan( hb_handle_t * h, const char * json_job )
     hb_get_state2(h, &state);
     while (state.state == HB_STATE_SCANNING)
     {
-        hb_snooze(50);
-        hb_get_state2(h, &state);
+        hb_wait_state2(h, &state, -1);
     }
     hb_value_free(&dict);
 }
@@ -1269,7 +1274,8 @@ hb_job_t* hb_dict_to_job( hb_handle_t * h, hb_dict_t *dict )
     // PAR {Num, Den}
     "s?{s:i, s:i},"
     // Video {Codec, Quality, Bitrate, Preset, Tune, Profile, Level, Options
-    //       MultiPass, Turbo, PasshtruHDRDynamicMetadata
+    //       MultiPass, Turbo, MultiPassCache, ComplexityAnalysis,
+    //       PasshtruHDRDynamicMetadata
     //       ColorInputFormat, ColorOutputFormat, ColorRange,
     //       ColorPrimaries, ColorTransfer, ColorMatrix, ChromaLocation,
     //       MasteringDisplayColorVolume,
@@ -1280,7 +1286,7 @@ hb_job_t* hb_dict_to_job( hb_handle_t * h, hb_dict_t *dict )
     //       ColorPrimariesOverride, ColorTransferOverride, ColorMatrixOverride,
     //       HardwareDecode, AdapterIndex, AsyncDepth
     "s:{s:o, s?F, s?i, s?s, s?s, s?s, s?s, s?s,"
-    "   s?b, s?b, s?i,"
+    "   s?b, s?b, s?i, s?b, s?i,"
     "   s?i, s?i, s?i,"
     "   s?i, s?i, s?i, s?i,"
     "   s?o,"
@@ -1292,8 +1298,9 @@ hb_job_t* hb_dict_to_job( hb_handle_t * h, hb_dict_t *dict )
     "   s?i, s?i, s?i},"
     // Audio {CopyMask, FallbackEncoder, AudioList}
     "s?{s?o, s?o, s?o},"
-    // Subtitle {Search {Enable, Forced, Default, Burn, ExternalFilename}, SubtitleList}
-    "s?{s?{s:b, s?b, s?b, s?b, s?s}, s?o},"
+    // Subtitle {Search {Enable, Forced, Default, Burn, ExternalFilename,
+    //                   SinglePass}, SubtitleList}
+    "s?{s?{s:b, s?b, s?b, s?b, s?s, s?b}, s?o},"
     // Metadata
     "s?o,"
     // Cover arts
@@ -1334,6 +1341,8 @@ hb_job_t* hb_dict_to_job( hb_handle_t * h, hb_dict_t *dict )
             "Options",              unpack_s(&video_options),
             "MultiPass",            unpack_b(&job->multipass),
             "Turbo",                unpack_b(&job->fastanalysispass),
+            "MultiPassCache",       unpack_i(&job->multipass_cache),
+            "ComplexityAnalysis",   unpack_b(&job->complexity_analysis),
             "PasshtruHDRDynamicMetadata", unpack_i(&passthru_dynamic_hdr_metadata),
             "ColorInputFormat",     unpack_i(&job->input_pix_fmt),
             "ColorOutputFormat",    unpack_i(&job->output_pix_fmt),
@@ -1364,6 +1373,7 @@ hb_job_t* hb_dict_to_job( hb_handle_t * h, hb_dict_t *dict )
                 "Default",          unpack_b(&job->select_subtitle_config.default_track),
                 "Burn",             unpack_b(&subtitle_search_burn),
                 "ExternalFilename", unpack_s(&subtitle_search_external_filename),
+                "SinglePass",       unpack_b(&job->select_subtitle_single_pass),
             "SubtitleList",         unpack_o(&subtitle_list),
         "Metadata",                 unpack_o(&meta_dict),
         "CoverArts",                unpack_o(&art_array),
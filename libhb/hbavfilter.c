@@ -35,6 +35,47 @@ struct hb_avfilter_graph_s
     hb_job_t         * job;
 };
 
+// Slice threads for a video graph.  Each filter of the job already runs
+// on its own thread, and the native filters below split frames across
+// all CPUs, so the CPUs are shared between the stages that do real work
+// instead of every graph spawning a full set of threads.
+static int avfilter_thread_count(hb_filter_init_t * init)
+{
+    hb_job_t * job = init->job;
+    int        stages = 0, ii;
+
+    if (job == NULL || init->hw_pix_fmt != AV_PIX_FMT_NONE)
+    {
+        return 1;
+    }
+
+    for (ii = 0; ii < hb_list_count(job->list_filter); ii++)
+    {
+        hb_filter_object_t * filter = hb_list_item(job->list_filter, ii);
+        if (filter->skip)
+        {
+            continue;
+        }
+        switch (filter->id)
+        {
+            case HB_FILTER_AVFILTER:
+            case HB_FILTER_NLMEANS:
+            case HB_FILTER_DECOMB:
+            case HB_FILTER_COMB_DETECT:
+            case HB_FILTER_UNSHARP:
+            case HB_FILTER_LAPSHARP:
+            case HB_FILTER_CHROMA_SMOOTH:
+            case HB_FILTER_COLORSPACE:
+                stages++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return MAX(1, hb_get_cpu_count() / MAX(1, stages));
+}
+
 hb_avfilter_graph_t *
 hb_avfilter_graph_init(hb_value_t * settings, hb_filter_init_t * init)
 {
@@ -65,6 +106,11 @@ hb_avfilter_graph_init(hb_value_t * settings, hb_filter_init_t * init)
         goto fail;
     }
 
+    graph->avgraph->thread_type = AVFILTER_THREAD_SLICE;
+    graph->avgraph->nb_threads  = avfilter_thread_count(init);
+    hb_deep_log(2, "avfilter: %d slice threads for graph '%s'",
+                graph->avgraph->nb_threads, graph->settings);
+
 #if HB_DEBUG_GRAPH
     avfilter_graph_set_auto_convert(graph->avgraph, AVFILTER_AUTO_CONVERT_NONE);
 #endif
@@ -533,6 +579,13 @@ void hb_avfilter_combine( hb_list_t * list)
             case HB_FILTER_FORMAT:
             {
                 settings = pv->avfilters;
+                if (settings == NULL && !filter->skip)
+                {
+                    // The alias processes frames itself (e.g. native
+                    // crop or colorspace), so the aliases that follow
+                    // must not be merged into a graph that runs before it
+                    avfilter = NULL;
+                }
             } break;
             default:
             {
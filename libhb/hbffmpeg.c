@@ -273,6 +273,83 @@ hb_buffer_t * hb_avframe_to_video_buffer(AVFrame *frame, AVRational time_base)
     return buf;
 }
 
+hb_buffer_t * hb_avpacket_to_buffer(const AVPacket *pkt)
+{
+    // Zero-copy path, the buffer keeps a reference to the packet data
+    hb_buffer_t *buf = hb_buffer_wrapper_init();
+
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    AVPacket *pkt_copy = av_packet_alloc();
+    if (pkt_copy == NULL)
+    {
+        hb_buffer_close(&buf);
+        return NULL;
+    }
+
+    if (av_packet_ref(pkt_copy, pkt) < 0)
+    {
+        hb_buffer_close(&buf);
+        av_packet_free(&pkt_copy);
+        return NULL;
+    }
+
+    buf->storage_type = AVPACKET;
+    buf->storage = pkt_copy;
+    buf->data = pkt_copy->data;
+    buf->size = pkt_copy->size;
+
+    return buf;
+}
+
+void hb_buffer_to_avpacket(AVPacket *pkt, hb_buffer_t **buf_in)
+{
+    hb_buffer_t *buf = *buf_in;
+
+    if (buf == NULL || buf->data == NULL)
+    {
+        return;
+    }
+
+    if (buf->storage_type == AVPACKET)
+    {
+        AVPacket *src = buf->storage;
+        if (src->buf != NULL)
+        {
+            pkt->buf = av_buffer_ref(src->buf);
+        }
+    }
+    else if (buf->storage_type == STANDARD)
+    {
+        // Hand the buffer over to libav, it is closed
+        // when the last reference goes away
+        pkt->buf = av_buffer_create(buf->data,
+                                    buf->alloc,
+                                    hb_buffer_close_callback,
+                                    buf,
+                                    0);
+    }
+
+    if (pkt->buf == NULL)
+    {
+        // Not refcounted, libav makes its own copy of the data
+        return;
+    }
+
+    pkt->data = buf->data;
+    pkt->size = buf->size;
+
+    if (buf->storage_type == AVPACKET)
+    {
+        hb_buffer_close(&buf);
+    }
+
+    *buf_in = NULL;
+}
+
 struct SwsContext*
 hb_sws_get_context(int srcW, int srcH, enum AVPixelFormat srcFormat, int srcRange,
                    int dstW, int dstH, enum AVPixelFormat dstFormat, int dstRange,
@@ -8,6 +8,7 @@
  */
 
 #include "handbrake/handbrake.h"
+#include "handbrake/motion_metric.h"
 
 #if defined (__aarch64__) && !defined(__APPLE__)
     #include <arm_neon.h>
@@ -20,13 +21,11 @@ struct hb_motion_metric_private_s
     int       bps;
     int       max_value;
 
+    int      fast;
     uint8_t *approx_buf_a;
     uint8_t *approx_buf_b;
 
-    float (*motion_metric)(hb_motion_metric_private_t *pv,
-                           int width, int height,
-                           int stride_a, int stride_b,
-                           const uint8_t *buf_a, const uint8_t *buf_b);
+    MotionMetricFunctions functions;
 };
 
 // Create gamma lookup table.
@@ -43,9 +42,13 @@ static void build_gamma_lut(hb_motion_metric_private_t *pv)
 
 #define APPROX(a, b, c, d) (((((uint32_t)a + b + 1) >> 1) + (((uint32_t)c + d + 1) >> 1) + 1) >> 1)
 #define APPROX_FRAME_DATA(nbits)                                                                        \
-static void approximate_frame_data##_##nbits(const uint##nbits##_t *source, uint##nbits##_t *dest,      \
+static void approximate_frame_data##_##nbits(const uint8_t *src, uint8_t *dst,                          \
                                              int source_stride, int dest_stride, int width, int height) \
 {                                                                                                       \
+    const uint##nbits##_t *source = (const uint##nbits##_t *)src;                                       \
+    uint##nbits##_t *dest = (uint##nbits##_t *)dst;                                                     \
+    source_stride /= sizeof(uint##nbits##_t);                                                           \
+    dest_stride   /= sizeof(uint##nbits##_t);                                                           \
     int stride2 = source_stride * 2;                                                                    \
     int stride3 = source_stride * 3;                                                                    \
     int jj4;                                                                                            \
@@ -78,11 +81,11 @@ APPROX_FRAME_DATA(16)
 // count less.
 #if defined (__aarch64__) && !defined(__APPLE__)
 
-#define DEF_MOTION_METRIC(nbits)                                                           \
-static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,                       \
-                                     int width, int height,                                \
-                                     int stride_a, int stride_b,                           \
-                                     const uint8_t *a, const uint8_t *b)                   \
+#define DEF_SSE(nbits)                                                                     \
+static uint64_t sse##_##nbits(const unsigned *gamma_lut,                                   \
+                              int width, int height,                                       \
+                              int stride_a, int stride_b,                                  \
+                              const uint8_t *a, const uint8_t *b)                          \
 {                                                                                          \
     int bw, bh;                                                                            \
     uint##nbits##_t *buf_a, *buf_b;                                                        \
@@ -91,6 +94,8 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
     buf_b     = (uint##nbits##_t *)b;                                                      \
     bw        = width / 16;                                                                \
     bh        = height / 16;                                                               \
+    stride_a /= sizeof(uint##nbits##_t);                                                   \
+    stride_b /= sizeof(uint##nbits##_t);                                                   \
                                                                                            \
     uint64_t sum = 0;                                                                      \
     for (int y = 0; y < bh; y++)                                                           \
@@ -105,8 +110,8 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
                 uint32_t arrgb[16];                                                        \
                 for (int xx = 0; xx < 16; xx++)                                            \
                 {                                                                          \
-                    arrga[xx] = pv->gamma_lut[ra[xx]];                                     \
-                    arrgb[xx] = pv->gamma_lut[rb[xx]];                                     \
+                    arrga[xx] = gamma_lut[ra[xx]];                                         \
+                    arrgb[xx] = gamma_lut[rb[xx]];                                         \
                 }                                                                          \
                 uint32x4_t vga0 = vld1q_u32(arrga);                                        \
                 uint32x4_t vga1 = vld1q_u32(arrga + 4);                                    \
@@ -133,13 +138,13 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
             }                                                                              \
         }                                                                                  \
     }                                                                                      \
-    return (float)sum / (width * height);                                                  \
+    return sum;                                                                            \
 }                                                                                          \
 
 #else
 
 #define DEF_SSE_BLOCK16(nbits)                                                         \
-static inline unsigned sse_block16##_##nbits(unsigned *gamma_lut,                      \
+static inline unsigned sse_block16##_##nbits(const unsigned *gamma_lut,                \
                                    const uint##nbits##_t *a, const uint##nbits##_t *b, \
                                    int stride_a, int stride_b)                         \
 {                                                                                      \
@@ -162,11 +167,11 @@ DEF_SSE_BLOCK16(16)
 
 // Sum of squared errors.  Computes and sums the SSEs for all
 // 16x16 blocks in the images.  Only checks the Y component.
-#define DEF_MOTION_METRIC(nbits)                                                            \
-static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,                        \
-                                     int width, int height,                                 \
-                                     int stride_a, int stride_b,                            \
-                                     const uint8_t *a, const uint8_t *b)                    \
+#define DEF_SSE(nbits)                                                                      \
+static uint64_t sse##_##nbits(const unsigned *gamma_lut,                                    \
+                              int width, int height,                                        \
+                              int stride_a, int stride_b,                                   \
+                              const uint8_t *a, const uint8_t *b)                           \
 {                                                                                           \
                                                                                             \
     int bw, bh;                                                                             \
@@ -176,55 +181,27 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
     buf_b     = (uint##nbits##_t *)b;                                                       \
     bw        = width / 16;                                                                 \
     bh        = height / 16;                                                                \
-    stride_a /= pv->bps;                                                                    \
-    stride_b /= pv->bps;                                                                    \
+    stride_a /= sizeof(uint##nbits##_t);                                                    \
+    stride_b /= sizeof(uint##nbits##_t);                                                    \
                                                                                             \
     uint64_t sum = 0;                                                                       \
     for (int y = 0; y < bh; y++)                                                            \
     {                                                                                       \
         for (int x = 0; x < bw; x++)                                                        \
         {                                                                                   \
-            sum += sse_block16##_##nbits(pv->gamma_lut,                                     \
+            sum += sse_block16##_##nbits(gamma_lut,                                         \
                         buf_a + y * 16 * stride_a + x * 16,                                 \
                         buf_b + y * 16 * stride_b + x * 16,                                 \
                         stride_a, stride_b);                                                \
         }                                                                                   \
     }                                                                                       \
-    return (float)sum / (width * height);                                                   \
+    return sum;                                                                             \
 }                                                                                           \
 
 #endif
 
-DEF_MOTION_METRIC(8)
-DEF_MOTION_METRIC(16)
-
-#define DEF_MOTION_METRIC_FAST(nbits)                                                       \
-static float motion_metric_fast##_##nbits(hb_motion_metric_private_t *pv,                   \
-                                     int width, int height,                                 \
-                                     int stride_a, int stride_b,                            \
-                                     const uint8_t *a, const uint8_t *b)                    \
-{                                                                                           \
-    uint##nbits##_t *buf_a, *buf_b;                                                         \
-    int stride_buf_a, stride_buf_b;                                                         \
-    width  /= 4;                                                                            \
-    height /= 4;                                                                            \
-    stride_buf_a = width;                                                                   \
-    stride_buf_b = width;                                                                   \
-    buf_a = (uint##nbits##_t *)pv->approx_buf_a;                                            \
-    buf_b = (uint##nbits##_t *)pv->approx_buf_b;                                            \
-                                                                                            \
-    approximate_frame_data##_##nbits((const uint##nbits##_t *)a, buf_a,                     \
-                                     stride_a / pv->bps, stride_buf_a, width, height);      \
-    approximate_frame_data##_##nbits((const uint##nbits##_t *)b, buf_b,                     \
-                                     stride_b / pv->bps, stride_buf_b, width, height);      \
-                                                                                            \
-    return motion_metric##_##nbits(pv, width, height,                                       \
-                                   stride_buf_a, stride_buf_b,                              \
-                                   (const uint8_t *)buf_a, (const uint8_t *)buf_b);         \
-}                                                                                           \
-
-DEF_MOTION_METRIC_FAST(8)
-DEF_MOTION_METRIC_FAST(16)
+DEF_SSE(8)
+DEF_SSE(16)
 
 static int hb_motion_metric_init(hb_motion_metric_object_t *metric,
                                  hb_filter_init_t *init)
@@ -250,10 +227,9 @@ static int hb_motion_metric_init(hb_motion_metric_object_t *metric,
     }
     build_gamma_lut(pv);
 
-    int fast = 0;
     if (init->geometry.width >= 1920 || init->geometry.height >= 1080)
     {
-        fast = 1;
+        pv->fast = 1;
         int approx_height = init->geometry.height / 4;
         int approx_width  = init->geometry.width  / 4;
         int size = approx_height * approx_width * sizeof(uint8_t) * pv->bps;
@@ -269,11 +245,16 @@ static int hb_motion_metric_init(hb_motion_metric_object_t *metric,
     switch (pv->depth)
     {
         case 8:
-            pv->motion_metric = fast ? motion_metric_fast_8 : motion_metric_8;
+            pv->functions.sse         = sse_8;
+            pv->functions.approximate = approximate_frame_data_8;
             break;
         default:
-            pv->motion_metric = fast ? motion_metric_fast_16 : motion_metric_16;
+            pv->functions.sse         = sse_16;
+            pv->functions.approximate = approximate_frame_data_16;
     }
+#if defined(ARCH_X86)
+    motion_metric_init_x86(&pv->functions, pv->depth);
+#endif
 
     return 0;
 }
@@ -284,10 +265,29 @@ static float hb_motion_metric_work(hb_motion_metric_object_t *metric,
 {
     hb_motion_metric_private_t *pv = metric->private_data;
 
-    return pv->motion_metric(metric->private_data,
-                             buf_a->f.width, buf_a->f.height,
-                             buf_a->plane[0].stride, buf_b->plane[0].stride,
-                             buf_a->plane[0].data, buf_b->plane[0].data);
+    int            width    = buf_a->f.width;
+    int            height   = buf_a->f.height;
+    int            stride_a = buf_a->plane[0].stride;
+    int            stride_b = buf_b->plane[0].stride;
+    const uint8_t *a        = buf_a->plane[0].data;
+    const uint8_t *b        = buf_b->plane[0].data;
+
+    if (pv->fast)
+    {
+        width  /= 4;
+        height /= 4;
+        pv->functions.approximate(a, pv->approx_buf_a,
+                                  stride_a, width * pv->bps, width, height);
+        pv->functions.approximate(b, pv->approx_buf_b,
+                                  stride_b, width * pv->bps, width, height);
+        a        = pv->approx_buf_a;
+        b        = pv->approx_buf_b;
+        stride_a = stride_b = width * pv->bps;
+    }
+
+    uint64_t sum = pv->functions.sse(pv->gamma_lut, width, height,
+                                     stride_a, stride_b, a, b);
+    return (float)sum / (width * height);
 }
 
 static void hb_motion_metric_close(hb_motion_metric_object_t *metric)
@@ -243,49 +243,141 @@ static int set_extradata(hb_data_t *extradata, uint8_t **priv_data, int *priv_si
     return 0;
 }
 
-/**********************************************************************
- * avformatInit
- **********************************************************************
- * Allocates hb_mux_data_t structures, create file and write headers
- *********************************************************************/
-static int avformatInit( hb_mux_object_t * m )
+/*
+ * Creates the stream for a passthru subtitle track in oc.
+ * Returns 0 on success, 1 if the subtitle source can not be muxed
+ * and -1 on error.
+ */
+static int init_subtitle_track( hb_mux_object_t * m, hb_mux_data_t * track,
+                                AVFormatContext * oc, hb_subtitle_t * subtitle,
+                                int is_default, uint8_t * need_fonts )
 {
-    hb_job_t   * job   = m->job;
-    hb_audio_t    * audio;
-    hb_mux_data_t * track;
-    int meta_mux;
-    int max_tracks;
-    int ii, jj, ret;
+    hb_job_t * job = m->job;
 
-    int clock_min, clock_max, clock;
-    hb_video_framerate_get_limits(&clock_min, &clock_max, &clock);
+    track->type = MUX_TYPE_SUBTITLE;
+    track->st = avformat_new_stream(oc, NULL);
+    if (track->st == NULL)
+    {
+        hb_error("Could not initialize subtitle stream");
+        return -1;
+    }
 
-    const char *muxer_name = NULL;
+    track->st->codecpar->codec_type = AVMEDIA_TYPE_SUBTITLE;
+    track->st->time_base = m->time_base;
+    track->st->codecpar->width = subtitle->width;
+    track->st->codecpar->height = subtitle->height;
 
-    uint8_t         default_track_flag = 1;
-    uint8_t         need_fonts = 0;
-    char *lang;
+    int need_extradata = 0;
+    switch (subtitle->source)
+    {
+        case VOBSUB:
+        {
+            track->st->codecpar->codec_id = AV_CODEC_ID_DVD_SUBTITLE;
+            need_extradata = 1;
+        } break;
 
-    m->pkt = av_packet_alloc();
-    m->empty_pkt = av_packet_alloc();
+        case PGSSUB:
+        {
+            track->st->codecpar->codec_id = AV_CODEC_ID_HDMV_PGS_SUBTITLE;
+        } break;
 
-    if (m->pkt == NULL || m->empty_pkt == NULL)
+        case DVBSUB:
+        {
+            track->st->codecpar->codec_id = AV_CODEC_ID_DVB_SUBTITLE;
+            need_extradata = 1;
+        } break;
+
+        case CC608SUB:
+        case CC708SUB:
+        case SSASUB:
+        case IMPORTSSA:
+        {
+            if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) &&
+                subtitle->config.external_filename == NULL)
+            {
+                track->st->codecpar->codec_id = AV_CODEC_ID_MOV_TEXT;
+                track->st->codecpar->codec_tag = MKTAG('t','x','3','g');
+            }
+            else
+            {
+                track->st->codecpar->codec_id = AV_CODEC_ID_ASS;
+                *need_fonts = 1;
+            }
+            need_extradata = 1;
+        } break;
+
+        case TX3GSUB:
+        case UTF8SUB:
+        case IMPORTSRT:
+        {
+            if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) &&
+                subtitle->config.external_filename == NULL)
+            {
+                track->st->codecpar->codec_id = AV_CODEC_ID_MOV_TEXT;
+                track->st->codecpar->codec_tag = MKTAG('t','x','3','g');
+            }
+            else
+            {
+                track->st->codecpar->codec_id = AV_CODEC_ID_SUBRIP;
+            }
+            need_extradata = 1;
+        } break;
+
+        default:
+            return 1;
+    }
+
+    if (need_extradata)
     {
-        hb_error("muxavformat: av_packet_alloc failed");
-        goto error;
+        if (set_extradata(subtitle->extradata,
+                          &track->st->codecpar->extradata,
+                          &track->st->codecpar->extradata_size))
+        {
+            return -1;
+        }
     }
 
-    max_tracks = 1 + hb_list_count( job->list_audio ) +
-                     hb_list_count( job->list_subtitle );
-    m->tracks = calloc(max_tracks, sizeof(hb_mux_data_t*));
+    if (is_default)
+    {
+        track->st->disposition |= AV_DISPOSITION_DEFAULT;
+    }
+    if (subtitle->config.default_track)
+    {
+        track->st->disposition |= AV_DISPOSITION_FORCED;
+    }
 
-    if (m->tracks == NULL)
+    char * lang = lookup_lang_code(job->mux, subtitle->iso639_2 );
+    if (lang != NULL)
     {
-        hb_error("muxavformat: calloc failed");
-        goto error;
+        av_dict_set(&track->st->metadata, "language", lang, 0);
+    }
+    if (subtitle->config.name != NULL && subtitle->config.name[0] != 0)
+    {
+        // Set subtitle track title
+        av_dict_set(&track->st->metadata, "title",
+                    subtitle->config.name, 0);
+        if (job->mux == HB_MUX_AV_MP4)
+        {
+            // Some software (MPC, mediainfo) use hdlr description
+            // for track title
+            av_dict_set(&track->st->metadata, "handler_name",
+                        subtitle->config.name, 0);
+        }
     }
 
-    AVDictionary * av_opts = NULL;
+    return 0;
+}
+
+/*
+ * Selects the libavformat muxer, its options and timebase for job->mux.
+ * Returns the muxer name, or NULL for an invalid mux.
+ */
+static const char * init_format( hb_mux_object_t * m, int * meta_mux,
+                                 AVDictionary ** av_opts )
+{
+    hb_job_t   * job        = m->job;
+    const char * muxer_name = NULL;
+
     switch (job->mux)
     {
         case HB_MUX_AV_MP4:
@@ -295,27 +387,27 @@ static int avformatInit( hb_mux_object_t * m )
                 muxer_name = "ipod";
             else
                 muxer_name = "mp4";
-            meta_mux = META_MUX_MP4;
+            *meta_mux = META_MUX_MP4;
 
-            av_dict_set(&av_opts, "brand", "mp42", 0);
-            av_dict_set(&av_opts, "strict", "experimental", 0);
+            av_dict_set(av_opts, "brand", "mp42", 0);
+            av_dict_set(av_opts, "strict", "experimental", 0);
             if (job->optimize)
-                av_dict_set(&av_opts, "movflags", "faststart+disable_chpl+write_colr", 0);
+                av_dict_set(av_opts, "movflags", "faststart+disable_chpl+write_colr", 0);
             else
-                av_dict_set(&av_opts, "movflags", "+disable_chpl+write_colr", 0);
+                av_dict_set(av_opts, "movflags", "+disable_chpl+write_colr", 0);
             break;
 
         case HB_MUX_AV_MOV:
             m->time_base.num = 1;
             m->time_base.den = 90000;
             muxer_name = "mov";
-            meta_mux = META_MUX_MOV;
+            *meta_mux = META_MUX_MOV;
 
-            av_dict_set(&av_opts, "strict", "experimental", 0);
+            av_dict_set(av_opts, "strict", "experimental", 0);
             if (job->optimize)
-                av_dict_set(&av_opts, "movflags", "faststart+disable_chpl+write_colr+negative_cts_offsets", 0);
+                av_dict_set(av_opts, "movflags", "faststart+disable_chpl+write_colr+negative_cts_offsets", 0);
             else
-                av_dict_set(&av_opts, "movflags", "+disable_chpl+write_colr+negative_cts_offsets", 0);
+                av_dict_set(av_opts, "movflags", "+disable_chpl+write_colr+negative_cts_offsets", 0);
             break;
 
         case HB_MUX_AV_MKV:
@@ -324,8 +416,8 @@ static int avformatInit( hb_mux_object_t * m )
             m->time_base.num = 1;
             m->time_base.den = 1000;
             muxer_name = "matroska";
-            meta_mux = META_MUX_MKV;
-            av_dict_set(&av_opts, "default_mode", "passthrough", 0);
+            *meta_mux = META_MUX_MKV;
+            av_dict_set(av_opts, "default_mode", "passthrough", 0);
             break;
 
         case HB_MUX_AV_WEBM:
@@ -334,17 +426,69 @@ static int avformatInit( hb_mux_object_t * m )
             m->time_base.num = 1;
             m->time_base.den = 1000;
             muxer_name = "webm";
-            meta_mux = META_MUX_WEBM;
-            av_dict_set(&av_opts, "default_mode", "passthrough", 0);
+            *meta_mux = META_MUX_WEBM;
+            av_dict_set(av_opts, "default_mode", "passthrough", 0);
             break;
 
         default:
         {
             hb_error("Invalid Mux %x", job->mux);
-            goto error;
+            return NULL;
         }
     }
 
+    return muxer_name;
+}
+
+/**********************************************************************
+ * avformatInit
+ **********************************************************************
+ * Allocates hb_mux_data_t structures, create file and write headers
+ *********************************************************************/
+static int avformatInit( hb_mux_object_t * m )
+{
+    hb_job_t   * job   = m->job;
+    hb_audio_t    * audio;
+    hb_mux_data_t * track;
+    int meta_mux;
+    int max_tracks;
+    int ii, jj, ret;
+
+    int clock_min, clock_max, clock;
+    hb_video_framerate_get_limits(&clock_min, &clock_max, &clock);
+
+    const char *muxer_name = NULL;
+
+    uint8_t         default_track_flag = 1;
+    uint8_t         need_fonts = 0;
+    char *lang;
+
+    m->pkt = av_packet_alloc();
+    m->empty_pkt = av_packet_alloc();
+
+    if (m->pkt == NULL || m->empty_pkt == NULL)
+    {
+        hb_error("muxavformat: av_packet_alloc failed");
+        goto error;
+    }
+
+    max_tracks = 1 + hb_list_count( job->list_audio ) +
+                     hb_list_count( job->list_subtitle );
+    m->tracks = calloc(max_tracks, sizeof(hb_mux_data_t*));
+
+    if (m->tracks == NULL)
+    {
+        hb_error("muxavformat: calloc failed");
+        goto error;
+    }
+
+    AVDictionary * av_opts = NULL;
+    muxer_name = init_format(m, &meta_mux, &av_opts);
+    if (muxer_name == NULL)
+    {
+        goto error;
+    }
+
     ret = avformat_alloc_output_context2(&m->oc, NULL, muxer_name, job->file);
     if (ret < 0)
     {
@@ -942,24 +1086,68 @@ static int avformatInit( hb_mux_object_t * m )
     }
 
     int subtitle_default = -1;
+    int search_default   = 0;
+    hb_subtitle_t * search = NULL;
     for( ii = 0; ii < hb_list_count( job->list_subtitle ); ii++ )
     {
         hb_subtitle_t *subtitle = hb_list_item( job->list_subtitle, ii );
 
-        if( subtitle->config.dest == PASSTHRUSUB )
+        if (subtitle->search_candidate)
+        {
+            if (search == NULL)
+                search = subtitle;
+        }
+        else if( subtitle->config.dest == PASSTHRUSUB )
         {
             if ( subtitle->config.default_track )
                 subtitle_default = ii;
         }
     }
+    if (search != NULL && job->select_subtitle_config.default_track)
+    {
+        // The foreign audio search track replaces the default
+        search_default   = 1;
+        subtitle_default = -1;
+    }
     // Quicktime requires that at least one subtitle is enabled,
     // else it doesn't show any of the subtitles.
     // So check to see if any of the subtitles are flagged to be
     // the default.  The default will be the enabled track, else
     // enable the first track.
-    if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) && subtitle_default == -1)
+    else if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) && subtitle_default == -1)
     {
         subtitle_default = 0;
+        if (search == hb_list_item(job->list_subtitle, 0))
+        {
+            search_default = 1;
+        }
+    }
+
+    if (search != NULL)
+    {
+        // Foreign audio search candidates share one stream, in front of
+        // the other subtitle tracks.  The selected candidate is written
+        // to it at the end of the encode, MP4 leaves it out if there is
+        // none.  hb_job_setup_passes() made sure the candidates fit it.
+        hb_subtitle_t tmpl = *search;
+
+        tmpl.config = job->select_subtitle_config;
+        track = m->tracks[m->ntracks++] = calloc(1, sizeof( hb_mux_data_t ) );
+        if (init_subtitle_track(m, track, m->oc, &tmpl,
+                                search_default, &need_fonts) != 0)
+        {
+            hb_error("muxavformat: can not mux foreign audio search source %d",
+                     search->source);
+            goto error;
+        }
+        for (ii = 0; ii < hb_list_count(job->list_subtitle); ii++)
+        {
+            hb_subtitle_t * subtitle = hb_list_item(job->list_subtitle, ii);
+            if (subtitle->search_candidate)
+            {
+                subtitle->mux_data = track;
+            }
+        }
     }
 
     for( ii = 0; ii < hb_list_count( job->list_subtitle ); ii++ )
@@ -969,7 +1157,7 @@ static int avformatInit( hb_mux_object_t * m )
         const char      * subtitle_muxer_name = NULL;
 
         subtitle = hb_list_item( job->list_subtitle, ii );
-        if (subtitle->config.dest != PASSTHRUSUB)
+        if (subtitle->config.dest != PASSTHRUSUB || subtitle->search_candidate)
             continue;
 
         track = m->tracks[m->ntracks++] = calloc(1, sizeof( hb_mux_data_t ) );
@@ -1006,115 +1194,15 @@ static int avformatInit( hb_mux_object_t * m )
             oc = m->oc;
         }
 
-        track->type = MUX_TYPE_SUBTITLE;
-        track->st = avformat_new_stream(oc, NULL);
-        if (track->st == NULL)
+        ret = init_subtitle_track(m, track, oc, subtitle,
+                                  ii == subtitle_default, &need_fonts);
+        if (ret < 0)
         {
-            hb_error("Could not initialize subtitle stream");
             goto error;
         }
-
-        track->st->codecpar->codec_type = AVMEDIA_TYPE_SUBTITLE;
-        track->st->time_base = m->time_base;
-        track->st->codecpar->width = subtitle->width;
-        track->st->codecpar->height = subtitle->height;
-
-        int need_extradata = 0;
-        switch (subtitle->source)
+        else if (ret > 0)
         {
-            case VOBSUB:
-            {
-                track->st->codecpar->codec_id = AV_CODEC_ID_DVD_SUBTITLE;
-                need_extradata = 1;
-            } break;
-
-            case PGSSUB:
-            {
-                track->st->codecpar->codec_id = AV_CODEC_ID_HDMV_PGS_SUBTITLE;
-            } break;
-
-            case DVBSUB:
-            {
-                track->st->codecpar->codec_id = AV_CODEC_ID_DVB_SUBTITLE;
-                need_extradata = 1;
-            } break;
-
-            case CC608SUB:
-            case CC708SUB:
-            case SSASUB:
-            case IMPORTSSA:
-            {
-                if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) &&
-                    subtitle->config.external_filename == NULL)
-                {
-                    track->st->codecpar->codec_id = AV_CODEC_ID_MOV_TEXT;
-                    track->st->codecpar->codec_tag = MKTAG('t','x','3','g');
-                }
-                else
-                {
-                    track->st->codecpar->codec_id = AV_CODEC_ID_ASS;
-                    need_fonts = 1;
-                }
-                need_extradata = 1;
-            } break;
-
-            case TX3GSUB:
-            case UTF8SUB:
-            case IMPORTSRT:
-            {
-                if ((job->mux & HB_MUX_MASK_ISOBFF_FAMILY) &&
-                    subtitle->config.external_filename == NULL)
-                {
-                    track->st->codecpar->codec_id = AV_CODEC_ID_MOV_TEXT;
-                    track->st->codecpar->codec_tag = MKTAG('t','x','3','g');
-                }
-                else
-                {
-                    track->st->codecpar->codec_id = AV_CODEC_ID_SUBRIP;
-                }
-                need_extradata = 1;
-            } break;
-
-            default:
-                continue;
-        }
-
-        if (need_extradata)
-        {
-            if (set_extradata(subtitle->extradata,
-                              &track->st->codecpar->extradata,
-                              &track->st->codecpar->extradata_size))
-            {
-                goto error;
-            }
-        }
-
-        if (ii == subtitle_default)
-        {
-            track->st->disposition |= AV_DISPOSITION_DEFAULT;
-        }
-        if (subtitle->config.default_track)
-        {
-            track->st->disposition |= AV_DISPOSITION_FORCED;
-        }
-
-        lang = lookup_lang_code(job->mux, subtitle->iso639_2 );
-        if (lang != NULL)
-        {
-            av_dict_set(&track->st->metadata, "language", lang, 0);
-        }
-        if (subtitle->config.name != NULL && subtitle->config.name[0] != 0)
-        {
-            // Set subtitle track title
-            av_dict_set(&track->st->metadata, "title",
-                        subtitle->config.name, 0);
-            if (job->mux == HB_MUX_AV_MP4)
-            {
-                // Some software (MPC, mediainfo) use hdlr description
-                // for track title
-                av_dict_set(&track->st->metadata, "handler_name",
-                            subtitle->config.name, 0);
-            }
+            continue;
         }
     }
 
@@ -1602,6 +1690,11 @@ static int avformatMux(hb_mux_object_t *m, hb_mux_data_t *track, hb_buffer_t *bu
     }
     track->duration = pts + m->pkt->duration;
 
+    // Pass the payload by reference, otherwise libav copies
+    // every packet it queues for interleaving or filtering.
+    // On success buf is owned by the packet and set to NULL.
+    hb_buffer_to_avpacket(m->pkt, &buf);
+
     if (track->bitstream_context)
     {
         int ret;
@@ -1610,6 +1703,8 @@ static int avformatMux(hb_mux_object_t *m, hb_mux_data_t *track, hb_buffer_t *bu
         {
             hb_error("avformatMux: track %d av_bsf_send_packet failed",
                      track->st->index);
+            av_packet_unref(m->pkt);
+            hb_buffer_close(&buf);
             return ret;
         }
         ret = av_bsf_receive_packet(track->bitstream_context, m->pkt);
@@ -7,6 +7,7 @@
    For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
  */
 #include "handbrake/handbrake.h"
+#include "handbrake/decavsub.h"
 
 #define MIN_BUFFERING (1024*1024*10)
 #define MAX_BUFFERING (1024*1024*50)
@@ -37,8 +38,19 @@ typedef struct
     uint64_t        bytes;
     mux_fifo_t      mf;
     int             buffered_size;
+    hb_subtitle_t * search;       // foreign audio search candidate
+    FILE          * search_spool; // candidate bufs, muxed after selection
+    char          * search_spool_name;
 } hb_track_t;
 
+// Record of a spooled foreign audio search subtitle, followed by
+// size bytes of data
+typedef struct
+{
+    hb_buffer_settings_t s;
+    int                  size;
+} search_spool_record_t;
+
 typedef struct
 {
     hb_lock_t       * mutex;
@@ -365,6 +377,67 @@ static void OutputTrackChunk( hb_mux_t *mux, int tk, hb_mux_object_t *m )
     }
 }
 
+static void search_spool_close( hb_track_t * track )
+{
+    if (track->search_spool != NULL)
+    {
+        fclose(track->search_spool);
+        track->search_spool = NULL;
+    }
+    if (track->search_spool_name != NULL)
+    {
+        remove(track->search_spool_name);
+        free(track->search_spool_name);
+        track->search_spool_name = NULL;
+    }
+}
+
+static void search_spool_write( hb_track_t * track, const hb_buffer_t * buf )
+{
+    search_spool_record_t rec;
+
+    if (track->search_spool == NULL)
+    {
+        return;
+    }
+    memset(&rec, 0, sizeof(rec));
+    rec.s    = buf->s;
+    rec.size = buf->size;
+    if (fwrite(&rec, sizeof(rec), 1, track->search_spool) != 1 ||
+        (buf->size > 0 &&
+         fwrite(buf->data, buf->size, 1, track->search_spool) != 1))
+    {
+        hb_error("mux: could not spool foreign audio search track %d, "
+                 "it can not be selected", track->search->track);
+        search_spool_close(track);
+    }
+}
+
+static hb_buffer_t * search_spool_read( hb_track_t * track )
+{
+    search_spool_record_t   rec;
+    hb_buffer_t           * buf;
+
+    if (fread(&rec, sizeof(rec), 1, track->search_spool) != 1)
+    {
+        return NULL;
+    }
+    buf = hb_buffer_init(rec.size);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+    if (rec.size > 0 &&
+        fread(buf->data, rec.size, 1, track->search_spool) != 1)
+    {
+        hb_error("mux: foreign audio search spool is truncated");
+        hb_buffer_close(&buf);
+        return NULL;
+    }
+    buf->s = rec.s;
+    return buf;
+}
+
 static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
                      hb_buffer_t ** buf_out )
 {
@@ -382,6 +455,13 @@ static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
         return HB_WORK_DONE;
     }
 
+    if (job->pass_cache != NULL && pv->track > 0)
+    {
+        // Encoded audio and subtitles are replayed from the cache
+        // in the final pass, video is stored before the encoder
+        hb_pass_cache_write(job->pass_cache, pv->track, buf);
+    }
+
     if (buf->s.flags & HB_BUF_FLAG_EOF)
     {
         // EOF - mark this track as done
@@ -395,6 +475,13 @@ static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
     {
         hb_buffer_close( &buf );
     }
+    else if (mux->track[pv->track]->search != NULL)
+    {
+        // The track can only be muxed once foreign audio search
+        // has selected it, after the encode is done
+        search_spool_write(mux->track[pv->track], buf);
+        hb_buffer_close( &buf );
+    }
     else
     {
         MoveToInternalFifos( pv->track, mux, buf );
@@ -494,6 +581,87 @@ static void muxFlush(hb_mux_t * mux)
     }
 }
 
+// Select the foreign audio search track among the candidates that
+// were spooled during the encode and write it to the stream that the
+// muxer reserved for it.  Must be called before the muxer is closed.
+static void mux_subtitle_search( hb_job_t * job, hb_mux_t * mux )
+{
+    hb_list_t     * list_search = hb_list_init();
+    hb_track_t    * track = NULL;
+    hb_subtitle_t * subtitle;
+    hb_buffer_t   * buf;
+    int             i, seen_forced_sub = 0;
+
+    for (i = 0; i < mux->ntracks; i++)
+    {
+        if (mux->track[i]->search != NULL &&
+            mux->track[i]->search_spool != NULL)
+        {
+            hb_list_add(list_search, mux->track[i]->search);
+        }
+    }
+    subtitle = hb_subtitle_search_select(list_search,
+                                         job->select_subtitle_config.force);
+    hb_list_close(&list_search);
+    if (subtitle == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < mux->ntracks; i++)
+    {
+        if (mux->track[i]->search == subtitle)
+        {
+            track = mux->track[i];
+        }
+    }
+
+    /* Disable forced subtitles if we didn't find any, so that
+     * we display normal subtitles instead. */
+    int force = job->select_subtitle_config.force && subtitle->forced_hits > 0;
+
+    /* Skip the selected track if it duplicates a track that is already
+     * in the output, see sanitize_subtitles() */
+    for (i = 0; i < hb_list_count(job->list_subtitle); i++)
+    {
+        hb_subtitle_t * other = hb_list_item(job->list_subtitle, i);
+
+        if (other->search_candidate ||
+            other->config.dest != PASSTHRUSUB || other->id != subtitle->id)
+        {
+            continue;
+        }
+        if (other->config.force == force ||
+            (!other->config.force && subtitle->hits == subtitle->forced_hits))
+        {
+            hb_log("mux: foreign audio search track %d is already in the output",
+                   subtitle->track);
+            return;
+        }
+    }
+
+    hb_log("mux: adding foreign audio search track %d (id 0x%x)%s",
+           subtitle->track, subtitle->id, force ? ", Forced Only" : "");
+
+    rewind(track->search_spool);
+    while ((buf = search_spool_read(track)) != NULL)
+    {
+        if (force)
+        {
+            buf = decavsubForcedOnly(buf, subtitle->source, &seen_forced_sub);
+        }
+        if (buf != NULL)
+        {
+            track->frames += 1;
+            track->bytes  += buf->size;
+            if (mux->m->mux(mux->m, track->mux_data, buf) < 0)
+            {
+                break;
+            }
+        }
+    }
+}
+
 static void muxClose( hb_work_object_t * muxer )
 {
     hb_work_private_t * pv = muxer->private_data;
@@ -537,6 +705,11 @@ static void muxClose( hb_work_object_t * muxer )
 
     if( mux->m )
     {
+        if (job->select_subtitle_single_pass &&
+            *job->done_error == HB_ERROR_NONE && !*job->die)
+        {
+            mux_subtitle_search(job, mux);
+        }
         mux->m->end( mux->m );
         free( mux->m );
     }
@@ -590,6 +763,7 @@ static void muxClose( hb_work_object_t * muxer )
         {
             hb_buffer_close( &b );
         }
+        search_spool_close(track);
         free(track->mf.fifo);
         free(track);
     }
@@ -739,6 +913,23 @@ static int muxInit( hb_work_object_t * muxer, hb_job_t * job )
             w->private_data->track = mux->ntracks;
             w->fifo_in = subtitle->fifo_out;
             err = add_mux_track(mux, subtitle->mux_data, 0);
+            if (!err && subtitle->search_candidate)
+            {
+                // Candidates are spooled to a file till the encode is done
+                hb_track_t * track = mux->track[mux->ntracks - 1];
+
+                track->search = subtitle;
+                track->search_spool_name =
+                    hb_get_temporary_filename("search_%d_%d.sub",
+                                              job->sequence_id, subtitle->track);
+                track->search_spool = hb_fopen(track->search_spool_name, "w+b");
+                if (track->search_spool == NULL)
+                {
+                    hb_error("mux: could not create %s",
+                             track->search_spool_name);
+                    err = -1;
+                }
+            }
             hb_list_add(pv->list_work, w);
         }
         if (w->private_data == NULL || err == -1)
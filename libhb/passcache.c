@@ -0,0 +1,887 @@
+/* passcache.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/*
+ * Multi-pass cache
+ *
+ * The first analysis pass of a multi-pass encode stores everything that
+ * reaches the video encoder (filtered frames) and the muxer (encoded audio
+ * and passthru subtitles) in a temporary file.  The final pass replays
+ * that file instead of reading, decoding, synchronizing and filtering the
+ * source again.
+ *
+ * Video frames are compressed losslessly with FFV1, so the final pass
+ * encodes exactly the frames the analysis pass did.  The cache is still
+ * limited to job->multipass_cache MiB.  If the output of the analysis pass
+ * does not fit, the cache is dropped and the final pass runs the full
+ * pipeline.
+ *
+ * The cache is only replayed for a final pass with the same source,
+ * range, filters and output geometry as the analysis pass.
+ */
+
+#include "handbrake/handbrake.h"
+
+struct hb_pass_cache_s
+{
+    hb_lock_t * lock;
+    char      * filename;
+    FILE      * file;
+    char      * setup;
+    int64_t     size;
+    int64_t     raw_size;
+    int64_t     max_size;
+    int         ntracks;
+    int         failed;
+    int         complete;
+    int         frame_count;
+    int         nb_extradata;
+    hb_data_t ** extradata;
+
+    // FFV1 global header, needed to decode the video frames
+    hb_data_t * video_extradata;
+};
+
+// Record header, followed by the buffer data (an FFV1 packet
+// for video frames) and nb_side_data
+// pass_cache_side_data_t headers each followed by their data.
+typedef struct
+{
+    int                  track;
+    int                  size;
+    int                  nb_side_data;
+    hb_buffer_settings_t s;
+    hb_image_format_t    f;
+} pass_cache_record_t;
+
+typedef struct
+{
+    int                  type;
+    int                  size;
+} pass_cache_side_data_t;
+
+struct hb_work_private_s
+{
+    hb_job_t        * job;
+    hb_pass_cache_t * cache;
+    AVCodecContext  * context;
+    AVPacket        * pkt;
+    AVFrame         * frame;
+
+    // Record only
+    int               failed;
+
+    // Replay only
+    hb_fifo_t      ** fifos;
+    int               frame_count;
+    int               est_frame_count;
+    uint64_t          st_first;
+    uint64_t          st_date;
+    int               st_count;
+};
+
+/*
+ * Tracks are numbered as in the muxer: video, then all audio tracks,
+ * then the passthru subtitle tracks.
+ */
+static int pass_cache_track_count( hb_job_t * job )
+{
+    int ii, count = 1 + hb_list_count(job->list_audio);
+
+    for (ii = 0; ii < hb_list_count(job->list_subtitle); ii++)
+    {
+        hb_subtitle_t * subtitle = hb_list_item(job->list_subtitle, ii);
+        if (subtitle->config.dest == PASSTHRUSUB)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Describes everything the cached frames depend on, so that a final
+ * pass with a different setup does not replay them.
+ */
+static char * pass_cache_setup( hb_job_t * job )
+{
+    hb_dict_t        * dict    = hb_dict_init();
+    hb_value_array_t * filters = hb_value_array_init();
+    char             * setup;
+    int                ii;
+
+    if (job->title->path != NULL)
+    {
+        hb_dict_set_string(dict, "Path", job->title->path);
+    }
+    hb_dict_set_int(dict, "Title", job->title->index);
+    hb_dict_set_int(dict, "Angle", job->angle);
+    hb_dict_set_int(dict, "ChapterStart", job->chapter_start);
+    hb_dict_set_int(dict, "ChapterEnd", job->chapter_end);
+    hb_dict_set_int(dict, "PtsToStart", job->pts_to_start);
+    hb_dict_set_int(dict, "PtsToStop", job->pts_to_stop);
+    hb_dict_set_int(dict, "FrameToStart", job->frame_to_start);
+    hb_dict_set_int(dict, "FrameToStop", job->frame_to_stop);
+    hb_dict_set_int(dict, "StartAtPreview", job->start_at_preview);
+    hb_dict_set_int(dict, "SeekPoints", job->seek_points);
+
+    hb_dict_set_int(dict, "Width", job->width);
+    hb_dict_set_int(dict, "Height", job->height);
+    hb_dict_set_int(dict, "ParNum", job->par.num);
+    hb_dict_set_int(dict, "ParDen", job->par.den);
+    for (ii = 0; ii < 4; ii++)
+    {
+        char key[8];
+        snprintf(key, sizeof(key), "Crop%d", ii);
+        hb_dict_set_int(dict, key, job->crop[ii]);
+    }
+    hb_dict_set_int(dict, "RateNum", job->vrate.num);
+    hb_dict_set_int(dict, "RateDen", job->vrate.den);
+    hb_dict_set_int(dict, "CFR", job->cfr);
+    hb_dict_set_int(dict, "Grayscale", job->grayscale);
+    hb_dict_set_int(dict, "PixFmt", job->output_pix_fmt);
+
+    for (ii = 0; ii < hb_list_count(job->list_filter); ii++)
+    {
+        hb_filter_object_t * filter      = hb_list_item(job->list_filter, ii);
+        hb_dict_t          * filter_dict = hb_dict_init();
+
+        hb_dict_set_int(filter_dict, "ID", filter->id);
+        if (filter->settings != NULL)
+        {
+            hb_dict_set(filter_dict, "Settings", hb_value_dup(filter->settings));
+        }
+        hb_value_array_append(filters, filter_dict);
+    }
+    hb_dict_set(dict, "Filters", filters);
+
+    setup = hb_value_get_json(dict);
+    hb_value_free(&dict);
+
+    return setup;
+}
+
+static void pass_cache_fail( hb_pass_cache_t * cache )
+{
+    cache->failed = 1;
+    if (cache->file != NULL)
+    {
+        fclose(cache->file);
+        cache->file = NULL;
+        remove(cache->filename);
+    }
+}
+
+hb_pass_cache_t * hb_pass_cache_init( hb_job_t * job )
+{
+    hb_pass_cache_t * cache;
+
+    if (job->hw_pix_fmt != AV_PIX_FMT_NONE)
+    {
+        hb_log("passcache: hardware frames can not be cached");
+        return NULL;
+    }
+
+    cache = calloc(1, sizeof(hb_pass_cache_t));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    cache->lock     = hb_lock_init();
+    cache->max_size = (int64_t)job->multipass_cache * 1024 * 1024;
+    cache->ntracks  = pass_cache_track_count(job);
+    cache->setup    = pass_cache_setup(job);
+    cache->filename = hb_get_temporary_filename("passcache_%d.raw",
+                                                job->sequence_id);
+    cache->file     = hb_fopen(cache->filename, "w+b");
+    if (cache->file == NULL)
+    {
+        hb_error("passcache: could not create %s", cache->filename);
+        hb_pass_cache_close(&cache);
+        return NULL;
+    }
+    hb_log("passcache: caching up to %d MiB of the analysis pass",
+           job->multipass_cache);
+
+    return cache;
+}
+
+void hb_pass_cache_close( hb_pass_cache_t ** _cache )
+{
+    hb_pass_cache_t * cache = *_cache;
+    int               ii;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+    if (cache->file != NULL)
+    {
+        fclose(cache->file);
+        remove(cache->filename);
+    }
+    for (ii = 0; ii < cache->nb_extradata; ii++)
+    {
+        hb_data_close(&cache->extradata[ii]);
+    }
+    free(cache->extradata);
+    hb_data_close(&cache->video_extradata);
+    hb_lock_close(&cache->lock);
+    free(cache->setup);
+    free(cache->filename);
+    free(cache);
+    *_cache = NULL;
+}
+
+/*
+ * Appends one record.  data is the buffer payload, which for video
+ * frames is the FFV1 packet produced by the writer.
+ */
+static int pass_cache_write_record( hb_pass_cache_t * cache, int track,
+                                    const hb_buffer_t * buf,
+                                    const uint8_t * data, int data_size )
+{
+    pass_cache_record_t rec;
+    int64_t             size;
+    int                 ii;
+
+    hb_lock(cache->lock);
+    if (cache->failed || cache->complete)
+    {
+        hb_unlock(cache->lock);
+        return -1;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.track = track;
+    rec.s     = buf->s;
+    rec.f     = buf->f;
+    if (!(buf->s.flags & HB_BUF_FLAG_EOF))
+    {
+        rec.size         = data_size;
+        rec.nb_side_data = buf->nb_side_data;
+    }
+
+    size = sizeof(rec) + rec.size;
+    for (ii = 0; ii < rec.nb_side_data; ii++)
+    {
+        const AVFrameSideData * sd = buf->side_data[ii];
+        size += sizeof(pass_cache_side_data_t) + sd->size;
+    }
+    if (cache->size + size > cache->max_size)
+    {
+        hb_log("passcache: analysis pass output exceeds %"PRId64" MiB, "
+               "the final pass will not use the cache",
+               cache->max_size / (1024 * 1024));
+        pass_cache_fail(cache);
+        hb_unlock(cache->lock);
+        return -1;
+    }
+
+    int error = fwrite(&rec, sizeof(rec), 1, cache->file) != 1;
+    if (!error && rec.size > 0)
+    {
+        error = fwrite(data, rec.size, 1, cache->file) != 1;
+    }
+    for (ii = 0; ii < rec.nb_side_data && !error; ii++)
+    {
+        const AVFrameSideData  * sd = buf->side_data[ii];
+        pass_cache_side_data_t   hdr = { .type = sd->type, .size = sd->size };
+
+        error = fwrite(&hdr, sizeof(hdr), 1, cache->file) != 1;
+        if (!error && sd->size > 0)
+        {
+            error = fwrite(sd->data, sd->size, 1, cache->file) != 1;
+        }
+    }
+    if (error)
+    {
+        hb_error("passcache: write to %s failed", cache->filename);
+        pass_cache_fail(cache);
+        hb_unlock(cache->lock);
+        return -1;
+    }
+    cache->size += size;
+    if (track == 0 && !(buf->s.flags & HB_BUF_FLAG_EOF))
+    {
+        cache->frame_count++;
+    }
+    hb_unlock(cache->lock);
+
+    return 0;
+}
+
+int hb_pass_cache_write( hb_pass_cache_t * cache, int track,
+                         const hb_buffer_t * buf )
+{
+    return pass_cache_write_record(cache, track, buf, buf->data, buf->size);
+}
+
+/*
+ * Called when the recording pass is done.  Keeps the cache for the
+ * final pass if the whole analysis pass output was stored.
+ */
+void hb_pass_cache_finish( hb_pass_cache_t * cache, hb_job_t * job )
+{
+    int ii;
+
+    // A failed cache is kept, so that later analysis passes
+    // do not try to record it again
+    if (cache->failed || *job->done_error != HB_ERROR_NONE || *job->die ||
+        (cache->frame_count > 0 && cache->video_extradata == NULL) ||
+        fflush(cache->file) != 0)
+    {
+        pass_cache_fail(cache);
+        return;
+    }
+
+    // Audio encoders can update their extradata at the end of the
+    // stream (e.g. FLAC), which the final pass does not reach.
+    cache->extradata = calloc(hb_list_count(job->list_audio) + 1,
+                              sizeof(hb_data_t *));
+    if (cache->extradata == NULL)
+    {
+        pass_cache_fail(cache);
+        return;
+    }
+    for (ii = 0; ii < hb_list_count(job->list_audio); ii++)
+    {
+        hb_audio_t * audio = hb_list_item(job->list_audio, ii);
+        cache->extradata[cache->nb_extradata++] =
+            hb_data_dup(audio->priv.extradata);
+    }
+    cache->complete = 1;
+
+    hb_log("passcache: %d frames, %"PRId64" bytes cached "
+           "(%"PRId64" bytes of uncompressed video)",
+           cache->frame_count, cache->size, cache->raw_size);
+}
+
+int hb_pass_cache_can_replay( hb_pass_cache_t * cache, hb_job_t * job )
+{
+    char * setup;
+    int    same;
+
+    if (cache == NULL || !cache->complete)
+    {
+        return 0;
+    }
+    if (cache->ntracks != pass_cache_track_count(job))
+    {
+        hb_log("passcache: track layout changed, not using the cache");
+        return 0;
+    }
+    setup = pass_cache_setup(job);
+    same  = setup != NULL && cache->setup != NULL &&
+            !strcmp(setup, cache->setup);
+    free(setup);
+    if (!same)
+    {
+        hb_log("passcache: source, range, filters or geometry changed, "
+               "not using the cache");
+        return 0;
+    }
+    return 1;
+}
+
+/***********************************************************************
+ * Writer: stores the frames that are sent to the video encoder
+ **********************************************************************/
+static int pass_cache_encoder_open( hb_work_private_t * pv,
+                                    const hb_buffer_t * buf )
+{
+    static const int slices[] = {4, 6, 9, 12, 16, 24, 30};
+    const AVCodec  * codec = avcodec_find_encoder(AV_CODEC_ID_FFV1);
+    AVCodecContext * context;
+    hb_data_t      * extradata;
+    int              ii;
+
+    if (codec == NULL || (context = avcodec_alloc_context3(codec)) == NULL)
+    {
+        return -1;
+    }
+    pv->context = context;
+
+    context->width        = buf->f.width;
+    context->height       = buf->f.height;
+    context->pix_fmt      = buf->f.fmt;
+    context->time_base    = (AVRational){1, 90000};
+    // Version 3 codes slices independently, so they can be threaded
+    context->level        = 3;
+    context->thread_type  = FF_THREAD_SLICE;
+    context->thread_count = 0;
+    context->slices       = slices[0];
+    for (ii = 0; ii < sizeof(slices) / sizeof(slices[0]); ii++)
+    {
+        if (hb_get_cpu_count() >= slices[ii])
+        {
+            context->slices = slices[ii];
+        }
+    }
+    if (avcodec_open2(context, codec, NULL) < 0)
+    {
+        hb_log("passcache: %s frames can not be cached",
+               av_get_pix_fmt_name(buf->f.fmt));
+        return -1;
+    }
+
+    extradata = hb_data_init(context->extradata_size);
+    if (extradata == NULL)
+    {
+        return -1;
+    }
+    memcpy(extradata->bytes, context->extradata, context->extradata_size);
+    hb_lock(pv->cache->lock);
+    pv->cache->video_extradata = extradata;
+    hb_unlock(pv->cache->lock);
+
+    return 0;
+}
+
+/*
+ * Compresses a frame.  FFV1 has no encoder delay, so every frame
+ * produces its packet right away.
+ */
+static int pass_cache_encode( hb_work_private_t * pv, hb_buffer_t * buf )
+{
+    AVFrame * frame = pv->frame;
+    int       pp;
+
+    if (pv->context == NULL && pass_cache_encoder_open(pv, buf) < 0)
+    {
+        return -1;
+    }
+    if (buf->f.fmt    != pv->context->pix_fmt ||
+        buf->f.width  != pv->context->width   ||
+        buf->f.height != pv->context->height)
+    {
+        hb_log("passcache: frame format changed, can not cache");
+        return -1;
+    }
+
+    for (pp = 0; pp <= buf->f.max_plane; pp++)
+    {
+        frame->data[pp]     = buf->plane[pp].data;
+        frame->linesize[pp] = buf->plane[pp].stride;
+        pv->cache->raw_size += (int64_t)buf->plane[pp].stride *
+                                        buf->plane[pp].height;
+    }
+    frame->format = buf->f.fmt;
+    frame->width  = buf->f.width;
+    frame->height = buf->f.height;
+    frame->pts    = buf->s.start;
+
+    av_packet_unref(pv->pkt);
+    if (avcodec_send_frame(pv->context, frame) < 0 ||
+        avcodec_receive_packet(pv->context, pv->pkt) < 0)
+    {
+        hb_error("passcache: FFV1 encoding failed");
+        return -1;
+    }
+    return 0;
+}
+
+static int pass_cache_writer_init( hb_work_object_t * w, hb_job_t * job )
+{
+    hb_work_private_t * pv = calloc(1, sizeof(hb_work_private_t));
+    if (pv == NULL)
+    {
+        return 1;
+    }
+    w->private_data = pv;
+    pv->job   = job;
+    pv->cache = job->pass_cache;
+    pv->pkt   = av_packet_alloc();
+    pv->frame = av_frame_alloc();
+    if (pv->pkt == NULL || pv->frame == NULL)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void pass_cache_writer_close( hb_work_object_t * w )
+{
+    hb_work_private_t * pv = w->private_data;
+
+    if (pv != NULL)
+    {
+        avcodec_free_context(&pv->context);
+        av_packet_free(&pv->pkt);
+        av_frame_free(&pv->frame);
+        free(pv);
+    }
+    w->private_data = NULL;
+}
+
+static int pass_cache_writer_work( hb_work_object_t * w,
+                                   hb_buffer_t ** buf_in,
+                                   hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * in = *buf_in;
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        pass_cache_write_record(pv->cache, 0, in, NULL, 0);
+    }
+    else if (!pv->failed)
+    {
+        // Once the cache is dropped, stop compressing frames
+        if (pass_cache_encode(pv, in) < 0)
+        {
+            hb_lock(pv->cache->lock);
+            pass_cache_fail(pv->cache);
+            hb_unlock(pv->cache->lock);
+            pv->failed = 1;
+        }
+        else if (pass_cache_write_record(pv->cache, 0, in, pv->pkt->data,
+                                         pv->pkt->size) < 0)
+        {
+            pv->failed = 1;
+        }
+    }
+
+    *buf_out = in;
+    *buf_in  = NULL;
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        return HB_WORK_DONE;
+    }
+    return HB_WORK_OK;
+}
+
+hb_work_object_t hb_pass_cache_writer =
+{
+    .id     = WORK_PASS_CACHE_WRITER,
+    .name   = "Multi-pass cache writer",
+    .init   = pass_cache_writer_init,
+    .work   = pass_cache_writer_work,
+    .close  = pass_cache_writer_close,
+};
+
+/***********************************************************************
+ * Reader: replays the cache into the video encoder and the muxer
+ **********************************************************************/
+static int pass_cache_decoder_open( hb_work_private_t * pv )
+{
+    const AVCodec  * codec     = avcodec_find_decoder(AV_CODEC_ID_FFV1);
+    hb_data_t      * extradata = pv->cache->video_extradata;
+    AVCodecContext * context;
+
+    if (codec == NULL || extradata == NULL ||
+        (context = avcodec_alloc_context3(codec)) == NULL)
+    {
+        return -1;
+    }
+    pv->context = context;
+
+    context->extradata = av_mallocz(extradata->size +
+                                    AV_INPUT_BUFFER_PADDING_SIZE);
+    if (context->extradata == NULL)
+    {
+        return -1;
+    }
+    memcpy(context->extradata, extradata->bytes, extradata->size);
+    context->extradata_size = extradata->size;
+    context->thread_type    = FF_THREAD_SLICE;
+    context->thread_count   = 0;
+
+    return avcodec_open2(context, codec, NULL) < 0 ? -1 : 0;
+}
+
+static hb_buffer_t * pass_cache_decode( hb_work_private_t * pv,
+                                        const pass_cache_record_t * rec )
+{
+    hb_pass_cache_t * cache = pv->cache;
+    AVFrame         * frame = pv->frame;
+    hb_buffer_t     * buf;
+    int               pp;
+
+    if (pv->context == NULL)
+    {
+        return NULL;
+    }
+    av_packet_unref(pv->pkt);
+    if (av_new_packet(pv->pkt, rec->size) < 0 ||
+        fread(pv->pkt->data, rec->size, 1, cache->file) != 1)
+    {
+        return NULL;
+    }
+
+    av_frame_unref(frame);
+    if (avcodec_send_packet(pv->context, pv->pkt) < 0 ||
+        avcodec_receive_frame(pv->context, frame) < 0 ||
+        frame->format != rec->f.fmt  ||
+        frame->width  != rec->f.width || frame->height != rec->f.height)
+    {
+        hb_error("passcache: FFV1 decoding failed");
+        return NULL;
+    }
+
+    buf = hb_frame_buffer_init(rec->f.fmt, rec->f.width, rec->f.height);
+    for (pp = 0; buf != NULL && pp <= buf->f.max_plane; pp++)
+    {
+        av_image_copy_plane(buf->plane[pp].data, buf->plane[pp].stride,
+                            frame->data[pp], frame->linesize[pp],
+                            av_image_get_linesize(rec->f.fmt, rec->f.width, pp),
+                            buf->plane[pp].height);
+    }
+    return buf;
+}
+
+static hb_buffer_t * pass_cache_read( hb_work_private_t * pv, int * track,
+                                      int * eof )
+{
+    hb_pass_cache_t     * cache = pv->cache;
+    pass_cache_record_t   rec;
+    hb_buffer_t         * buf;
+    int                   ii, error = 0;
+
+    *eof = 0;
+    if (fread(&rec, sizeof(rec), 1, cache->file) != 1)
+    {
+        *eof = feof(cache->file);
+        return NULL;
+    }
+    if (rec.track < 0 || rec.track >= cache->ntracks || rec.size < 0)
+    {
+        return NULL;
+    }
+
+    if (rec.s.flags & HB_BUF_FLAG_EOF)
+    {
+        buf = hb_buffer_eof_init();
+    }
+    else if (rec.s.type == FRAME_BUF)
+    {
+        buf = pass_cache_decode(pv, &rec);
+    }
+    else
+    {
+        buf = hb_buffer_init(rec.size);
+        if (buf != NULL && rec.size > 0)
+        {
+            error = fread(buf->data, rec.size, 1, cache->file) != 1;
+        }
+    }
+    if (buf == NULL || error)
+    {
+        hb_buffer_close(&buf);
+        return NULL;
+    }
+    buf->s = rec.s;
+    if (rec.s.type == FRAME_BUF)
+    {
+        buf->f = rec.f;
+    }
+
+    for (ii = 0; ii < rec.nb_side_data; ii++)
+    {
+        pass_cache_side_data_t   hdr;
+        AVBufferRef            * ref;
+
+        if (fread(&hdr, sizeof(hdr), 1, cache->file) != 1 || hdr.size < 0 ||
+            (ref = av_buffer_alloc(hdr.size)) == NULL)
+        {
+            hb_buffer_close(&buf);
+            return NULL;
+        }
+        if ((hdr.size > 0 && fread(ref->data, hdr.size, 1, cache->file) != 1) ||
+            hb_buffer_new_side_data_from_buf(buf, hdr.type, ref) == NULL)
+        {
+            av_buffer_unref(&ref);
+            hb_buffer_close(&buf);
+            return NULL;
+        }
+    }
+
+    *track = rec.track;
+    return buf;
+}
+
+static void pass_cache_update_state( hb_work_private_t * pv )
+{
+    hb_job_t   * job = pv->job;
+    hb_state_t   state;
+    uint64_t     now = hb_get_date();
+
+    if (pv->frame_count++ == 0)
+    {
+        pv->st_first = pv->st_date = now;
+    }
+    if (now < pv->st_date + 1000)
+    {
+        return;
+    }
+
+    hb_get_state2(job->h, &state);
+    state.state = HB_STATE_WORKING;
+
+#define p state.param.working
+    p.progress = pv->est_frame_count > 0 ?
+                 (float)pv->frame_count / pv->est_frame_count : 0;
+    if (p.progress > 1.0)
+    {
+        p.progress = 1.0;
+    }
+    p.rate_cur = 1000.0 * (pv->frame_count - pv->st_count) /
+                          (now - pv->st_date);
+    p.rate_avg = 1000.0 * pv->frame_count /
+                          (now - pv->st_first - job->st_paused + 1);
+    if (p.rate_avg > 0 && pv->est_frame_count > pv->frame_count)
+    {
+        int eta = (pv->est_frame_count - pv->frame_count) / p.rate_avg;
+        p.eta_seconds = eta;
+        p.hours       = eta / 3600;
+        p.minutes     = (eta % 3600) / 60;
+        p.seconds     = eta % 60;
+    }
+    else
+    {
+        p.eta_seconds = 0;
+        p.hours       = -1;
+        p.minutes     = -1;
+        p.seconds     = -1;
+    }
+#undef p
+
+    hb_set_state(job->h, &state);
+    pv->st_date  = now;
+    pv->st_count = pv->frame_count;
+}
+
+static int pass_cache_reader_init( hb_work_object_t * w, hb_job_t * job )
+{
+    hb_interjob_t     * interjob = hb_interjob_get(job->h);
+    hb_work_private_t * pv;
+    int                 ii, track;
+
+    pv = calloc(1, sizeof(hb_work_private_t));
+    if (pv == NULL)
+    {
+        return 1;
+    }
+    w->private_data = pv;
+    pv->job   = job;
+    pv->cache = interjob->pass_cache;
+    pv->fifos = calloc(pv->cache->ntracks, sizeof(hb_fifo_t *));
+    pv->pkt   = av_packet_alloc();
+    pv->frame = av_frame_alloc();
+    if (pv->fifos == NULL || pv->pkt == NULL || pv->frame == NULL ||
+        fseek(pv->cache->file, 0, SEEK_SET) != 0)
+    {
+        return 1;
+    }
+    if (pv->cache->frame_count > 0 && pass_cache_decoder_open(pv) < 0)
+    {
+        hb_error("passcache: could not open the FFV1 decoder");
+        return 1;
+    }
+    pv->est_frame_count = interjob->out_frame_count > 0 ?
+                          interjob->out_frame_count : interjob->frame_count;
+
+    track = 1;
+    for (ii = 0; ii < hb_list_count(job->list_audio); ii++)
+    {
+        hb_audio_t * audio     = hb_list_item(job->list_audio, ii);
+        hb_data_t  * extradata = ii < pv->cache->nb_extradata ?
+                                 pv->cache->extradata[ii] : NULL;
+
+        pv->fifos[track++] = audio->priv.fifo_out;
+        if (extradata != NULL)
+        {
+            hb_data_close(&audio->priv.extradata);
+            audio->priv.extradata = hb_data_dup(extradata);
+        }
+    }
+    for (ii = 0; ii < hb_list_count(job->list_subtitle); ii++)
+    {
+        hb_subtitle_t * subtitle = hb_list_item(job->list_subtitle, ii);
+        if (subtitle->config.dest == PASSTHRUSUB)
+        {
+            pv->fifos[track++] = subtitle->fifo_out;
+        }
+    }
+    hb_log("passcache: replaying %d frames", pv->cache->frame_count);
+
+    return 0;
+}
+
+static void pass_cache_reader_close( hb_work_object_t * w )
+{
+    hb_work_private_t * pv = w->private_data;
+
+    if (pv != NULL)
+    {
+        avcodec_free_context(&pv->context);
+        av_packet_free(&pv->pkt);
+        av_frame_free(&pv->frame);
+        free(pv->fifos);
+        free(pv);
+    }
+    w->private_data = NULL;
+}
+
+static int pass_cache_reader_work( hb_work_object_t * w,
+                                   hb_buffer_t ** buf_in,
+                                   hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * buf;
+    int                 track, eof;
+
+    // Pass the audio and subtitle records to the muxer until
+    // the next video frame
+    while (!*w->done && !*pv->job->die)
+    {
+        buf = pass_cache_read(pv, &track, &eof);
+        if (buf == NULL)
+        {
+            if (!eof)
+            {
+                hb_error("passcache: read from %s failed",
+                         pv->cache->filename);
+                *pv->job->done_error = HB_ERROR_UNKNOWN;
+                *pv->job->die = 1;
+            }
+            return HB_WORK_DONE;
+        }
+        if (track == 0)
+        {
+            if (!(buf->s.flags & HB_BUF_FLAG_EOF))
+            {
+                pass_cache_update_state(pv);
+            }
+            *buf_out = buf;
+            return HB_WORK_OK;
+        }
+        while (buf != NULL && !*w->done)
+        {
+            if (hb_fifo_full_wait(pv->fifos[track]))
+            {
+                hb_fifo_push(pv->fifos[track], buf);
+                buf = NULL;
+            }
+        }
+        hb_buffer_close(&buf);
+    }
+    return HB_WORK_DONE;
+}
+
+hb_work_object_t hb_pass_cache_reader =
+{
+    .id     = WORK_PASS_CACHE_READER,
+    .name   = "Multi-pass cache reader",
+    .init   = pass_cache_reader_init,
+    .work   = pass_cache_reader_work,
+    .close  = pass_cache_reader_close,
+};
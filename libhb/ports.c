@@ -949,6 +949,9 @@ struct hb_thread_s
     hb_lock_t     * lock;
     int             exited;
     pthread_t       thread;
+
+    hb_lock_t     * exit_lock;
+    hb_cond_t     * exit_cond;
 };
 
 /* Get a unique identifier to thread and represent as 64-bit unsigned.
@@ -1005,9 +1008,22 @@ static void attribute_align_thread hb_thread_func( void * _t )
 
     /* Inform that the thread can be joined now */
     hb_deep_log( 2, "thread %"PRIx64" exited (\"%s\")", hb_thread_to_integer( t ), t->name );
+    hb_lock_t * exit_lock;
+    hb_cond_t * exit_cond;
+
     hb_lock( t->lock );
     t->exited = 1;
+    exit_lock = t->exit_lock;
+    exit_cond = t->exit_cond;
     hb_unlock( t->lock );
+
+    /* Wake up whoever waits on this thread's termination */
+    if (exit_lock != NULL && exit_cond != NULL)
+    {
+        hb_lock(exit_lock);
+        hb_cond_broadcast(exit_cond);
+        hb_unlock(exit_lock);
+    }
 }
 
 /************************************************************************
@@ -1074,6 +1090,32 @@ int hb_thread_has_exited( hb_thread_t * t )
     return exited;
 }
 
+/************************************************************************
+ * hb_thread_notify_exit()
+ ************************************************************************
+ * Broadcasts cond, with lock held, when the thread exits. Lets a
+ * waiter block on cond instead of polling hb_thread_has_exited().
+ * If the thread has already exited, cond is broadcast immediately.
+ ***********************************************************************/
+void hb_thread_notify_exit( hb_thread_t * t, hb_lock_t * lock,
+                            hb_cond_t * cond )
+{
+    int exited;
+
+    hb_lock( t->lock );
+    t->exit_lock = lock;
+    t->exit_cond = cond;
+    exited       = t->exited;
+    hb_unlock( t->lock );
+
+    if (exited && lock != NULL && cond != NULL)
+    {
+        hb_lock(lock);
+        hb_cond_broadcast(cond);
+        hb_unlock(lock);
+    }
+}
+
 /************************************************************************
  * Portable mutex implementation
  ***********************************************************************/
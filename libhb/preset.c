@@ -30,6 +30,11 @@ static hb_value_t *hb_presets = NULL;
 static hb_value_t *hb_presets_builtin = NULL;
 static hb_value_t *hb_presets_cli_default = NULL;
 
+static const int hb_builtin_presets_count =
+    sizeof(hb_builtin_presets) / sizeof(hb_builtin_presets[0]);
+static const int hb_builtin_presets_by_name_count =
+    sizeof(hb_builtin_presets_by_name) / sizeof(hb_builtin_presets_by_name[0]);
+
 static void         preset_clean(hb_value_t *preset, hb_value_t *template);
 static int          preset_import(hb_value_t *preset, int major, int minor,
                                   int micro);
@@ -2024,6 +2029,11 @@ int hb_preset_apply_filters(const hb_dict_t *preset, hb_dict_t *job_dict)
         hb_value_get_int(fr_mode_value);
 
     filter_settings = hb_dict_init();
+    if (fr_mode == 0 &&
+        hb_value_get_bool(hb_dict_get(preset, "VideoFramerateDedup")))
+    {
+        hb_dict_set(filter_settings, "dedup", hb_value_bool(1));
+    }
     if (vrate_den == 0)
     {
         hb_dict_set(filter_settings, "mode", hb_value_int(fr_mode));
@@ -2647,6 +2657,187 @@ fail:
     return NULL;
 }
 
+struct hb_job_template_s
+{
+    hb_dict_t        * preset;
+    hb_dict_t        * destination; // Set by hb_preset_apply_mux()
+    hb_dict_t        * video;       // Set by hb_preset_apply_video()
+    hb_value_array_t * filters;     // Added by hb_preset_apply_filters()
+};
+
+/**
+ * Compile a preset into a job template. The parts of the preset that do
+ * not depend on a title (container, video encoder settings and filters)
+ * are interpreted and validated once here, so that creating a job from
+ * the template for each title only does the title specific work.
+ * @param preset        - Preset to compile, it is copied
+ */
+hb_job_template_t * hb_job_template_init(const hb_dict_t *preset)
+{
+    hb_job_template_t * tmpl;
+    hb_dict_t         * job_dict, * filters_dict;
+
+    if (preset == NULL)
+    {
+        return NULL;
+    }
+
+    // Apply the title independent settings to an empty job
+    job_dict     = hb_dict_init();
+    filters_dict = hb_dict_init();
+    hb_dict_set(job_dict, "Destination", hb_dict_init());
+    hb_dict_set(job_dict, "Video", hb_dict_init());
+    hb_dict_set(filters_dict, "FilterList", hb_value_array_init());
+    hb_dict_set(job_dict, "Filters", filters_dict);
+
+    if (hb_preset_apply_mux(preset, job_dict) < 0 ||
+        hb_preset_apply_video(preset, job_dict) < 0 ||
+        hb_preset_apply_filters(preset, job_dict) < 0)
+    {
+        hb_value_free(&job_dict);
+        return NULL;
+    }
+
+    tmpl = calloc(1, sizeof(hb_job_template_t));
+    if (tmpl == NULL)
+    {
+        hb_value_free(&job_dict);
+        return NULL;
+    }
+    tmpl->preset      = hb_value_dup(preset);
+    tmpl->destination = hb_value_dup(hb_dict_get(job_dict, "Destination"));
+    tmpl->video       = hb_value_dup(hb_dict_get(job_dict, "Video"));
+    tmpl->filters     = hb_value_dup(hb_dict_get(filters_dict, "FilterList"));
+    hb_value_free(&job_dict);
+
+    return tmpl;
+}
+
+void hb_job_template_close(hb_job_template_t **_tmpl)
+{
+    hb_job_template_t * tmpl = *_tmpl;
+
+    if (tmpl == NULL)
+    {
+        return;
+    }
+    hb_value_free(&tmpl->preset);
+    hb_value_free(&tmpl->destination);
+    hb_value_free(&tmpl->video);
+    hb_value_free(&tmpl->filters);
+    free(tmpl);
+    *_tmpl = NULL;
+}
+
+static void job_template_merge(hb_dict_t *dict, const hb_dict_t *src)
+{
+    hb_dict_iter_t iter;
+
+    for (iter = hb_dict_iter_init(src);
+         iter != HB_DICT_ITER_DONE;
+         iter = hb_dict_iter_next(src, iter))
+    {
+        hb_dict_set(dict, hb_dict_iter_key(iter),
+                    hb_value_dup(hb_dict_iter_value(iter)));
+    }
+}
+
+/**
+ * Initialize a job from the given title and job template. The result is
+ * the same as hb_preset_job_init() with the preset the template was
+ * compiled from.
+ * @param h             - Pointer to hb_handle_t instance that contains the
+ *                        specified title_index
+ * @param title_index   - Index of hb_title_t to use for job initialization.
+ * @param tmpl          - Job template from hb_job_template_init()
+ */
+hb_dict_t * hb_job_template_job_init(hb_handle_t *h, int title_index,
+                                     const hb_job_template_t *tmpl)
+{
+    hb_title_t       * title = hb_find_title_by_index(h, title_index);
+    hb_dict_t        * video_dict;
+    hb_value_array_t * filter_list;
+    int                ii, count;
+
+    if (title == NULL)
+    {
+        hb_error("Invalid title index (%d)", title_index);
+        return NULL;
+    }
+
+    hb_job_t *job = hb_job_init(title);
+    hb_dict_t *job_dict = hb_job_to_dict(job);
+    hb_job_close(&job);
+
+    job_template_merge(hb_dict_get(job_dict, "Destination"),
+                       tmpl->destination);
+
+    // hb_preset_apply_video() always sets one of Quality and Bitrate
+    // and removes the other
+    video_dict = hb_dict_get(job_dict, "Video");
+    hb_dict_remove(video_dict, "Quality");
+    hb_dict_remove(video_dict, "Bitrate");
+    job_template_merge(video_dict, tmpl->video);
+
+    if (hb_preset_apply_dimensions(h, title_index, tmpl->preset, job_dict) < 0)
+        goto fail;
+
+    filter_list = hb_dict_get(hb_dict_get(job_dict, "Filters"), "FilterList");
+    count       = hb_value_array_len(tmpl->filters);
+    for (ii = 0; ii < count; ii++)
+    {
+        hb_add_filter2(filter_list,
+                       hb_value_dup(hb_value_array_get(tmpl->filters, ii)));
+    }
+
+    if (hb_preset_apply_title(h, title_index, tmpl->preset, job_dict) < 0)
+        goto fail;
+
+    return job_dict;
+
+fail:
+    hb_value_free(&job_dict);
+    return NULL;
+}
+
+/**
+ * Add a job for the given title, created from a job template, to the
+ * hb queue. Returns the job sequence id, or -1 on failure.
+ * @param h             - Pointer to hb_handle_t instance that contains the
+ *                        specified title_index
+ * @param title_index   - Index of hb_title_t to encode
+ * @param tmpl          - Job template from hb_job_template_init()
+ * @param file          - Destination file name
+ */
+int hb_job_template_add(hb_handle_t *h, int title_index,
+                        const hb_job_template_t *tmpl, const char *file)
+{
+    hb_dict_t * job_dict;
+    char      * json_job;
+    int         sequence_id;
+
+    job_dict = hb_job_template_job_init(h, title_index, tmpl);
+    if (job_dict == NULL)
+    {
+        return -1;
+    }
+    if (file != NULL)
+    {
+        hb_dict_set(hb_dict_get(job_dict, "Destination"), "File",
+                    hb_value_string(file));
+    }
+    json_job = hb_value_get_json(job_dict);
+    hb_value_free(&job_dict);
+    if (json_job == NULL)
+    {
+        return -1;
+    }
+    sequence_id = hb_add_json(h, json_job);
+    free(json_job);
+
+    return sequence_id;
+}
+
 // Clean a dictionary of unwanted keys
 // Used to make sure only valid keys are in output presets
 static void
@@ -4434,8 +4625,9 @@ static hb_value_t * presets_package(const hb_value_t *presets)
 
 void hb_presets_builtin_init(void)
 {
-    hb_value_t * dict = hb_value_json(hb_builtin_presets_json);
-    hb_value_t * template = hb_dict_get(dict, "PresetTemplate");
+    // Only the template is needed up front. The builtin presets
+    // themselves are parsed when first used, see presets_builtin().
+    hb_value_t * template = hb_value_json(hb_builtin_preset_template_json);
     hb_preset_version_major = hb_value_get_int(
                               hb_dict_get(template, "VersionMajor"));
     hb_preset_version_minor = hb_value_get_int(
@@ -4444,21 +4636,176 @@ void hb_presets_builtin_init(void)
                               hb_dict_get(template, "VersionMicro"));
     hb_preset_template = hb_value_dup(hb_dict_get(template, "Preset"));
 
-    hb_presets_builtin = hb_value_dup(hb_dict_get(dict, "PresetBuiltin"));
+    hb_presets = hb_value_array_init();
+    hb_value_free(&template);
+}
+
+// Parse one entry of the builtin preset table
+static hb_value_t * preset_builtin_parse(int index)
+{
+    hb_value_t * preset = hb_value_json(hb_builtin_presets[index].json);
+    if (preset == NULL)
+    {
+        hb_error("Failed to parse builtin preset %s",
+                 hb_builtin_presets[index].name);
+    }
+    return preset;
+}
+
+// Returns the builtin presets list, building it on first use
+static hb_value_t * presets_builtin(void)
+{
+    hb_value_t * folders[sizeof(hb_builtin_presets) / sizeof(hb_builtin_presets[0])];
+    int          ii;
+
+    if (hb_presets_builtin != NULL)
+    {
+        return hb_presets_builtin;
+    }
+
+    hb_presets_builtin = hb_value_array_init();
+    for (ii = 0; ii < hb_builtin_presets_count; ii++)
+    {
+        hb_value_t * preset = preset_builtin_parse(ii);
+        hb_value_t * parent = NULL;
+
+        folders[ii] = preset;
+        if (preset == NULL)
+        {
+            continue;
+        }
+        if (hb_builtin_presets[ii].parent >= 0)
+        {
+            parent = folders[hb_builtin_presets[ii].parent];
+            if (parent == NULL)
+            {
+                hb_value_free(&preset);
+                folders[ii] = NULL;
+                continue;
+            }
+            parent = hb_dict_get(parent, "ChildrenArray");
+        }
+        hb_value_array_append(parent != NULL ? parent : hb_presets_builtin,
+                              preset);
+    }
     hb_presets_clean(hb_presets_builtin);
 
-    hb_presets = hb_value_array_init();
-    hb_value_free(&dict);
+    return hb_presets_builtin;
+}
+
+static int preset_builtin_cmp(const void * a, const void * b)
+{
+    const char * name  = a;
+    int          index = *(const int *)b;
+
+    return strcmp(name, hb_builtin_presets[index].name);
+}
+
+// Checks that the folders of builtin preset "index" match "path",
+// the part of a "Folder/Name" search before the name
+static int preset_builtin_path_match(int index, const char * path, int len)
+{
+    int parent = hb_builtin_presets[index].parent;
+
+    if (len == 0)
+    {
+        // Plain preset name, matches at any depth
+        return 1;
+    }
+    while (len > 0)
+    {
+        const char * name;
+        int          name_len;
+
+        if (parent < 0)
+        {
+            return 0;
+        }
+        name     = hb_builtin_presets[parent].name;
+        name_len = strlen(name);
+        if (name_len > len || strncmp(path + len - name_len, name, name_len))
+        {
+            return 0;
+        }
+        len -= name_len;
+        if (len > 0)
+        {
+            if (path[len - 1] != '/')
+            {
+                return 0;
+            }
+            len--;
+        }
+        parent = hb_builtin_presets[parent].parent;
+    }
+    return parent < 0;
+}
+
+hb_value_t * hb_presets_builtin_search(const char *name)
+{
+    const int  * found;
+    const char * preset_name;
+    int          count, pos, path_len;
+    hb_value_t * preset;
+
+    if (name == NULL)
+    {
+        return NULL;
+    }
+    if (name[0] == '/')
+    {
+        name++;
+    }
+    preset_name = strrchr(name, '/');
+    preset_name = preset_name != NULL ? preset_name + 1 : name;
+    path_len    = preset_name > name ? preset_name - name - 1 : 0;
+
+    count = hb_builtin_presets_by_name_count;
+    found = bsearch(preset_name, hb_builtin_presets_by_name, count,
+                    sizeof(hb_builtin_presets_by_name[0]),
+                    preset_builtin_cmp);
+    if (found == NULL)
+    {
+        return NULL;
+    }
+
+    // Names are not unique, find the first match in preset list order
+    pos = found - hb_builtin_presets_by_name;
+    while (pos > 0 && !preset_builtin_cmp(preset_name,
+                                          &hb_builtin_presets_by_name[pos - 1]))
+    {
+        pos--;
+    }
+    for (; pos < count && !preset_builtin_cmp(preset_name,
+                                              &hb_builtin_presets_by_name[pos]);
+         pos++)
+    {
+        if (preset_builtin_path_match(hb_builtin_presets_by_name[pos],
+                                      name, path_len))
+        {
+            break;
+        }
+    }
+    if (pos >= count ||
+        preset_builtin_cmp(preset_name, &hb_builtin_presets_by_name[pos]))
+    {
+        return NULL;
+    }
+
+    preset = preset_builtin_parse(hb_builtin_presets_by_name[pos]);
+    if (preset != NULL)
+    {
+        presets_clean(preset, hb_preset_template);
+    }
+    return preset;
 }
 
 int hb_presets_cli_default_init(void)
 {
-    hb_value_t * dict = hb_value_json(hb_builtin_presets_json);
-    hb_presets_cli_default = hb_value_dup(hb_dict_get(dict, "PresetCLIDefault"));
+    hb_presets_cli_default = hb_value_json(hb_builtin_preset_cli_default_json);
     hb_presets_clean(hb_presets_cli_default);
 
     int result = hb_presets_add_internal(hb_presets_cli_default);
-    hb_value_free(&dict);
     return result;
 }
 
@@ -4500,12 +4847,12 @@ int hb_presets_gui_init(void)
 
 hb_value_t * hb_presets_builtin_get(void)
 {
-    return hb_value_dup(hb_presets_builtin);
+    return hb_value_dup(presets_builtin());
 }
 
 char * hb_presets_builtin_get_json(void)
 {
-    char *json = hb_value_get_json(hb_presets_builtin);
+    char *json = hb_value_get_json(presets_builtin());
     return json;
 }
 
@@ -4625,7 +4972,7 @@ void hb_presets_builtin_update(void)
     ctx.path.depth = 1;
     presets_do(do_delete_builtin, hb_presets, &ctx);
 
-    builtin = hb_value_dup(hb_presets_builtin);
+    builtin = hb_value_dup(presets_builtin());
     path = lookup_default_index(hb_presets);
     if (path != NULL && path->depth != 0)
     {
@@ -715,7 +715,8 @@ static hb_fifo_t ** GetFifoForId( hb_work_private_t * r, int id )
         for (i = n = 0; i < hb_list_count( job->list_audio ); i++)
         {
             audio = hb_list_item( job->list_audio, i );
-            if (id == audio->id)
+            // Tracks sharing another track's decoder have no fifo_in
+            if (id == audio->id && audio->priv.fifo_in != NULL)
             {
                 r->fifos[n++] = audio->priv.fifo_in;
             }
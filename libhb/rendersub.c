@@ -10,6 +10,7 @@
 #include "handbrake/handbrake.h"
 #include "handbrake/hbffmpeg.h"
 #include "handbrake/extradata.h"
+#include "handbrake/taskset.h"
 #include <ass/ass.h>
 
 #define ABS(a) ((a) > 0 ? (a) : (-(a)))
@@ -26,6 +27,28 @@ typedef struct hb_box_vec_s
     int size;
 } hb_box_vec_t;
 
+// Maximum number of SSA frames rendered ahead in parallel
+#define SSA_LOOKAHEAD_MAX 4
+
+// libass renderer with its own copy of the track, libass objects
+// must not be shared between threads
+typedef struct hb_ssa_render_s
+{
+    ASS_Renderer      *renderer;
+    ASS_Track         *track;
+    hb_box_vec_t       boxes;
+    hb_buffer_list_t   rendered_sub_list;
+    int                changed;
+} hb_ssa_render_t;
+
+typedef struct ssa_thread_arg_s
+{
+    taskset_thread_arg_t arg;
+    hb_filter_private_t *pv;
+    hb_ssa_render_t     *render;
+    hb_buffer_t         *in;        // Frame to render, NULL if none
+} ssa_thread_arg_t;
+
 struct hb_filter_private_s
 {
     // Common
@@ -39,17 +62,19 @@ struct hb_filter_private_s
     int                sws_height;
 
     hb_buffer_list_t   rendered_sub_list;
-    int                changed;
 
     // VOBSUB && PGSSUB
     hb_buffer_list_t   sub_list; // List of active subs
 
     // SSA
-    ASS_Library       *ssa;
-    ASS_Renderer      *renderer;
-    ASS_Track         *ssa_track;
+    hb_ssa_cache_t    *ssa_cache;
+    ASS_Library       *ssa;              // Owned by ssa_cache
+    hb_ssa_render_t   *ssa_render;       // One per look-ahead thread
+    hb_ssa_render_t   *ssa_last_render;  // Renderer of the last blended frame
+    int                ssa_render_count;
+    taskset_t          ssa_taskset;
+    hb_buffer_list_t   ssa_pending;      // Frames waiting for their overlays
     uint8_t            script_initialized;
-    hb_box_vec_t       boxes;
     hb_csp_convert_f   rgb2yuv_fn;
 
     // SRT
@@ -611,42 +636,43 @@ static hb_buffer_t * compose_subsample_ass(hb_filter_private_t *pv, const ASS_Im
     return sub;
 }
 
-static void clear_ssa_rendered_sub_cache(hb_filter_private_t *pv)
+static void clear_ssa_rendered_sub_cache(hb_ssa_render_t *render)
 {
-    if (hb_buffer_list_count(&pv->rendered_sub_list))
+    if (hb_buffer_list_count(&render->rendered_sub_list))
     {
-        hb_buffer_list_close(&pv->rendered_sub_list);
-        hb_box_vec_clear(&pv->boxes);
+        hb_buffer_list_close(&render->rendered_sub_list);
+        hb_box_vec_clear(&render->boxes);
     }
 }
 
-static void render_ssa_subs(hb_filter_private_t *pv, int64_t start)
+static void render_ssa_subs(hb_filter_private_t *pv, hb_ssa_render_t *render,
+                            int64_t start)
 {
     int changed;
-    ASS_Image *frame_list = ass_render_frame(pv->renderer, pv->ssa_track,
+    ASS_Image *frame_list = ass_render_frame(render->renderer, render->track,
                                              start / 90, &changed);
     if (!frame_list)
     {
-        clear_ssa_rendered_sub_cache(pv);
+        clear_ssa_rendered_sub_cache(render);
     }
     else if (changed)
     {
         // Re-use cached overlays, whenever possible
-        clear_ssa_rendered_sub_cache(pv);
+        clear_ssa_rendered_sub_cache(render);
 
         // Find overlay size and pos of non overlapped boxes
         // (faster than composing at the video dimensions)
         for (ASS_Image *frame = frame_list; frame; frame = frame->next)
         {
-            hb_box_vec_append(&pv->boxes,
+            hb_box_vec_append(&render->boxes,
                                frame->dst_x, frame->dst_y,
                                frame->w + frame->dst_x, frame->h + frame->dst_y);
         }
 
-        for (int i = 0; i < pv->boxes.count; i++)
+        for (int i = 0; i < render->boxes.count; i++)
         {
             // Overlay must be aligned to the chroma plane, pad as needed.
-            hb_box_t box = pv->boxes.boxes[i];
+            hb_box_t box = render->boxes.boxes[i];
             int x = box.x1 - ((box.x1 + pv->crop[2]) & ((1 << pv->wshift) - 1));
             int y = box.y1 - ((box.y1 + pv->crop[0]) & ((1 << pv->hshift) - 1));
             int width  = box.x2 - x;
@@ -657,11 +683,22 @@ static void render_ssa_subs(hb_filter_private_t *pv, int64_t start)
             {
                 sub->f.x += pv->crop[2];
                 sub->f.y += pv->crop[0];
-                hb_buffer_list_append(&pv->rendered_sub_list, sub);
+                hb_buffer_list_append(&render->rendered_sub_list, sub);
             }
         }
     }
-    pv->changed = changed;
+    render->changed = changed;
+}
+
+static void ssa_render_thread(void *thread_args_v)
+{
+    ssa_thread_arg_t *thread_args = thread_args_v;
+
+    if (thread_args->in != NULL)
+    {
+        render_ssa_subs(thread_args->pv, thread_args->render,
+                        thread_args->in->s.start);
+    }
 }
 
 static void ssa_log(int level, const char *fmt, va_list args, void *data)
@@ -672,6 +709,220 @@ static void ssa_log(int level, const char *fmt, va_list args, void *data)
     }
 }
 
+// libass state kept for the lifetime of a hb_handle_t. Font attachments
+// are loaded and fontconfig is set up once for all the jobs sharing
+// them, and idle renderers keep their glyph and bitmap caches.
+// Renderers pick up fonts added to the library later on their own.
+#define SSA_CACHE_FONTS_MAX (128 * 1024 * 1024)
+
+typedef struct
+{
+    uint64_t    hash;
+    int         size;
+} ssa_cache_font_t;
+
+struct hb_ssa_cache_s
+{
+    hb_lock_t   *lock;
+    ASS_Library *ssa;
+    hb_list_t   *fonts;          // ssa_cache_font_t loaded in ssa
+    int64_t      fonts_size;
+    hb_list_t   *renderers;      // Idle ASS_Renderer
+    int          users;
+};
+
+hb_ssa_cache_t * hb_ssa_cache_init(void)
+{
+    hb_ssa_cache_t *cache = calloc(1, sizeof(hb_ssa_cache_t));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    cache->lock      = hb_lock_init();
+    cache->fonts     = hb_list_init();
+    cache->renderers = hb_list_init();
+    return cache;
+}
+
+static void ssa_cache_reset(hb_ssa_cache_t *cache)
+{
+    ASS_Renderer     *renderer;
+    ssa_cache_font_t *font;
+
+    while ((renderer = hb_list_item(cache->renderers, 0)) != NULL)
+    {
+        hb_list_rem(cache->renderers, renderer);
+        ass_renderer_done(renderer);
+    }
+    while ((font = hb_list_item(cache->fonts, 0)) != NULL)
+    {
+        hb_list_rem(cache->fonts, font);
+        free(font);
+    }
+    cache->fonts_size = 0;
+    if (cache->ssa != NULL)
+    {
+        ass_library_done(cache->ssa);
+        cache->ssa = NULL;
+    }
+}
+
+void hb_ssa_cache_close(hb_ssa_cache_t **_cache)
+{
+    hb_ssa_cache_t *cache = *_cache;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+    ssa_cache_reset(cache);
+    hb_list_close(&cache->fonts);
+    hb_list_close(&cache->renderers);
+    hb_lock_close(&cache->lock);
+    free(cache);
+    *_cache = NULL;
+}
+
+static uint64_t ssa_font_hash(const uint8_t *data, int size)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int ii = 0; ii < size; ii++)
+    {
+        hash = (hash ^ data[ii]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int ssa_cache_has_font(hb_ssa_cache_t *cache, uint64_t hash, int size)
+{
+    for (int ii = 0; ii < hb_list_count(cache->fonts); ii++)
+    {
+        ssa_cache_font_t *font = hb_list_item(cache->fonts, ii);
+        if (font->hash == hash && font->size == size)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the cached library with the font attachments loaded
+static ASS_Library * ssa_cache_open(hb_ssa_cache_t *cache,
+                                    hb_list_t *list_attachment)
+{
+    hb_lock(cache->lock);
+    if (cache->users == 0 && cache->fonts_size > SSA_CACHE_FONTS_MAX)
+    {
+        // Do not let fonts pile up forever, start over
+        ssa_cache_reset(cache);
+    }
+    if (cache->ssa == NULL)
+    {
+        cache->ssa = ass_library_init();
+        if (cache->ssa == NULL)
+        {
+            hb_unlock(cache->lock);
+            return NULL;
+        }
+
+        // Redirect libass output to hb_log
+        ass_set_message_cb(cache->ssa, ssa_log, NULL);
+        ass_set_extract_fonts(cache->ssa, 1);
+        ass_set_style_overrides(cache->ssa, NULL);
+    }
+
+    // Load embedded fonts not loaded by a previous job
+    for (int i = 0; i < hb_list_count(list_attachment); i++)
+    {
+        hb_attachment_t *attachment = hb_list_item(list_attachment, i);
+
+        if (attachment->type == FONT_TTF_ATTACH ||
+            attachment->type == FONT_OTF_ATTACH)
+        {
+            uint64_t hash = ssa_font_hash((uint8_t *)attachment->data,
+                                          attachment->size);
+            if (ssa_cache_has_font(cache, hash, attachment->size))
+            {
+                continue;
+            }
+
+            ssa_cache_font_t *font = malloc(sizeof(ssa_cache_font_t));
+            if (font != NULL)
+            {
+                font->hash = hash;
+                font->size = attachment->size;
+                hb_list_add(cache->fonts, font);
+                cache->fonts_size += attachment->size;
+            }
+            ass_add_font(cache->ssa,
+                         attachment->name,
+                         attachment->data,
+                         attachment->size);
+        }
+    }
+    cache->users++;
+    hb_unlock(cache->lock);
+
+    return cache->ssa;
+}
+
+static void ssa_cache_release(hb_ssa_cache_t *cache)
+{
+    hb_lock(cache->lock);
+    cache->users--;
+    hb_unlock(cache->lock);
+}
+
+static ASS_Renderer * ssa_cache_renderer_get(hb_ssa_cache_t *cache)
+{
+    ASS_Renderer *renderer;
+
+    hb_lock(cache->lock);
+    renderer = hb_list_item(cache->renderers, 0);
+    if (renderer != NULL)
+    {
+        hb_list_rem(cache->renderers, renderer);
+        hb_unlock(cache->lock);
+        return renderer;
+    }
+
+    renderer = ass_renderer_init(cache->ssa);
+    if (renderer != NULL)
+    {
+        ass_set_use_margins(renderer, 0);
+        ass_set_hinting(renderer, ASS_HINTING_NONE);
+        ass_set_font_scale(renderer, 1.0);
+        ass_set_line_spacing(renderer, 1.0);
+
+        // Setup default font family
+        //
+        // SSA v4.00 requires that "Arial" be the default font
+        const char *font = NULL;
+        const char *family = "Arial";
+        // NOTE: This can sometimes block for several *seconds*.
+        //       It seems that process_fontdata() for some embedded fonts is slow.
+        ass_set_fonts(renderer, font, family, /*haveFontConfig=*/1, NULL, 1);
+    }
+    hb_unlock(cache->lock);
+
+    return renderer;
+}
+
+static void ssa_cache_renderer_put(hb_ssa_cache_t *cache, ASS_Renderer *renderer)
+{
+    hb_lock(cache->lock);
+    if (hb_list_count(cache->renderers) < SSA_LOOKAHEAD_MAX)
+    {
+        hb_list_add(cache->renderers, renderer);
+    }
+    else
+    {
+        ass_renderer_done(renderer);
+    }
+    hb_unlock(cache->lock);
+}
+
 static int ssa_post_init(hb_filter_object_t *filter, hb_job_t *job)
 {
     hb_filter_private_t *pv = filter->private_data;
@@ -711,74 +962,88 @@ static int ssa_post_init(hb_filter_object_t *filter, hb_job_t *job)
             break;
     }
 
-    pv->ssa = ass_library_init();
+    pv->ssa_cache = hb_ssa_cache_get(job->h);
+    if (!pv->ssa_cache)
+    {
+        hb_error("decssasub: no libass cache\n");
+        return 1;
+    }
+    pv->ssa = ssa_cache_open(pv->ssa_cache, job->list_attachment);
     if (!pv->ssa)
     {
         hb_error("decssasub: libass initialization failed\n");
         return 1;
     }
 
-    // Redirect libass output to hb_log
-    ass_set_message_cb(pv->ssa, ssa_log, NULL);
-
-    // Load embedded fonts
-    hb_list_t *list_attachment = job->list_attachment;
-    for (int i = 0; i < hb_list_count(list_attachment); i++)
+    // Native SSA tracks are fully known ahead of the video frames,
+    // so render several frames in parallel, each with its own
+    // renderer. Other formats are fed incrementally and need a
+    // single renderer.
+    pv->ssa_render_count = 1;
+    if (pv->type == SSASUB)
     {
-        hb_attachment_t *attachment = hb_list_item(list_attachment, i);
-
-        if (attachment->type == FONT_TTF_ATTACH ||
-            attachment->type == FONT_OTF_ATTACH)
-        {
-            ass_add_font(pv->ssa,
-                         attachment->name,
-                         attachment->data,
-                         attachment->size);
-        }
+        pv->ssa_render_count = MIN(hb_get_cpu_count(), SSA_LOOKAHEAD_MAX);
     }
-
-    ass_set_extract_fonts(pv->ssa, 1);
-    ass_set_style_overrides(pv->ssa, NULL);
-
-    pv->renderer = ass_renderer_init(pv->ssa);
-    if (!pv->renderer)
+    pv->ssa_render = calloc(pv->ssa_render_count, sizeof(hb_ssa_render_t));
+    if (!pv->ssa_render)
     {
-        hb_log("decssasub: renderer initialization failed\n");
+        hb_error("decssasub: calloc failed");
         return 1;
     }
 
-    ass_set_use_margins(pv->renderer, 0);
-    ass_set_hinting(pv->renderer, ASS_HINTING_NONE);
-    ass_set_font_scale(pv->renderer, 1.0);
-    ass_set_line_spacing(pv->renderer, 1.0);
-
-    // Setup default font family
-    //
-    // SSA v4.00 requires that "Arial" be the default font
-    const char *font = NULL;
-    const char *family = "Arial";
-    // NOTE: This can sometimes block for several *seconds*.
-    //       It seems that process_fontdata() for some embedded fonts is slow.
-    ass_set_fonts(pv->renderer, font, family, /*haveFontConfig=*/1, NULL, 1);
+    int height = job->title->geometry.height - job->crop[0] - job->crop[1];
+    int width = job->title->geometry.width - job->crop[2] - job->crop[3];
 
-    // Setup track state
-    pv->ssa_track = ass_new_track(pv->ssa);
-    if (!pv->ssa_track)
+    for (int ii = 0; ii < pv->ssa_render_count; ii++)
     {
-        hb_log("decssasub: ssa track initialization failed\n");
-        return 1;
+        hb_ssa_render_t *render = &pv->ssa_render[ii];
+
+        render->renderer = ssa_cache_renderer_get(pv->ssa_cache);
+        if (!render->renderer)
+        {
+            hb_log("decssasub: renderer initialization failed\n");
+            return 1;
+        }
+
+        // Setup track state
+        render->track = ass_new_track(pv->ssa);
+        if (!render->track)
+        {
+            hb_log("decssasub: ssa track initialization failed\n");
+            return 1;
+        }
+
+        // Do not use Read Order to eliminate duplicates
+        // we never send the same subtitles sample twice,
+        // and some MKVs have duplicated Read Orders
+        // and won't render properly when this is enabled.
+        ass_set_check_readorder(render->track, 0);
+
+        ass_set_frame_size(render->renderer, width, height);
+        ass_set_storage_size(render->renderer, width, height);
     }
 
-    // Do not use Read Order to eliminate duplicates
-    // we never send the same subtitles sample twice,
-    // and some MKVs have duplicated Read Orders
-    // and won't render properly when this is enabled.
-    ass_set_check_readorder(pv->ssa_track, 0);
+    if (pv->ssa_render_count > 1)
+    {
+        if (taskset_init(&pv->ssa_taskset, "ssa_render", pv->ssa_render_count,
+                         sizeof(ssa_thread_arg_t), ssa_render_thread) == 0)
+        {
+            hb_error("decssasub: could not initialize taskset");
+            // taskset_init() frees its memory on failure
+            memset(&pv->ssa_taskset, 0, sizeof(pv->ssa_taskset));
+            return 1;
+        }
+        for (int ii = 0; ii < pv->ssa_render_count; ii++)
+        {
+            ssa_thread_arg_t *thread_args;
 
-    int height = job->title->geometry.height - job->crop[0] - job->crop[1];
-    int width = job->title->geometry.width - job->crop[2] - job->crop[3];
-    ass_set_frame_size(pv->renderer, width, height);
-    ass_set_storage_size(pv->renderer, width, height);
+            thread_args = taskset_thread_args(&pv->ssa_taskset, ii);
+            thread_args->pv = pv;
+            thread_args->render = &pv->ssa_render[ii];
+            thread_args->arg.segment = ii;
+            thread_args->arg.taskset = &pv->ssa_taskset;
+        }
+    }
 
     return 0;
 }
@@ -792,19 +1057,31 @@ static void ssa_close(hb_filter_object_t *filter)
         return;
     }
 
-    if (pv->ssa_track)
+    if (pv->ssa_render_count > 1)
     {
-        ass_free_track(pv->ssa_track);
+        taskset_fini(&pv->ssa_taskset);
     }
-    if (pv->renderer)
+    hb_buffer_list_close(&pv->ssa_pending);
+    for (int ii = 0; pv->ssa_render != NULL && ii < pv->ssa_render_count; ii++)
     {
-        ass_renderer_done(pv->renderer);
+        hb_ssa_render_t *render = &pv->ssa_render[ii];
+
+        if (render->track)
+        {
+            ass_free_track(render->track);
+        }
+        if (render->renderer)
+        {
+            ssa_cache_renderer_put(pv->ssa_cache, render->renderer);
+        }
+        hb_buffer_list_close(&render->rendered_sub_list);
+        hb_box_vec_close(&render->boxes);
     }
+    free(pv->ssa_render);
     if (pv->ssa)
     {
-        ass_library_done(pv->ssa);
+        ssa_cache_release(pv->ssa_cache);
     }
-    hb_box_vec_close(&pv->boxes);
 
     free(pv);
     filter->private_data = NULL;
@@ -818,9 +1095,13 @@ static void ssa_work_init(hb_filter_private_t *pv, const hb_data_t *sub_data)
     // get initialized until the decoder is initialized.  Since
     // decoder initialization happens after filter initialization,
     // we need to postpone this.
-    ass_process_codec_private(pv->ssa_track, (const char *)sub_data->bytes, sub_data->size);
+    for (int ii = 0; ii < pv->ssa_render_count; ii++)
+    {
+        ass_process_codec_private(pv->ssa_render[ii].track,
+                                  (const char *)sub_data->bytes, sub_data->size);
+    }
 
-    switch(pv->ssa_track->YCbCrMatrix)
+    switch(pv->ssa_render[0].track->YCbCrMatrix)
     {
     case YCBCR_DEFAULT: //No YCbCrMatrix header: VSFilter default
     case YCBCR_FCC_TV:  //FCC is almost the same as 601
@@ -844,6 +1125,60 @@ static void ssa_work_init(hb_filter_private_t *pv, const hb_data_t *sub_data)
     }
 }
 
+// Blenders only upload the overlays when they changed since the previous
+// frame, so changing to another renderer counts as a change too
+static hb_buffer_t * ssa_blend(hb_filter_private_t *pv, hb_ssa_render_t *render,
+                               hb_buffer_t *in)
+{
+    int changed = render->changed || render != pv->ssa_last_render;
+
+    pv->ssa_last_render = render;
+    return pv->blend->work(pv->blend, in, &render->rendered_sub_list, changed);
+}
+
+// Renders the overlays of the pending frames, one frame per renderer
+// in parallel, then blends them in order. A given renderer always
+// gets the same position in the batch, so its overlay cache and
+// change detection follow every n-th frame of the video.
+static hb_buffer_t * ssa_render_pending(hb_filter_private_t *pv)
+{
+    hb_buffer_list_t list;
+
+    hb_buffer_list_clear(&list);
+    if (pv->ssa_render_count == 1)
+    {
+        hb_buffer_t *in = hb_buffer_list_rem_head(&pv->ssa_pending);
+        if (in != NULL)
+        {
+            hb_ssa_render_t *render = &pv->ssa_render[0];
+            render_ssa_subs(pv, render, in->s.start);
+            hb_buffer_list_append(&list, ssa_blend(pv, render, in));
+        }
+        return hb_buffer_list_clear(&list);
+    }
+
+    for (int ii = 0; ii < pv->ssa_render_count; ii++)
+    {
+        ssa_thread_arg_t *thread_args = taskset_thread_args(&pv->ssa_taskset, ii);
+        thread_args->in = hb_buffer_list_rem_head(&pv->ssa_pending);
+    }
+
+    taskset_cycle(&pv->ssa_taskset);
+
+    for (int ii = 0; ii < pv->ssa_render_count; ii++)
+    {
+        ssa_thread_arg_t *thread_args = taskset_thread_args(&pv->ssa_taskset, ii);
+        hb_ssa_render_t  *render      = thread_args->render;
+
+        if (thread_args->in != NULL)
+        {
+            hb_buffer_list_append(&list, ssa_blend(pv, render, thread_args->in));
+            thread_args->in = NULL;
+        }
+    }
+    return hb_buffer_list_clear(&list);
+}
+
 static int ssa_work(hb_filter_object_t *filter,
                     hb_buffer_t **buf_in,
                     hb_buffer_t **buf_out)
@@ -859,8 +1194,13 @@ static int ssa_work(hb_filter_object_t *filter,
     }
     if (in->s.flags & HB_BUF_FLAG_EOF)
     {
+        hb_buffer_list_t list;
+
+        hb_buffer_list_clear(&list);
+        hb_buffer_list_append(&list, ssa_render_pending(pv));
+        hb_buffer_list_append(&list, in);
         *buf_in = NULL;
-        *buf_out = in;
+        *buf_out = hb_buffer_list_clear(&list);
         return HB_FILTER_DONE;
     }
 
@@ -876,16 +1216,25 @@ static int ssa_work(hb_filter_object_t *filter,
         // Parse MKV-SSA packet
         // SSA subtitles always have an explicit stop time, so we
         // do not need to do special processing for stop == AV_NOPTS_VALUE
-        ass_process_chunk(pv->ssa_track, (char *)sub->data, sub->size,
-                          sub->s.start / 90,
-                          (sub->s.stop - sub->s.start) / 90);
+        for (int ii = 0; ii < pv->ssa_render_count; ii++)
+        {
+            ass_process_chunk(pv->ssa_render[ii].track,
+                              (char *)sub->data, sub->size,
+                              sub->s.start / 90,
+                              (sub->s.stop - sub->s.start) / 90);
+        }
         hb_buffer_close(&sub);
     }
 
-    render_ssa_subs(pv, in->s.start);
-
-    *buf_in  = NULL;
-    *buf_out = pv->blend->work(pv->blend, in, &pv->rendered_sub_list, pv->changed);
+    *buf_in = NULL;
+    hb_buffer_list_append(&pv->ssa_pending, in);
+    if (hb_buffer_list_count(&pv->ssa_pending) < pv->ssa_render_count)
+    {
+        // Wait for a frame per renderer
+        *buf_out = NULL;
+        return HB_FILTER_OK;
+    }
+    *buf_out = ssa_render_pending(pv);
 
     return HB_FILTER_OK;
 }
@@ -907,7 +1256,7 @@ static void textsub_close(hb_filter_object_t *filter)
 
 static void process_sub(hb_filter_private_t *pv, hb_buffer_t *sub)
 {
-    ass_process_chunk(pv->ssa_track, (char *)sub->data, sub->size,
+    ass_process_chunk(pv->ssa_render[0].track, (char *)sub->data, sub->size,
                       sub->s.start, sub->s.stop - sub->s.start);
 }
 
@@ -1005,10 +1354,11 @@ static int textsub_work(hb_filter_object_t *filter,
         process_sub(pv, pv->current_sub);
     }
 
-    render_ssa_subs(pv, in->s.start);
+    hb_ssa_render_t *render = &pv->ssa_render[0];
+    render_ssa_subs(pv, render, in->s.start);
 
     *buf_in  = NULL;
-    *buf_out = pv->blend->work(pv->blend, in, &pv->rendered_sub_list, pv->changed);
+    *buf_out = pv->blend->work(pv->blend, in, &render->rendered_sub_list, render->changed);
 
     return HB_FILTER_OK;
 }
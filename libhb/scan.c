@@ -11,6 +11,12 @@
 #include "handbrake/hbffmpeg.h"
 #include "handbrake/hwaccel.h"
 
+#if ARCH_X86_64
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 typedef struct
 {
     hb_handle_t  * h;
@@ -38,20 +44,39 @@ typedef struct
     hb_list_t    * exclude_extensions;
 
     int            hw_decode;
+    int            fast;        // decode keyframes only
+
+    int            parallel;    // titles are being scanned by ScanPool
     
 } hb_scan_t;
 
+/* Files scanned concurrently, each one by its own worker and decoder */
+typedef struct
+{
+    hb_scan_t    * data;
+    hb_lock_t    * lock;
+    int            count;
+    int            next;
+    int            done;
+    hb_title_t  ** titles;  // results, in file order
+} scan_pool_t;
+
 #define PREVIEW_READ_THRESH (200)
 #define AUDIO_DECODE_ERROR_LIMIT (10)
+#define SCAN_MAX_THREADS (8)
 
 static void ScanFunc( void * );
-static int  DecodePreviews( hb_scan_t *, hb_title_t * title, int flush );
+static int  ScanTitle( hb_scan_t *, hb_title_t * title, int * hw_decode );
+static int  ScanPool( hb_scan_t *, int count );
+static int  DecodePreviews( hb_scan_t *, hb_title_t * title, int flush,
+                            int hw_decode );
 static hb_audio_t * find_audio_for_id(hb_title_t * title, int id);
 static void LookForAudio(hb_scan_t *scan, hb_title_t *title, hb_audio_t * audio, hb_buffer_t *b);
 static int  AllAudioOK( hb_title_t * title );
 static void UpdateState1(hb_scan_t *scan, int title);
 static void UpdateState2(hb_scan_t *scan, int title);
 static void UpdateState3(hb_scan_t *scan, int preview);
+static void UpdateStatePool(hb_scan_t *scan, int done, int count);
 
 static const char *aspect_to_string(hb_rational_t *dar)
 {
@@ -92,7 +117,7 @@ hb_thread_t * hb_scan_init( hb_handle_t * handle, volatile int * die,
                             int store_previews, uint64_t min_duration, uint64_t max_duration,
                             int crop_threshold_frames, int crop_threshold_pixels,
                             hb_list_t * exclude_extensions, int hw_decode,
-                            int keep_duplicate_titles)
+                            int keep_duplicate_titles, int fast)
 {
     hb_scan_t * data = calloc( sizeof( hb_scan_t ), 1 );
 
@@ -112,6 +137,7 @@ hb_thread_t * hb_scan_init( hb_handle_t * handle, volatile int * die,
     data->exclude_extensions    = hb_string_list_copy(exclude_extensions);
     data->hw_decode             = hw_decode;
     data->keep_duplicate_titles = keep_duplicate_titles;
+    data->fast                  = fast;
     
     // Initialize scan state
     hb_state_t state;
@@ -135,6 +161,7 @@ static void ScanFunc( void * _data )
     hb_title_t * title;
     int          i;
     int          feature = 0;
+    int          previews_done = 0;
 
     data->bd = NULL;
     data->dvd = NULL;
@@ -210,22 +237,11 @@ static void ScanFunc( void * _data )
         }
         else
         {
-            /* Scan all titles */
-            for( i = 0; i < hb_batch_title_count( data->batch ); i++ )
+            /* Scan all titles, previews included */
+            previews_done = 1;
+            if (ScanPool(data, hb_batch_title_count(data->batch)))
             {
-                if (*data->die)
-                {
-                    goto finish;
-                }
-
-                hb_title_t * title;
-
-                UpdateState1(data, i + 1);
-                title = hb_batch_title_scan(data->batch, i + 1);
-                if ( title != NULL )
-                {
-                    hb_list_add( data->title_set->list_title, title );
-                }
+                goto finish;
             }
         }
     }
@@ -257,33 +273,16 @@ static void ScanFunc( void * _data )
     else // We have many file paths to process.
     {
         // If dragging a batch of files, maybe not, but if the UI's implement a recursive folder maybe?
-        for (i = 0; i < hb_list_count( data->paths ); i++)
+        previews_done = 1;
+        if (ScanPool(data, hb_list_count(data->paths)))
         {
-            if (*data->die)
-            {
-                goto finish;
-            }
-
-            char *path = hb_list_item(data->paths, i);
-
-            UpdateState1(data, i + 1);
-
-            if (hb_is_valid_batch_path(path))
-            {
-                title = hb_batch_title_scan_single(data->h, path, (int)i + 1);
-                if (title != NULL)
-                {
-                    hb_list_add(data->title_set->list_title, title);
-                }
-            }
+            goto finish;
         }
     }
 
-    for( i = 0; i < hb_list_count( data->title_set->list_title ); )
+    for (i = 0; i < hb_list_count(data->title_set->list_title) &&
+                !previews_done; )
     {
-        int j, npreviews;
-        hb_audio_t * audio;
-
         if ( *data->die )
         {
             goto finish;
@@ -292,81 +291,12 @@ static void ScanFunc( void * _data )
 
         UpdateState2(data, i + 1);
 
-        /* Decode previews */
-        /* this will also detect more AC3 / DTS information */
-        npreviews = DecodePreviews( data, title, 1 );
-        if (npreviews == 0 && data->hw_decode)
-        {
-            // Try without the hardware decoder
-            // Some hwaccel implementations don't automatically
-            // fall back to the software encoder
-            data->hw_decode = 0;
-            npreviews = DecodePreviews( data, title, 1 );
-        }
-        if (npreviews < 2)
+        if (!ScanTitle(data, title, &data->hw_decode))
         {
-            // Try harder to get some valid frames
-            // Allow libav to return "corrupt" frames
-            hb_log("scan: Too few previews (%d), trying harder", npreviews);
-            title->flags |= HBTF_NO_IDR;
-            npreviews = DecodePreviews( data, title, 0 );
-        }
-        if (npreviews == 0)
-        {
-            /* TODO: free things */
-            hb_list_rem( data->title_set->list_title, title );
-            for( j = 0; j < hb_list_count( title->list_audio ); j++)
-            {
-                audio = hb_list_item( title->list_audio, j );
-                if ( audio->priv.scan_cache )
-                {
-                    hb_fifo_flush( audio->priv.scan_cache );
-                    hb_fifo_close( &audio->priv.scan_cache );
-                }
-            }
-            hb_title_close( &title );
+            hb_list_rem(data->title_set->list_title, title);
+            hb_title_close(&title);
             continue;
         }
-        title->preview_count = npreviews;
-
-        /* Make sure we found audio rates and bitrates */
-        for( j = 0; j < hb_list_count( title->list_audio ); )
-        {
-            audio = hb_list_item( title->list_audio, j );
-            if ( audio->priv.scan_cache )
-            {
-                hb_fifo_flush( audio->priv.scan_cache );
-                hb_fifo_close( &audio->priv.scan_cache );
-            }
-            if( !audio->config.in.bitrate )
-            {
-                hb_log( "scan: removing audio 0x%x because no bitrate found",
-                        audio->id );
-                hb_list_rem( title->list_audio, audio );
-                free( audio );
-                continue;
-            }
-            j++;
-        }
-
-        for (j = 0; j < hb_list_count(title->list_subtitle); j++)
-        {
-            hb_subtitle_t *subtitle = hb_list_item(title->list_subtitle, j);
-            if ((subtitle->source == VOBSUB || subtitle->source == PGSSUB) &&
-                (subtitle->width <= 0 || subtitle->height <= 0))
-            {
-                // VOBSUB and PGS width and height needs to be set to the
-                // title width and height for any stream type that does
-                // not provide this information (DVDs, BDs, VOBs, and M2TSs).
-                // Title width and height don't get set until we decode
-                // previews, so we can't set subtitle width/height till
-                // we get here.
-                subtitle->width  = title->geometry.width;
-                subtitle->height = title->geometry.height;
-            }
-            // Initialize subtitle extradata if not set by demux already
-            hb_subtitle_extradata_init(subtitle);
-        }
         i++;
     }
 
@@ -437,6 +367,191 @@ finish:
     hb_buffer_pool_free();
 }
 
+/***********************************************************************
+ * ScanTitle
+ ***********************************************************************
+ * Decodes the previews of a title and checks its audio and subtitle
+ * tracks. Returns 0 if the title is unusable and must be dropped.
+ **********************************************************************/
+static int ScanTitle( hb_scan_t * data, hb_title_t * title, int * hw_decode )
+{
+    int          j, npreviews;
+    hb_audio_t * audio;
+
+    /* Decode previews */
+    /* this will also detect more AC3 / DTS information */
+    npreviews = DecodePreviews( data, title, 1, *hw_decode );
+    if (npreviews == 0 && *hw_decode)
+    {
+        // Try without the hardware decoder
+        // Some hwaccel implementations don't automatically
+        // fall back to the software encoder
+        *hw_decode = 0;
+        npreviews = DecodePreviews( data, title, 1, *hw_decode );
+    }
+    if (npreviews < 2)
+    {
+        // Try harder to get some valid frames
+        // Allow libav to return "corrupt" frames
+        hb_log("scan: Too few previews (%d), trying harder", npreviews);
+        title->flags |= HBTF_NO_IDR;
+        npreviews = DecodePreviews( data, title, 0, *hw_decode );
+    }
+    if (npreviews == 0)
+    {
+        for( j = 0; j < hb_list_count( title->list_audio ); j++)
+        {
+            audio = hb_list_item( title->list_audio, j );
+            if ( audio->priv.scan_cache )
+            {
+                hb_fifo_flush( audio->priv.scan_cache );
+                hb_fifo_close( &audio->priv.scan_cache );
+            }
+        }
+        return 0;
+    }
+    title->preview_count = npreviews;
+
+    /* Make sure we found audio rates and bitrates */
+    for( j = 0; j < hb_list_count( title->list_audio ); )
+    {
+        audio = hb_list_item( title->list_audio, j );
+        if ( audio->priv.scan_cache )
+        {
+            hb_fifo_flush( audio->priv.scan_cache );
+            hb_fifo_close( &audio->priv.scan_cache );
+        }
+        if( !audio->config.in.bitrate )
+        {
+            hb_log( "scan: removing audio 0x%x because no bitrate found",
+                    audio->id );
+            hb_list_rem( title->list_audio, audio );
+            free( audio );
+            continue;
+        }
+        j++;
+    }
+
+    for (j = 0; j < hb_list_count(title->list_subtitle); j++)
+    {
+        hb_subtitle_t *subtitle = hb_list_item(title->list_subtitle, j);
+        if ((subtitle->source == VOBSUB || subtitle->source == PGSSUB) &&
+            (subtitle->width <= 0 || subtitle->height <= 0))
+        {
+            // VOBSUB and PGS width and height needs to be set to the
+            // title width and height for any stream type that does
+            // not provide this information (DVDs, BDs, VOBs, and M2TSs).
+            // Title width and height don't get set until we decode
+            // previews, so we can't set subtitle width/height till
+            // we get here.
+            subtitle->width  = title->geometry.width;
+            subtitle->height = title->geometry.height;
+        }
+        // Initialize subtitle extradata if not set by demux already
+        hb_subtitle_extradata_init(subtitle);
+    }
+    return 1;
+}
+
+static void ScanPoolFunc( void * _pool )
+{
+    scan_pool_t * pool = (scan_pool_t *)_pool;
+    hb_scan_t   * data = pool->data;
+    hb_title_t  * title;
+    int           index, hw_decode = data->hw_decode;
+
+    while (!*data->die)
+    {
+        hb_lock(pool->lock);
+        index = pool->next++;
+        hb_unlock(pool->lock);
+        if (index >= pool->count)
+        {
+            break;
+        }
+
+        if (data->batch)
+        {
+            title = hb_batch_title_scan(data->batch, index + 1);
+        }
+        else
+        {
+            title = hb_batch_title_scan_single(data->h,
+                                        hb_list_item(data->paths, index),
+                                        index + 1);
+        }
+        if (title != NULL && !ScanTitle(data, title, &hw_decode))
+        {
+            hb_title_close(&title);
+        }
+        pool->titles[index] = title;
+
+        hb_lock(pool->lock);
+        UpdateStatePool(data, ++pool->done, pool->count);
+        hb_unlock(pool->lock);
+    }
+}
+
+/***********************************************************************
+ * ScanPool
+ ***********************************************************************
+ * Scans the files of a batch or of a multi-path scan on a pool of
+ * worker threads. Each file is a title with its own stream and decoder,
+ * so files are independent of each other. Titles are added to the
+ * title set in file order, whatever order they finish in.
+ * Returns 1 if the scan was cancelled.
+ **********************************************************************/
+static int ScanPool( hb_scan_t * data, int count )
+{
+    scan_pool_t    pool = { .data = data, .count = count };
+    hb_thread_t ** threads;
+    int            ii, nthreads;
+
+    nthreads = MIN(hb_get_cpu_count(), SCAN_MAX_THREADS);
+    nthreads = MAX(1, MIN(nthreads, count));
+
+    pool.lock   = hb_lock_init();
+    pool.titles = calloc(count + 1, sizeof(hb_title_t *));
+    threads     = calloc(nthreads, sizeof(hb_thread_t *));
+    if (pool.titles == NULL || threads == NULL)
+    {
+        hb_error("scan: out of memory");
+        free(pool.titles);
+        free(threads);
+        hb_lock_close(&pool.lock);
+        return 1;
+    }
+
+    hb_log("scan: scanning %d file(s) with %d thread(s)", count, nthreads);
+    data->parallel = 1;
+    for (ii = 0; ii < nthreads; ii++)
+    {
+        threads[ii] = hb_thread_init("scan worker", ScanPoolFunc, &pool,
+                                     HB_NORMAL_PRIORITY);
+    }
+    for (ii = 0; ii < nthreads; ii++)
+    {
+        if (threads[ii] != NULL)
+        {
+            hb_thread_close(&threads[ii]);
+        }
+    }
+    data->parallel = 0;
+
+    for (ii = 0; ii < count; ii++)
+    {
+        if (pool.titles[ii] != NULL)
+        {
+            hb_list_add(data->title_set->list_title, pool.titles[ii]);
+        }
+    }
+    free(pool.titles);
+    free(threads);
+    hb_lock_close(&pool.lock);
+
+    return *data->die != 0;
+}
+
 // -----------------------------------------------
 // stuff related to cropping
 
@@ -460,8 +575,28 @@ static int row_all_dark( hb_buffer_t* buf, int row )
     uint8_t *luma = buf->plane[0].data + stride * row;
 
     // compute the average luma value of the row
-    int i, avg = 0;
-    for ( i = 0; i < width; ++i )
+    int i = 0, avg = 0;
+#if ARCH_X86_64
+    const __m128i black = _mm_set1_epi8(16);
+    __m128i       sum   = _mm_setzero_si128();
+    for ( ; i + 16 <= width; i += 16 )
+    {
+        __m128i v = _mm_max_epu8(_mm_loadu_si128((const __m128i *)(luma + i)),
+                                 black);
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(v, _mm_setzero_si128()));
+    }
+    avg = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#elif defined(__aarch64__)
+    const uint8x16_t black = vdupq_n_u8(16);
+    uint32x4_t       sum   = vdupq_n_u32(0);
+    for ( ; i + 16 <= width; i += 16 )
+    {
+        uint8x16_t v = vmaxq_u8(vld1q_u8(luma + i), black);
+        sum = vpadalq_u16(sum, vpaddlq_u8(v));
+    }
+    avg = vaddvq_u32(sum);
+#endif
+    for ( ; i < width; ++i )
     {
         avg += clampBlack( luma[i] );
     }
@@ -473,7 +608,25 @@ static int row_all_dark( hb_buffer_t* buf, int row )
     // all pixels are within +-16 of the average (this range is fairly coarse
     // but there's a lot of quantization noise for luma values near black
     // so anything less will fail to crop because of the noise).
-    for ( i = 0; i < width; ++i )
+    // The average is in [16, DARK), so only the upper bound can be crossed.
+    i = 0;
+#if ARCH_X86_64
+    const __m128i limit = _mm_set1_epi8(avg + 16);
+    for ( ; i + 16 <= width; i += 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(luma + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, limit),
+                                             limit)) != 0xffff)
+            return 0;
+    }
+#elif defined(__aarch64__)
+    for ( ; i + 16 <= width; i += 16 )
+    {
+        if ( vmaxvq_u8(vld1q_u8(luma + i)) > avg + 16 )
+            return 0;
+    }
+#endif
+    for ( ; i < width; ++i )
     {
         if ( absdiff( avg, clampBlack( luma[i] ) ) > 16 )
             return 0;
@@ -507,6 +660,125 @@ static int column_all_dark( hb_buffer_t* buf, int top, int bottom, int col )
     }
     return 1;
 }
+
+#if ARCH_X86_64 || defined(__aarch64__)
+// Same as column_all_dark for the 16 columns starting at col.
+// Returns a mask with bit n set if column col + n is all dark.
+static int columns_all_dark_16( hb_buffer_t* buf, int top, int bottom, int col )
+{
+    int stride = buf->plane[0].stride;
+    int height = buf->plane[0].height - top - bottom;
+    uint8_t *luma = buf->plane[0].data + stride * top + col;
+    uint32_t sums[16];
+    uint8_t  limits[16];
+    int      i, mask = 0, dark = 0;
+
+    // compute the average value of each column
+#if ARCH_X86_64
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i black = _mm_set1_epi8(16);
+    __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+    for ( i = 0; i < height; i++ )
+    {
+        __m128i v  = _mm_max_epu8(_mm_loadu_si128((const __m128i *)(luma + i * stride)),
+                                  black);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        s0 = _mm_add_epi32(s0, _mm_unpacklo_epi16(lo, zero));
+        s1 = _mm_add_epi32(s1, _mm_unpackhi_epi16(lo, zero));
+        s2 = _mm_add_epi32(s2, _mm_unpacklo_epi16(hi, zero));
+        s3 = _mm_add_epi32(s3, _mm_unpackhi_epi16(hi, zero));
+    }
+    _mm_storeu_si128((__m128i *)(sums +  0), s0);
+    _mm_storeu_si128((__m128i *)(sums +  4), s1);
+    _mm_storeu_si128((__m128i *)(sums +  8), s2);
+    _mm_storeu_si128((__m128i *)(sums + 12), s3);
+#else
+    const uint8x16_t black = vdupq_n_u8(16);
+    uint32x4_t s0 = vdupq_n_u32(0), s1 = s0, s2 = s0, s3 = s0;
+    for ( i = 0; i < height; i++ )
+    {
+        uint8x16_t v  = vmaxq_u8(vld1q_u8(luma + i * stride), black);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        s0 = vaddw_u16(s0, vget_low_u16(lo));
+        s1 = vaddw_u16(s1, vget_high_u16(lo));
+        s2 = vaddw_u16(s2, vget_low_u16(hi));
+        s3 = vaddw_u16(s3, vget_high_u16(hi));
+    }
+    vst1q_u32(sums +  0, s0);
+    vst1q_u32(sums +  4, s1);
+    vst1q_u32(sums +  8, s2);
+    vst1q_u32(sums + 12, s3);
+#endif
+    for ( i = 0; i < 16; i++ )
+    {
+        int avg = sums[i] / height;
+        limits[i] = avg < DARK ? avg + 16 : 0;
+        dark |= (avg < DARK) << i;
+    }
+    if ( dark == 0 )
+        return 0;
+
+    // only take the columns whose pixels are all within +-16 of
+    // their average, as in column_all_dark
+#if ARCH_X86_64
+    const __m128i limit = _mm_loadu_si128((const __m128i *)limits);
+    __m128i ok = _mm_cmpeq_epi8(zero, zero);
+    for ( i = 0; i < height; i++ )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(luma + i * stride));
+        ok = _mm_and_si128(ok, _mm_cmpeq_epi8(_mm_max_epu8(v, limit), limit));
+    }
+    mask = _mm_movemask_epi8(ok);
+#else
+    const uint8x16_t limit = vld1q_u8(limits);
+    uint8x16_t ok = vdupq_n_u8(0xff);
+    for ( i = 0; i < height; i++ )
+    {
+        ok = vandq_u8(ok, vcleq_u8(vld1q_u8(luma + i * stride), limit));
+    }
+    vst1q_u8(limits, ok);
+    for ( i = 0; i < 16; i++ )
+    {
+        mask |= (limits[i] != 0) << i;
+    }
+#endif
+    return dark & mask;
+}
+#endif
+
+// Number of consecutive dark columns from the left (or right)
+// border of the frame, up to max
+static int count_dark_columns( hb_buffer_t* buf, int top, int bottom,
+                               int max, int from_right )
+{
+    int width = buf->plane[0].width;
+    int count = 0;
+
+#if ARCH_X86_64 || defined(__aarch64__)
+    while ( count < max && count + 16 <= width )
+    {
+        int col  = from_right ? width - count - 16 : count;
+        int mask = columns_all_dark_16( buf, top, bottom, col );
+        int n    = 0;
+
+        // count the dark columns starting from the border side
+        while ( n < 16 && ( mask >> ( from_right ? 15 - n : n ) ) & 1 )
+            n++;
+        count += n;
+        if ( n < 16 )
+            return MIN( count, max );
+    }
+#endif
+    for ( ; count < max; ++count )
+    {
+        if ( ! column_all_dark( buf, top, bottom,
+                                from_right ? width - 1 - count : count ) )
+            break;
+    }
+    return MIN( count, max );
+}
 #undef DARK
 
 typedef struct {
@@ -648,7 +920,8 @@ static hb_buffer_t * read_buf(hb_scan_t * data, hb_stream_t * stream)
  * It assumes that data->reader and data->vts have successfully been
  * DVDOpen()ed and ifoOpen()ed.
  **********************************************************************/
-static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
+static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush,
+                           int hw_decode )
 {
     int                i, npreviews = 0, abort = 0;
     hb_buffer_t      * buf, * buf_es;
@@ -660,6 +933,9 @@ static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
     int                vid_samples = 0;
     int                frame_wait = 0;
     int                cc_wait = 10;
+    // The fast mode is not used when trying harder, streams that
+    // need it may not flag their keyframes
+    int                fast = data->fast && flush;
     int                frames;
     hb_stream_t      * stream = NULL;
     info_list_t      * info_list;
@@ -714,7 +990,7 @@ static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
     }
 
     void *hw_device_ctx = NULL;
-    hb_hwaccel_t *hwaccel = hb_get_hwaccel(data->hw_decode);
+    hb_hwaccel_t *hwaccel = hb_get_hwaccel(hw_decode);
 
     if (hwaccel &&
         hwaccel->caps & HB_HWACCEL_CAP_SCAN &&
@@ -728,6 +1004,13 @@ static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
     vid_decoder->hw_device_ctx = hw_device_ctx;
     vid_decoder->hw_accel = hwaccel;
     vid_decoder->title = title;
+    vid_decoder->fast_scan = fast;
+    if (fast)
+    {
+        // Only keyframes are decoded, waiting for closed captions
+        // would mean reading several GOPs per preview
+        cc_wait = 0;
+    }
 
     if (vid_decoder->init(vid_decoder, NULL))
     {
@@ -1032,16 +1315,8 @@ static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
                 bottom = 0;
             }
         }
-        for ( left = 0; left < w4; ++left )
-        {
-            if ( ! column_all_dark( vid_buf, top, bottom, left ) )
-                break;
-        }
-        for ( right = 0; right < w4; ++right )
-        {
-            if ( ! column_all_dark( vid_buf, top, bottom, vid_info.geometry.width - 1 - right ) )
-                break;
-        }
+        left  = count_dark_columns( vid_buf, top, bottom, w4, 0 );
+        right = count_dark_columns( vid_buf, top, bottom, w4, 1 );
 
         // only record the result if all the crops are less than a quarter of
         // the frame otherwise we can get fooled by frames with a lot of black
@@ -1914,6 +2189,12 @@ static void UpdateState3(hb_scan_t *scan, int preview)
 {
     hb_state_t state;
 
+    if (scan->parallel)
+    {
+        // Progress is reported per file by UpdateStatePool
+        return;
+    }
+
     hb_get_state2(scan->h, &state);
 #define p state.param.scanning
     p.preview_cur = preview;
@@ -1926,3 +2207,21 @@ static void UpdateState3(hb_scan_t *scan, int preview)
 
     hb_set_state(scan->h, &state);
 }
+
+static void UpdateStatePool(hb_scan_t *scan, int done, int count)
+{
+    hb_state_t state;
+
+    hb_get_state2(scan->h, &state);
+#define p state.param.scanning
+    /* Update the UI */
+    state.state   = HB_STATE_SCANNING;
+    p.title_cur   = done;
+    p.title_count = count;
+    p.preview_cur = 0;
+    p.preview_count = 1;
+    p.progress = (float)done / count;
+#undef p
+
+    hb_set_state(scan->h, &state);
+}
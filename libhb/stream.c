@@ -132,8 +132,8 @@ typedef struct {
     hb_buffer_t     * buf;
     hb_pes_info_t     pes_info;
     int8_t            pes_info_valid;
+    int8_t            pes_start;    // buf starts a PES, timestamps pending
     int               packet_len;
-    int               packet_offset;
     int8_t            skipbad;
     int8_t            continuity;
     uint8_t           pkt_summary[8];
@@ -4710,6 +4710,33 @@ static int stream_kind_to_buf_type(int kind)
     }
 }
 
+// Parses the PES header at the start of the stream buffer and drops it,
+// so that the buffer holds only elementary stream data and can be
+// output as is. The header nearly always sits in the first TS packet,
+// so at most a packet worth of data is moved.
+static int ts_stream_parse_pes_header(hb_stream_t *stream,
+                                      hb_ts_stream_t *ts_stream)
+{
+    hb_buffer_t * b = ts_stream->buf;
+
+    if (!hb_parse_ps(stream, b->data, b->size, &ts_stream->pes_info) ||
+        ts_stream->pes_info.header_len > b->size)
+    {
+        return 0;
+    }
+    b->size -= ts_stream->pes_info.header_len;
+    memmove(b->data, b->data + ts_stream->pes_info.header_len, b->size);
+    if (ts_stream->pes_info.packet_len > 0 &&
+        ts_stream->pes_info.packet_len > b->alloc)
+    {
+        // Size is known up front, avoid growing the buffer piecewise
+        hb_buffer_realloc(b, ts_stream->pes_info.packet_len);
+    }
+    ts_stream->pes_info_valid = 1;
+    ts_stream->pes_start = 1;
+    return 1;
+}
+
 static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
 {
     hb_buffer_list_t list;
@@ -4718,21 +4745,16 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
     hb_buffer_list_clear(&list);
     hb_ts_stream_t * ts_stream = &stream->ts.list[curstream];
     hb_buffer_t * b = ts_stream->buf;
-    if (!ts_stream->pes_info_valid)
+    if (!ts_stream->pes_info_valid && !ts_stream_parse_pes_header(stream, ts_stream))
     {
-        if (!hb_parse_ps(stream, b->data, b->size, &ts_stream->pes_info))
-        {
-            b->size = 0;
-            ts_stream->packet_len = 0;
-            ts_stream->packet_offset = 0;
-            return NULL;
-        }
-        ts_stream->pes_info_valid = 1;
-        ts_stream->packet_offset = ts_stream->pes_info.header_len;
+        b->size = 0;
+        ts_stream->packet_len = 0;
+        ts_stream->pes_start = 0;
+        return NULL;
     }
 
-    uint8_t *tdat = b->data + ts_stream->packet_offset;
-    int es_size = b->size - ts_stream->packet_offset;
+    uint8_t *tdat = b->data;
+    int es_size = b->size;
 
     if (ts_stream->packet_len >= ts_stream->pes_info.packet_len + 6)
     {
@@ -4748,7 +4770,7 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
             ts_stream->packet_len = 0;
         }
         b->size = 0;
-        ts_stream->packet_offset = 0;
+        ts_stream->pes_start = 0;
         return NULL;
     }
 
@@ -4769,13 +4791,18 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
                 b->size = 0;
                 ts_stream->pes_info_valid = 0;
                 ts_stream->packet_len = 0;
-                ts_stream->packet_offset = 0;
+                ts_stream->pes_start = 0;
                 return NULL;
             }
         }
         stream->need_keyframe = 0;
     }
 
+    // The first matching substream takes over the reassembled buffer,
+    // any other gets a copy of it.
+    hb_buffer_t * es = NULL;
+    int new_chap = b->s.new_chap;
+
     // Some TS streams carry multiple substreams.  E.g. DTS-HD contains
     // a core DTS substream.  We demux these as separate streams here.
     // Check all substreams to see if this packet matches
@@ -4793,7 +4820,19 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
         // we want the whole TS stream including all substreams.
         // DTS-HD is an example of this.
 
-        buf = hb_buffer_init(es_size);
+        if (es == NULL)
+        {
+            // Start the next PES with room for one like this one
+            buf = es = b;
+            b = ts_stream->buf = hb_buffer_init(es_size);
+            b->size = 0;
+            buf->size = es_size;
+        }
+        else
+        {
+            buf = hb_buffer_init(es_size);
+            memcpy(buf->data, es->data, es_size);
+        }
         if (ts_stream->packet_len < ts_stream->pes_info.packet_len + 6)
         {
             buf->s.split = 1;
@@ -4802,12 +4841,12 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
 
         buf->s.id = get_id(pes_stream);
         buf->s.type = stream_kind_to_buf_type(pes_stream->stream_kind);
-        buf->s.new_chap = b->s.new_chap;
-        b->s.new_chap = 0;
+        buf->s.new_chap = new_chap;
+        new_chap = 0;
 
         // put the PTS & possible DTS into 'start' & 'renderOffset'
         // only put timestamps on the first output buffer for this PES packet.
-        if (ts_stream->packet_offset > 0)
+        if (ts_stream->pes_start)
         {
             buf->s.discontinuity = stream->ts.discontinuity;
             stream->ts.discontinuity = 0;
@@ -4823,9 +4862,8 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
             buf->s.start = AV_NOPTS_VALUE;
             buf->s.renderOffset = AV_NOPTS_VALUE;
         }
-        // copy the elementary stream data into the buffer
-        memcpy(buf->data, tdat, es_size);
     }
+    b->s.new_chap = new_chap;
 
     if (ts_stream->pes_info.packet_len > 0 &&
         ts_stream->packet_len >= ts_stream->pes_info.packet_len + 6)
@@ -4834,7 +4872,7 @@ static hb_buffer_t * generate_output_data(hb_stream_t *stream, int curstream)
         ts_stream->packet_len = 0;
     }
     b->size = 0;
-    ts_stream->packet_offset = 0;
+    ts_stream->pes_start = 0;
     return hb_buffer_list_clear(&list);
 }
 
@@ -5152,12 +5190,7 @@ hb_buffer_t * hb_ts_decode_pkt( hb_stream_t *stream, const uint8_t * pkt,
 
     if (!ts_stream->pes_info_valid && ts_stream->buf->size >= 19)
     {
-        if (hb_parse_ps(stream, ts_stream->buf->data, ts_stream->buf->size,
-                        &ts_stream->pes_info))
-        {
-            ts_stream->pes_info_valid = 1;
-            ts_stream->packet_offset = ts_stream->pes_info.header_len;
-        }
+        ts_stream_parse_pes_header(stream, ts_stream);
     }
 
     // see if we've hit the end of this PES packet
@@ -5222,6 +5255,7 @@ void hb_ts_stream_reset(hb_stream_t *stream)
         stream->ts.list[i].skipbad = 1;
         stream->ts.list[i].continuity = -1;
         stream->ts.list[i].pes_info_valid = 0;
+        stream->ts.list[i].pes_start = 0;
     }
 
     stream->need_keyframe = 1;
@@ -6476,9 +6510,9 @@ hb_buffer_t * hb_ffmpeg_read( hb_stream_t *stream )
                 buf->size = stream->ffmpeg_pkt->size;
                 break;
             default:
-                buf = hb_buffer_init(stream->ffmpeg_pkt->size);
-                memcpy(buf->data, stream->ffmpeg_pkt->data,
-                                  stream->ffmpeg_pkt->size);
+                // Share the refcounted packet data instead of copying it,
+                // the reference travels down to the decoder or the muxer.
+                buf = hb_avpacket_to_buffer(stream->ffmpeg_pkt);
                 break;
         }
 
@@ -6530,6 +6564,15 @@ hb_buffer_t * hb_ffmpeg_read( hb_stream_t *stream )
             break;
 
         case AVMEDIA_TYPE_AUDIO:
+            // Not rounded, so that decavcodec can tell whether it is
+            // an exact number of samples (see passthruAudio()).
+            // Corrupt packets get no duration, so that passthru
+            // decodes them and drops them if they fail to decode.
+            if (stream->ffmpeg_pkt->duration > 0 &&
+                !(stream->ffmpeg_pkt->flags & AV_PKT_FLAG_CORRUPT))
+            {
+                buf->s.duration = stream->ffmpeg_pkt->duration * tsconv;
+            }
             buf->s.type = AUDIO_BUF;
             break;
 
@@ -121,6 +121,12 @@ typedef struct
             int     id;
             int     cadence[12];
             int     new_chap;
+
+            // Frame rate decimation for lower CFR output
+            int           decimate;
+            int           decimate_drops;
+            double        frame_duration;
+            hb_buffer_t * decimate_buf;
         } video;
 
         // Audio stream context
@@ -1223,6 +1229,11 @@ static void fifo_push( hb_fifo_t * fifo, hb_buffer_t * buf )
 
 static void streamFlush( sync_stream_t * stream )
 {
+    if (stream->type == SYNC_TYPE_VIDEO)
+    {
+        fifo_push(stream->fifo_out, stream->video.decimate_buf);
+        stream->video.decimate_buf = NULL;
+    }
     while (hb_list_count(stream->in_queue) > 0)
     {
         hb_buffer_t * buf;
@@ -1381,6 +1392,35 @@ static void checkCadence( int * cadence, hb_buffer_t * buf )
     }
 }
 
+// Keep 1 of every 'decimate' frames for the vfr filter, and drop the
+// rest before they reach the filter chain.  The kept frame is held
+// until the next one is kept so that it can be extended to cover the
+// duration of the frames dropped after it.  Frames are kept based on
+// their timestamps, so sections of the source that are already at a
+// lower rate lose fewer frames.
+static hb_buffer_t * decimateVideo( sync_stream_t * stream, hb_buffer_t * buf )
+{
+    hb_buffer_t * held = stream->video.decimate_buf;
+
+    if (buf == NULL || stream->video.decimate <= 1)
+    {
+        return buf;
+    }
+    if (held != NULL && buf->s.start - held->s.start <
+        (stream->video.decimate - 0.5) * stream->video.frame_duration)
+    {
+        held->s.stop      = buf->s.stop;
+        held->s.duration  = held->s.stop - held->s.start;
+        stream->video.decimate_drops++;
+        saveChap(stream, buf);
+        hb_buffer_close(&buf);
+        return NULL;
+    }
+    stream->video.decimate_buf = buf;
+
+    return held;
+}
+
 // When doing point-to-point encoding, subtitles can cause a long
 // delay in finishing the job when the stop point is reached.  This
 // is due to the sparse nature of subtitles.  We may not even see
@@ -1743,6 +1783,10 @@ static int OutputBuffer( sync_common_t * common )
             hb_buffer_close(&buf);
         }
         restoreChap(out_stream, buf);
+        if (out_stream->type == SYNC_TYPE_VIDEO)
+        {
+            buf = decimateVideo(out_stream, buf);
+        }
         fifo_push(out_stream->fifo_out, buf);
         out_count++;
     } while (more);
@@ -1884,6 +1928,31 @@ static int getStreamId( sync_stream_t * stream )
     }
 }
 
+// Frames before the start point of a point-to-point encode are
+// decoded only to be dropped here.  Tell the video decoder where the
+// start point is in its input timestamps so it can skip frames that
+// later frames do not depend on.
+static void publishStartPts( sync_stream_t * stream, int scr_sequence,
+                             int64_t scr_offset )
+{
+    sync_common_t * common = stream->common;
+    hb_job_t      * job    = common->job;
+
+    if (stream->type != SYNC_TYPE_VIDEO || common->start_found ||
+        !common->wait_for_pts ||
+        common->pts_to_start == AV_NOPTS_VALUE ||
+        job->pts_to_start_lock == NULL ||
+        job->pts_to_start_input != AV_NOPTS_VALUE)
+    {
+        return;
+    }
+    hb_lock(job->pts_to_start_lock);
+    job->pts_to_start_scr   = scr_sequence;
+    job->pts_to_start_input = common->pts_to_start + scr_offset +
+                              stream->pts_slip;
+    hb_unlock(job->pts_to_start_lock);
+}
+
 static int UpdateSCR( sync_stream_t * stream, hb_buffer_t * buf )
 {
     int             hash = buf->s.scr_sequence & SCR_HASH_MASK;
@@ -1940,6 +2009,7 @@ static int UpdateSCR( sync_stream_t * stream, hb_buffer_t * buf )
             }
         }
         scr_offset = common->scr[hash].scr_offset;
+        publishStartPts(stream, buf->s.scr_sequence, scr_offset);
     }
 
     // Adjust buffer timestamps for SCR offset
@@ -2354,6 +2424,14 @@ static int syncVideoInit( hb_work_object_t * w, hb_job_t * job)
     pv->stream->last_duration   = (int64_t)AV_NOPTS_VALUE;
     pv->stream->fifo_out        = job->fifo_sync;
     pv->stream->video.id        = job->title->video_id;
+    pv->stream->video.decimate  = job->decimate;
+    pv->stream->video.frame_duration = 90000. * job->title->vrate.den /
+                                                job->title->vrate.num;
+    if (pv->stream->video.decimate > 1)
+    {
+        hb_log("sync: keeping 1 of every %d video frames for CFR output",
+               pv->stream->video.decimate);
+    }
 
     w->fifo_in                  = job->fifo_raw;
     w->fifo_out                 = job->fifo_sync;
@@ -2439,6 +2517,7 @@ static int syncVideoInit( hb_work_object_t * w, hb_job_t * job)
                                       work, HB_LOW_PRIORITY);
     }
 
+    job->pts_to_start_input = AV_NOPTS_VALUE;
     if (job->frame_to_start || job->pts_to_start)
     {
         pv->common->start_found    = 0;
@@ -2448,6 +2527,7 @@ static int syncVideoInit( hb_work_object_t * w, hb_job_t * job)
         if (job->pts_to_start)
         {
             pv->common->pts_to_start = AV_NOPTS_VALUE;
+            job->pts_to_start_lock   = hb_lock_init();
         }
     }
     else
@@ -2517,6 +2597,13 @@ static void syncVideoClose( hb_work_object_t * w )
                (pv->stream->frame_count * 90000.) /
                 pv->stream->current_duration);
     }
+    if (pv->stream->video.decimate > 1)
+    {
+        hb_log("sync: dropped %d video frames for CFR output",
+               pv->stream->video.decimate_drops);
+    }
+    hb_buffer_close(&pv->stream->video.decimate_buf);
+    hb_lock_close(&job->pts_to_start_lock);
 
     /* save data for second pass */
     if( job->pass_id == HB_PASS_ENCODE_ANALYSIS )
@@ -0,0 +1,100 @@
+/* colorspace_template.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#if BIT_DEPTH > 8
+#   define pixel  uint16_t
+#   define FUNC(name) name##_##16
+#else
+#   define pixel  uint8_t
+#   define FUNC(name) name##_##8
+#endif
+
+// Each luma sample is looked up with the chroma sample that covers it
+static void FUNC(colorspace_lut_luma)(const hb_colorspace_lut_t *lut,
+                                      const hb_buffer_t *in, hb_buffer_t *out,
+                                      int y0, int y1)
+{
+    const int width = in->plane[0].width;
+
+    for (int y = y0; y < y1; y++)
+    {
+        const pixel *src_y  = (const pixel *)(in->plane[0].data +
+                                              y * in->plane[0].stride);
+        const pixel *src_cb = (const pixel *)(in->plane[1].data +
+                                              (y >> lut->y_shift) * in->plane[1].stride);
+        const pixel *src_cr = (const pixel *)(in->plane[2].data +
+                                              (y >> lut->y_shift) * in->plane[2].stride);
+        pixel *dst = (pixel *)(out->plane[0].data + y * out->plane[0].stride);
+
+        for (int x = 0; x < width; x++)
+        {
+            lut_pos_t py, pb, pr;
+
+            lut_index(lut, src_y[x], LUT_SIZE_Y, &py);
+            lut_index(lut, src_cb[x >> lut->x_shift], LUT_SIZE_C, &pb);
+            lut_index(lut, src_cr[x >> lut->x_shift], LUT_SIZE_C, &pr);
+            dst[x] = lut_interp(lut->table, &py, &pb, &pr, 0);
+        }
+    }
+}
+
+// Each chroma sample is looked up with the average of the luma samples
+// it covers
+static void FUNC(colorspace_lut_chroma)(const hb_colorspace_lut_t *lut,
+                                        const hb_buffer_t *in, hb_buffer_t *out,
+                                        int y0, int y1)
+{
+    const int width        = in->plane[1].width;
+    const int luma_width   = in->plane[0].width;
+    const int luma_height  = in->plane[0].height;
+    const int block_width  = 1 << lut->x_shift;
+    const int block_height = 1 << lut->y_shift;
+
+    for (int y = y0; y < y1; y++)
+    {
+        const pixel *src_cb = (const pixel *)(in->plane[1].data +
+                                              y * in->plane[1].stride);
+        const pixel *src_cr = (const pixel *)(in->plane[2].data +
+                                              y * in->plane[2].stride);
+        pixel *dst_cb = (pixel *)(out->plane[1].data + y * out->plane[1].stride);
+        pixel *dst_cr = (pixel *)(out->plane[2].data + y * out->plane[2].stride);
+
+        const int ly0 = y << lut->y_shift;
+        const int ly1 = MIN(ly0 + block_height, luma_height);
+
+        for (int x = 0; x < width; x++)
+        {
+            const int lx0 = x << lut->x_shift;
+            const int lx1 = MIN(lx0 + block_width, luma_width);
+            int sum = 0, count = 0;
+
+            for (int ly = ly0; ly < ly1; ly++)
+            {
+                const pixel *src_y = (const pixel *)(in->plane[0].data +
+                                                     ly * in->plane[0].stride);
+                for (int lx = lx0; lx < lx1; lx++)
+                {
+                    sum += src_y[lx];
+                    count++;
+                }
+            }
+
+            lut_pos_t py, pb, pr;
+
+            lut_index(lut, (sum + count / 2) / count, LUT_SIZE_Y, &py);
+            lut_index(lut, src_cb[x], LUT_SIZE_C, &pb);
+            lut_index(lut, src_cr[x], LUT_SIZE_C, &pr);
+            dst_cb[x] = lut_interp(lut->table, &py, &pb, &pr, 1);
+            dst_cr[x] = lut_interp(lut->table, &py, &pb, &pr, 2);
+        }
+    }
+}
+
+#undef pixel
+#undef FUNC
@@ -13,6 +13,20 @@
 //#define HB_DEBUG_CFR_DROPS 1
 #define MAX_FRAME_ANALYSIS_DEPTH 10
 
+// Duplicate frame merging (VFR). The motion metric is a whole frame
+// average, which hides small moving areas such as a mouth in an
+// otherwise still animation frame. So it only rejects candidates
+// quickly, and frames that pass are compared 8x8 luma block by block.
+// A frame is a duplicate when no block's sum of absolute differences
+// (8 bit scale) is over DEDUP_BLOCK_HI and at most 1/DEDUP_BLOCK_FRAC
+// of the blocks are over DEDUP_BLOCK_LO.
+#define DEDUP_MOTION_MAX    4096
+#define DEDUP_BLOCK_HI      (64 * 8)
+#define DEDUP_BLOCK_LO      (64 * 3)
+#define DEDUP_BLOCK_FRAC    3
+// Longest run of frames merged into one, 90KHz ticks
+#define DEDUP_MAX_DURATION  90000
+
 struct hb_filter_private_s
 {
     hb_job_t      * job;
@@ -31,8 +45,15 @@ struct hb_filter_private_s
     double          frame_duration;     // 90KHz ticks per frame (for CFR/PFR)
     double          out_last_stop;      // where last frame ended (for CFR/PFR)
     int             drops;              // frames dropped (for CFR/PFR)
+    int             decimate;           // sync keeps 1 of this many frames
     int             dups;               // frames duped (for CFR/PFR)
 
+    // Duplicate frame merging members (for VFR)
+    int             dedup;
+    int             dedup_depth;
+    int             dedups;             // frames merged
+    hb_buffer_t   * dedup_buf;          // first frame of the current run
+
     // Duplicate frame detection members
     int             frame_analysis_depth;
     int64_t         frame_analysis_duration;
@@ -57,7 +78,7 @@ static void hb_vfr_close( hb_filter_object_t * filter );
 static hb_filter_info_t * hb_vfr_info( hb_filter_object_t * filter );
 
 static const char hb_vfr_template[] =
-    "mode=^([012])$:rate=^"HB_RATIONAL_REG"$";
+    "mode=^([012])$:rate=^"HB_RATIONAL_REG"$:dedup=^"HB_BOOL_REG"$";
 
 hb_filter_object_t hb_filter_vfr =
 {
@@ -122,6 +143,106 @@ void hb_motion_metric_close(hb_motion_metric_object_t **_m)
     *_m = NULL;
 }
 
+#define DEF_BLOCK_SAD(nbits)                                                    \
+static unsigned block_sad##_##nbits(const uint8_t *a, const uint8_t *b,         \
+                                    int stride_a, int stride_b)                 \
+{                                                                               \
+    unsigned sum = 0;                                                           \
+    for (int y = 0; y < 8; y++)                                                 \
+    {                                                                           \
+        const uint##nbits##_t *ra = (const uint##nbits##_t *)a;                 \
+        const uint##nbits##_t *rb = (const uint##nbits##_t *)b;                 \
+        for (int x = 0; x < 8; x++)                                             \
+        {                                                                       \
+            sum += abs(ra[x] - rb[x]);                                          \
+        }                                                                       \
+        a += stride_a;                                                          \
+        b += stride_b;                                                          \
+    }                                                                           \
+    return sum;                                                                 \
+}                                                                               \
+
+DEF_BLOCK_SAD(8)
+DEF_BLOCK_SAD(16)
+
+static int is_duplicate_frame(hb_filter_private_t *pv,
+                              hb_buffer_t *a, hb_buffer_t *b)
+{
+    if (a->f.width != b->f.width || a->f.height != b->f.height)
+    {
+        return 0;
+    }
+    if (pv->metric->work(pv->metric, a, b) > DEDUP_MOTION_MAX)
+    {
+        return 0;
+    }
+
+    int      bps      = pv->dedup_depth > 8 ? 2 : 1;
+    int      shift    = pv->dedup_depth - 8;
+    int      bw       = a->f.width  / 8;
+    int      bh       = a->f.height / 8;
+    int      stride_a = a->plane[0].stride;
+    int      stride_b = b->plane[0].stride;
+    int      over_lo  = 0;
+    int      max_lo   = bw * bh / DEDUP_BLOCK_FRAC;
+
+    for (int y = 0; y < bh; y++)
+    {
+        const uint8_t *ra = a->plane[0].data + y * 8 * stride_a;
+        const uint8_t *rb = b->plane[0].data + y * 8 * stride_b;
+        for (int x = 0; x < bw; x++)
+        {
+            unsigned sad;
+            if (bps == 1)
+            {
+                sad = block_sad_8(ra + x * 8, rb + x * 8, stride_a, stride_b);
+            }
+            else
+            {
+                sad = block_sad_16(ra + x * 16, rb + x * 16,
+                                   stride_a, stride_b) >> shift;
+            }
+            if (sad > DEDUP_BLOCK_HI)
+            {
+                return 0;
+            }
+            if (sad > DEDUP_BLOCK_LO && ++over_lo > max_lo)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Merge runs of duplicate frames into the first frame of the run.
+// in == NULL flushes the frame being held.
+static hb_buffer_t * merge_duplicate_frames(hb_filter_private_t *pv,
+                                            hb_buffer_t *in)
+{
+    hb_buffer_t *out = pv->dedup_buf;
+
+    if (in == NULL)
+    {
+        pv->dedup_buf = NULL;
+        return out;
+    }
+    // Chapter marks must stay on their own frame
+    if (out != NULL && in->s.new_chap <= 0 &&
+        in->s.stop - out->s.start <= DEDUP_MAX_DURATION &&
+        is_duplicate_frame(pv, out, in))
+    {
+        out->s.stop     = in->s.stop;
+        out->s.duration = out->s.stop - out->s.start;
+        hb_buffer_close(&in);
+        ++pv->dedups;
+        return NULL;
+    }
+    pv->dedup_buf = in;
+
+    return out;
+}
+
 static void delete_metric(double * metrics, int pos, int size)
 {
     double * dst   = &metrics[pos];
@@ -205,6 +326,10 @@ static hb_buffer_t * adjust_frame_rate( hb_filter_private_t * pv,
 
     if (pv->cfr == 0)
     {
+        if (pv->dedup)
+        {
+            in = merge_duplicate_frames(pv, in);
+        }
         if (in)
         {
             ++pv->count_frames;
@@ -357,6 +482,10 @@ static hb_buffer_t * flush_frames(hb_filter_private_t * pv)
     hb_buffer_list_t list;
 
     hb_buffer_list_clear(&list);
+    if (pv->cfr == 0)
+    {
+        return adjust_frame_rate(pv, NULL);
+    }
     while (hb_list_count(pv->frame_rate_list) > 0)
     {
         hb_buffer_list_append(&list, adjust_frame_rate(pv, NULL));
@@ -365,6 +494,46 @@ static hb_buffer_t * flush_frames(hb_filter_private_t * pv)
     return hb_buffer_list_clear(&list);
 }
 
+// When the output rate is a fraction of the input rate, sync drops
+// frames before the filter chain so that frames which can never be
+// output do not go through the filters ahead of this one. Keeping one
+// of every floor(in / out) frames still keeps a frame of every picture
+// that a regular pulldown pattern repeats, and this filter makes the
+// final choice of which to drop among the rest.
+//
+// Detelecine needs to see every frame, and filters that change the
+// frame rate make sync's timestamps a poor predictor, so leave those
+// alone.
+static int get_decimation(hb_filter_private_t *pv, hb_filter_init_t *init)
+{
+    hb_job_t *job = init->job;
+    int       ii, decimate;
+
+    if (pv->cfr != 1 || job == NULL || job->title == NULL)
+    {
+        return 1;
+    }
+    if ((int64_t)init->vrate.num * job->title->vrate.den !=
+        (int64_t)job->title->vrate.num * init->vrate.den)
+    {
+        return 1;
+    }
+    for (ii = 0; ii < hb_list_count(job->list_filter); ii++)
+    {
+        hb_filter_object_t *filter = hb_list_item(job->list_filter, ii);
+        if (filter->id == HB_FILTER_DETELECINE)
+        {
+            return 1;
+        }
+    }
+
+    double in_vrate  = (double)pv->input_vrate.num / pv->input_vrate.den;
+    double out_vrate = (double)pv->vrate.num / pv->vrate.den;
+    decimate = (int)(in_vrate / out_vrate + 0.001);
+
+    return decimate > 1 ? decimate : 1;
+}
+
 static int hb_vfr_init(hb_filter_object_t *filter, hb_filter_init_t *init)
 {
     filter->private_data    = calloc(1, sizeof(struct hb_filter_private_s));
@@ -374,8 +543,39 @@ static int hb_vfr_init(hb_filter_object_t *filter, hb_filter_init_t *init)
     pv->input_vrate = pv->vrate = init->vrate;
     hb_dict_extract_int(&pv->cfr, filter->settings, "mode");
     hb_dict_extract_rational(&pv->vrate, filter->settings, "rate");
+    hb_dict_extract_bool(&pv->dedup, filter->settings, "dedup");
 
-    if (pv->cfr)
+    if (pv->dedup && pv->cfr != 0)
+    {
+        pv->dedup = 0;
+    }
+    if (pv->dedup && init->hw_pix_fmt != AV_PIX_FMT_NONE)
+    {
+        hb_log("vfr: duplicate frame merging is not supported with hardware frames");
+        pv->dedup = 0;
+    }
+    if (pv->dedup && init->job != NULL)
+    {
+        // Burned in subtitles are rendered after this filter, a merged
+        // frame would show a subtitle that starts during it too late
+        for (int ii = 0; ii < hb_list_count(init->job->list_subtitle); ii++)
+        {
+            hb_subtitle_t *subtitle = hb_list_item(init->job->list_subtitle, ii);
+            if (subtitle->config.dest == RENDERSUB)
+            {
+                hb_log("vfr: duplicate frame merging disabled, subtitles are burned in");
+                pv->dedup = 0;
+                break;
+            }
+        }
+    }
+    if (pv->dedup)
+    {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(init->pix_fmt);
+        pv->dedup_depth = desc != NULL ? desc->comp[0].depth : 8;
+    }
+
+    if (pv->cfr || pv->dedup)
     {
         pv->metric = hb_motion_metric_init(init);
         if (pv->metric == NULL)
@@ -384,12 +584,19 @@ static int hb_vfr_init(hb_filter_object_t *filter, hb_filter_init_t *init)
         }
     }
 
+    pv->decimate = get_decimation(pv, init);
+    if (init->job != NULL)
+    {
+        init->job->decimate = pv->decimate;
+    }
+
     // frame-drop analysis always looks at least 2 buffers
     pv->frame_analysis_depth = 2;
 
     // Calculate the number of frames we need to keep in order to
     // detect "best" candidate frames to drop.
-    double in_vrate  = (double)pv->input_vrate.num / pv->input_vrate.den;
+    double in_vrate  = (double)pv->input_vrate.num / pv->input_vrate.den /
+                       pv->decimate;
     double out_vrate = (double)pv->vrate.num / pv->vrate.den;
     if (in_vrate > out_vrate)
     {
@@ -497,8 +704,9 @@ static hb_filter_info_t * hb_vfr_info( hb_filter_object_t * filter )
     {
         /* Ensure we're using "Same as source" FPS */
         snprintf( info->human_readable_desc, 128,
-                  "frame rate: same as source (around %.3f fps)",
-                  (float)pv->vrate.num / pv->vrate.den );
+                  "frame rate: same as source (around %.3f fps)%s",
+                  (float)pv->vrate.num / pv->vrate.den,
+                  pv->dedup ? ", merge duplicate frames" : "" );
     }
     else if ( pv->cfr == 2 )
     {
@@ -540,6 +748,11 @@ static void hb_vfr_close( hb_filter_object_t * filter )
         hb_log("vfr: %d frames output, %d dropped",
                pv->count_frames, pv->drops);
     }
+    if (pv->dedup)
+    {
+        hb_log("vfr: %d duplicate frames merged", pv->dedups);
+    }
+    hb_buffer_close(&pv->dedup_buf);
 
     if( pv->job )
     {
@@ -33,9 +33,27 @@ typedef struct
 
 } hb_work_t;
 
+typedef struct
+{
+    hb_work_object_t   * work;    // Audio decoder or encoder
+    hb_filter_object_t * filter;  // Audio filter
+    hb_buffer_t        * pending; // Output waiting for room in fifo_out
+    int                  finished;
+} hb_audio_task_t;
+
+typedef struct
+{
+    hb_job_t        * job;
+    hb_list_t       * list_task;
+    hb_thread_t     * thread;
+    hb_fifo_alert_t * alert;   // Input pushed or output drained
+} hb_audio_worker_t;
+
 static void work_func(void * _work);
 static void do_job( hb_job_t *);
 static void filter_loop( void * );
+static hb_list_t * audio_pool_init( hb_job_t * job );
+static void audio_pool_close( hb_list_t ** _pool );
 
 #define FIFO_UNBOUNDED 65536
 #define FIFO_UNBOUNDED_WAKE 65535
@@ -46,6 +64,10 @@ static void filter_loop( void * );
 #define FIFO_MINI 4
 #define FIFO_MINI_WAKE 3
 
+// Number of buffers an audio pool worker processes for one task
+// before moving on to the next task
+#define AUDIO_POOL_BATCH 8
+
 /**
  * Allocates work object and launches work thread with work_func.
  * @param jobs Handle to hb_list_t.
@@ -218,6 +240,41 @@ hb_work_object_t* hb_audio_decoder(hb_handle_t *h, int codec)
     return w;
 }
 
+/*
+ * Returns the decoder work object already set up for another output of
+ * the same source audio track, if the decoded audio it produces can be
+ * shared with 'audio'. Only libavcodec decoders support sharing.
+ */
+static hb_work_object_t * find_shared_audio_decoder(hb_job_t *job,
+                                                    hb_audio_t *audio)
+{
+    int ii;
+
+    if ((audio->config.out.codec & HB_ACODEC_PASS_FLAG) ||
+        !(audio->config.in.codec & HB_ACODEC_FF_MASK))
+    {
+        return NULL;
+    }
+    for (ii = 0; ii < hb_list_count(job->list_work); ii++)
+    {
+        hb_work_object_t *w = hb_list_item(job->list_work, ii);
+        hb_audio_t       *a = w->audio;
+
+        if (a == NULL || w->fifo_in == NULL || w->fifo_in != a->priv.fifo_in)
+        {
+            continue;
+        }
+        if (a->id == audio->id &&
+            !(a->config.out.codec & HB_ACODEC_PASS_FLAG) &&
+            a->config.out.dynamic_range_compression ==
+            audio->config.out.dynamic_range_compression)
+        {
+            return w;
+        }
+    }
+    return NULL;
+}
+
 hb_work_object_t* hb_video_decoder(hb_handle_t *h, int vcodec, int param,
                                    void *hw_device_ctx, hb_hwaccel_t *hw_accel)
 {
@@ -659,6 +716,16 @@ void hb_display_job_info(hb_job_t *job)
                     hb_log( "                subq=2 (if originally greater than 2, else subq unchanged)" );
                 }
             }
+            if (job->multipass && job->multipass_cache > 0)
+            {
+                hb_log( "     + multi-pass cache: %d MiB", job->multipass_cache );
+            }
+            if (!job->multipass && job->complexity_analysis && job->cfr == 1 &&
+                ((job->vcodec & HB_VCODEC_X264_MASK) ||
+                 (job->vcodec & HB_VCODEC_X265_MASK)))
+            {
+                hb_log( "     + complexity analysis" );
+            }
         }
 
         hb_log("     + color profile: %d-%d-%d",
@@ -723,12 +790,13 @@ void hb_display_job_info(hb_job_t *job)
         }
     }
 
-    if (job->indepth_scan)
+    if (job->indepth_scan || job->select_subtitle_single_pass)
     {
-        hb_log( " * Foreign Audio Search: %s%s%s",
+        hb_log( " * Foreign Audio Search: %s%s%s%s",
                 job->select_subtitle_config.dest == RENDERSUB ? "Render/Burn-in" : "Passthru",
                 job->select_subtitle_config.force ? ", Forced Only" : "",
-                job->select_subtitle_config.default_track ? ", Default" : "" );
+                job->select_subtitle_config.default_track ? ", Default" : "",
+                job->select_subtitle_single_pass ? ", Single Pass" : "" );
     }
 
     for( i = 0; i < hb_list_count( job->list_subtitle ); i++ )
@@ -737,7 +805,7 @@ void hb_display_job_info(hb_job_t *job)
 
         if( subtitle )
         {
-            if( job->indepth_scan )
+            if( job->indepth_scan || subtitle->search_candidate )
             {
                 hb_log( "   + subtitle, %s (track %d, id 0x%x, %s)",
                         subtitle->lang, subtitle->track, subtitle->id,
@@ -903,7 +971,13 @@ void correct_framerate( hb_interjob_t * interjob, hb_job_t * job )
     }
 }
 
-static void analyze_subtitle_scan( hb_job_t * job )
+/*
+ * Foreign audio search: select the subtitle track of list_subtitle
+ * that most likely contains the foreign audio subtitles, using the hit
+ * statistics collected by the subtitle decoders. Returns NULL if there
+ * is no candidate.
+ */
+hb_subtitle_t * hb_subtitle_search_select( hb_list_t * list_subtitle, int force )
 {
     hb_subtitle_t *subtitle;
     int subtitle_highest     = 0;
@@ -916,9 +990,9 @@ static void analyze_subtitle_scan( hb_job_t * job )
 
     // Before closing the title print out our subtitle stats if we need to
     // find the highest and lowest.
-    for (i = 0; i < hb_list_count(job->list_subtitle); i++)
+    for (i = 0; i < hb_list_count(list_subtitle); i++)
     {
-        subtitle = hb_list_item(job->list_subtitle, i);
+        subtitle = hb_list_item(list_subtitle, i);
 
         hb_log("Subtitle track %d (id 0x%x) '%s': %d hits (%d forced)",
                subtitle->track, subtitle->id, subtitle->lang,
@@ -949,7 +1023,7 @@ static void analyze_subtitle_scan( hb_job_t * job )
         }
     }
 
-    if (subtitle_forced_id && job->select_subtitle_config.force)
+    if (subtitle_forced_id && force)
     {
         // If there is a subtitle stream with forced subtitles and forced-only
         // is set, then select it in preference to the lowest.
@@ -970,23 +1044,36 @@ static void analyze_subtitle_scan( hb_job_t * job )
     else
     {
         hb_log( "No candidate detected during subtitle scan" );
+        return NULL;
     }
 
-    for (i = 0; i < hb_list_count( job->list_subtitle ); i++)
+    for (i = 0; i < hb_list_count( list_subtitle ); i++)
     {
-        subtitle = hb_list_item( job->list_subtitle, i );
+        subtitle = hb_list_item( list_subtitle, i );
         if (subtitle->id == subtitle_hit)
         {
-            hb_interjob_t *interjob = hb_interjob_get(job->h);
-
-            subtitle->config = job->select_subtitle_config;
-            // Remove from list since we are taking ownership
-            // of the subtitle.
-            hb_list_rem(job->list_subtitle, subtitle);
-            interjob->select_subtitle = subtitle;
-            break;
+            return subtitle;
         }
     }
+    return NULL;
+}
+
+static void analyze_subtitle_scan( hb_job_t * job )
+{
+    hb_subtitle_t *subtitle;
+
+    subtitle = hb_subtitle_search_select(job->list_subtitle,
+                                         job->select_subtitle_config.force);
+    if (subtitle != NULL)
+    {
+        hb_interjob_t *interjob = hb_interjob_get(job->h);
+
+        subtitle->config = job->select_subtitle_config;
+        // Remove from list since we are taking ownership
+        // of the subtitle.
+        hb_list_rem(job->list_subtitle, subtitle);
+        interjob->select_subtitle = subtitle;
+    }
 }
 
 static int sanitize_subtitles( hb_job_t * job )
@@ -1063,6 +1150,13 @@ static int sanitize_subtitles( hb_job_t * job )
     for (i = 0; i < hb_list_count(job->list_subtitle);)
     {
         subtitle = hb_list_item(job->list_subtitle, i);
+        if (subtitle->search_candidate)
+        {
+            // Foreign audio search candidates are spooled by the muxer,
+            // see hb_add_internal()
+            subtitle->out_track = ++i;
+            continue;
+        }
         if (subtitle->config.dest == RENDERSUB)
         {
             if (one_burned)
@@ -1741,6 +1835,10 @@ static void do_job(hb_job_t *job)
     hb_title_t       * title;
     hb_interjob_t    * interjob;
     hb_work_object_t * w;
+    hb_work_object_t * video_encoder = NULL;
+    hb_list_t        * audio_pool = NULL;
+    hb_fifo_t        * fifo_pass_cache = NULL;
+    int                pass_cache_replay = 0;
 
     title = job->title;
 
@@ -1749,6 +1847,7 @@ static void do_job(hb_job_t *job)
     {
         // New job sequence, clear interjob
         hb_subtitle_close(&interjob->select_subtitle);
+        hb_pass_cache_close(&interjob->pass_cache);
         memset(interjob, 0, sizeof(*interjob));
         interjob->sequence_id = job->sequence_id;
     }
@@ -1853,6 +1952,7 @@ static void do_job(hb_job_t *job)
         init.vrate = job->vrate;
         init.cfr = 0;
         init.grayscale = 0;
+        job->decimate = 1;
 
         for( i = 0; i < hb_list_count( job->list_filter ); )
         {
@@ -1914,6 +2014,7 @@ static void do_job(hb_job_t *job)
         memset(job->crop, 0, sizeof(int[4]));
         job->vrate = title->vrate;
         job->cfr = 0;
+        job->decimate = 1;
     }
 
     job->orig_vrate = job->vrate;
@@ -1956,6 +2057,24 @@ static void do_job(hb_job_t *job)
         goto cleanup;
     }
 
+    // The first analysis pass stores what reaches the video encoder and
+    // the muxer, so that the final pass can skip reading, decoding and
+    // filtering the source again. See passcache.c
+    if (job->multipass && job->multipass_cache > 0 && !job->indepth_scan)
+    {
+        if (job->pass_id == HB_PASS_ENCODE_ANALYSIS &&
+            interjob->pass_cache == NULL)
+        {
+            interjob->pass_cache = hb_pass_cache_init(job);
+            job->pass_cache = interjob->pass_cache;
+        }
+        else if (job->pass_id == HB_PASS_ENCODE_FINAL)
+        {
+            pass_cache_replay = hb_pass_cache_can_replay(interjob->pass_cache,
+                                                         job);
+        }
+    }
+
     if (!job->indepth_scan)
     {
         // Set up audio decoder work objects
@@ -1965,11 +2084,27 @@ static void do_job(hb_job_t *job)
             hb_audio_t *audio = hb_list_item(job->list_audio, i);
 
             /* set up the audio work fifos */
-            audio->priv.fifo_in   = hb_fifo_init(FIFO_LARGE, FIFO_LARGE_WAKE);
             audio->priv.fifo_raw  = hb_fifo_init(FIFO_SMALL, FIFO_SMALL_WAKE);
             audio->priv.fifo_sync = hb_fifo_init(FIFO_SMALL, FIFO_SMALL_WAKE);
             audio->priv.fifo_out  = hb_fifo_init(FIFO_LARGE, FIFO_LARGE_WAKE);
 
+            // Tracks that re-encode the same source track share its
+            // decoder. They get no fifo_in, so the reader only feeds
+            // the decoder once.
+            w = find_shared_audio_decoder(job, audio);
+            if (w != NULL)
+            {
+                if (w->list_audio == NULL)
+                {
+                    w->list_audio = hb_list_init();
+                }
+                hb_list_add(w->list_audio, audio);
+                hb_log("work: track %d shares the decoder of track %d",
+                       audio->config.out.track, w->audio->config.out.track);
+                continue;
+            }
+            audio->priv.fifo_in   = hb_fifo_init(FIFO_LARGE, FIFO_LARGE_WAKE);
+
             // Add audio decoder work object
             w = hb_audio_decoder(job->h, audio->config.in.codec);
             if (w == NULL)
@@ -2190,8 +2325,18 @@ static void do_job(hb_job_t *job)
             job->fifo_render = NULL;
         }
 
+        if (job->pass_cache != NULL)
+        {
+            // Store the frames sent to the video encoder
+            w = hb_get_work(job->h, WORK_PASS_CACHE_WRITER);
+            w->fifo_in  = job->fifo_render ? job->fifo_render : job->fifo_sync;
+            w->fifo_out = fifo_pass_cache = hb_fifo_init(FIFO_MINI, FIFO_MINI_WAKE);
+            job->fifo_render = fifo_pass_cache;
+            hb_list_add(job->list_work, w);
+        }
+
         // Video encoder
-        w = hb_video_encoder(job->h, job->vcodec);
+        w = video_encoder = hb_video_encoder(job->h, job->vcodec);
         if (w == NULL)
         {
             *job->done_error = HB_ERROR_INIT;
@@ -2214,6 +2359,16 @@ static void do_job(hb_job_t *job)
         hb_list_add( job->list_work, w );
     }
 
+    if (pass_cache_replay)
+    {
+        // Feeds the video encoder and the muxer from the cache of the
+        // analysis pass. The reader, decoders, sync, filters and audio
+        // encoders are initialized as usual, but are not started.
+        w = hb_get_work(job->h, WORK_PASS_CACHE_READER);
+        w->fifo_out = video_encoder->fifo_in;
+        hb_list_add(job->list_work, w);
+    }
+
     // Add Muxer work object
     // Muxer work object should be the last object added to the list
     // during regular encoding pass.  For subtitle scan, sync is last.
@@ -2232,6 +2387,21 @@ static void do_job(hb_job_t *job)
     /* Display settings */
     hb_display_job_info( job );
 
+    // Single pass average bitrate encodes can be guided by rate control
+    // zones from a quick analysis of the title, see complexity.c
+    if (job->complexity_analysis && job->pass_id == HB_PASS_ENCODE &&
+        job->vquality <= HB_INVALID_VIDEO_QUALITY && job->cfr == 1 &&
+        !job->indepth_scan && !job->start_at_preview &&
+        ((job->vcodec & HB_VCODEC_X264_MASK) ||
+         (job->vcodec & HB_VCODEC_X265_MASK)))
+    {
+        job->rc_zones = hb_complexity_zones(job);
+        if (*job->die)
+        {
+            goto cleanup;
+        }
+    }
+
     // Initialize all work objects
     job->done = 0;
     for (i = 0; i < hb_list_count( job->list_work ); i++)
@@ -2251,10 +2421,20 @@ static void do_job(hb_job_t *job)
     for (i = 0; i < hb_list_count( job->list_work ); i++)
     {
         w = hb_list_item(job->list_work, i);
+        if (pass_cache_replay && w != video_encoder &&
+            w->id != WORK_PASS_CACHE_READER && w->id != WORK_MUX)
+        {
+            continue;
+        }
+        if (w->audio != NULL)
+        {
+            // Audio decoders and encoders run on the audio worker pool
+            continue;
+        }
         w->thread = hb_thread_init(w->name, hb_work_loop, w, HB_LOW_PRIORITY);
     }
 
-    if (!job->indepth_scan)
+    if (!job->indepth_scan && !pass_cache_replay)
     {
         for (i = 0; i < hb_list_count(job->list_filter); i++)
         {
@@ -2269,24 +2449,9 @@ static void do_job(hb_job_t *job)
             }
         }
 
-        for (i = 0; i < hb_list_count(job->list_audio); i++)
-        {
-            hb_audio_t *audio = hb_list_item(job->list_audio, i);
-            hb_list_t *list_filter = audio->config.out.list_filter;
-
-            for (int j = 0; j < hb_list_count(list_filter); j++)
-            {
-                hb_filter_object_t *filter = hb_list_item(list_filter, j);
-
-                if (!filter->skip)
-                {
-                    // Filters were initialized earlier, so we just need
-                    // to start the filter's thread
-                    filter->thread = hb_thread_init(filter->name, filter_loop,
-                                                    filter, HB_LOW_PRIORITY);
-                }
-            }
-        }
+        // Audio decoders, filters and encoders of all tracks are
+        // multiplexed over a small pool of worker threads
+        audio_pool = audio_pool_init(job);
     }
 
     // Wait for the thread of the last work object to complete
@@ -2321,6 +2486,10 @@ cleanup:
         }
     }
 
+    // Stop the audio worker pool before closing the audio filters
+    // and work objects that it runs
+    audio_pool_close(&audio_pool);
+
     for (i = 0; i < hb_list_count(job->list_audio); i++)
     {
         hb_audio_t *audio = hb_list_item(job->list_audio, i);
@@ -2352,6 +2521,7 @@ cleanup:
     {
         hb_list_rem(job->list_work, w);
         w->close(w);
+        hb_list_close(&w->list_audio);
         free(w);
     }
 
@@ -2362,6 +2532,9 @@ cleanup:
     hb_fifo_close( &job->fifo_raw );
     hb_fifo_close( &job->fifo_sync );
     hb_fifo_close( &job->fifo_out );
+    hb_fifo_close( &fifo_pass_cache );
+    free(job->rc_zones);
+    job->rc_zones = NULL;
 
     for (i = 0; i < hb_list_count( job->list_subtitle ); i++)
     {
@@ -2415,6 +2588,16 @@ cleanup:
         analyze_subtitle_scan(job);
     }
 
+    if (job->pass_cache != NULL)
+    {
+        hb_pass_cache_finish(job->pass_cache, job);
+        job->pass_cache = NULL;
+    }
+    else if (job->pass_id == HB_PASS_ENCODE_FINAL)
+    {
+        hb_pass_cache_close(&interjob->pass_cache);
+    }
+
     hb_buffer_pool_free();
     hb_hwaccel_hw_device_ctx_close(&job->hw_device_ctx);
 }
@@ -2599,3 +2782,303 @@ static void filter_loop( void * _f )
     }
 }
 
+
+static int audio_shared_is_full( hb_work_object_t * w )
+{
+    int ii;
+
+    for (ii = 0; ii < hb_list_count(w->list_audio); ii++)
+    {
+        hb_audio_t * audio = hb_list_item(w->list_audio, ii);
+        if (hb_fifo_is_full(audio->priv.fifo_raw))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Runs one step of an audio pool task.
+ * Processes up to AUDIO_POOL_BATCH buffers without blocking.
+ * Returns the number of buffers that were consumed or delivered.
+ * @param task Handle to the task.
+ * @param done Job done indicator.
+ */
+static int audio_task_run( hb_audio_task_t * task, volatile int * done )
+{
+    hb_work_object_t   * w = task->work;
+    hb_filter_object_t * f = task->filter;
+    hb_fifo_t          * fifo_in  = w ? w->fifo_in  : f->fifo_in;
+    hb_fifo_t          * fifo_out = w ? w->fifo_out : f->fifo_out;
+    hb_buffer_t        * buf_in, * buf_out;
+    int                  progress = 0;
+
+    if (task->pending != NULL)
+    {
+        if (hb_fifo_is_full(fifo_out))
+        {
+            return 0;
+        }
+        hb_fifo_push(fifo_out, task->pending);
+        task->pending = NULL;
+        progress++;
+    }
+
+    while (progress < AUDIO_POOL_BATCH && !*done)
+    {
+        if (w != NULL && audio_shared_is_full(w))
+        {
+            // A shared decoder pushes directly to the raw fifos of the
+            // other tracks it feeds. Wait till they have room.
+            break;
+        }
+        buf_in = hb_fifo_get(fifo_in);
+        if (buf_in == NULL)
+        {
+            break;
+        }
+        progress++;
+
+        if (task->finished)
+        {
+            // Consume data in incoming fifo till job completes so that
+            // residual data does not stall the pipeline.
+            hb_buffer_close(&buf_in);
+            continue;
+        }
+
+        buf_out = NULL;
+        if (w != NULL)
+        {
+            w->status = w->work(w, &buf_in, &buf_out);
+            copy_chapter(buf_out, buf_in);
+            task->finished = w->status == HB_WORK_DONE;
+        }
+        else
+        {
+            // Filters can drop buffers.  Remember chapter information
+            // so that it can be propagated to the next buffer
+            if (buf_in->s.new_chap)
+            {
+                f->chapter_time = buf_in->s.start;
+                f->chapter_val = buf_in->s.new_chap;
+                buf_in->s.new_chap = 0;
+            }
+            f->status = f->work(f, &buf_in, &buf_out);
+            if (buf_out && f->chapter_val && f->chapter_time <= buf_out->s.start)
+            {
+                buf_out->s.new_chap = f->chapter_val;
+                f->chapter_val = 0;
+            }
+            task->finished = f->status == HB_FILTER_DONE;
+        }
+
+        if (buf_in != NULL)
+        {
+            hb_buffer_close(&buf_in);
+        }
+        if (buf_out != NULL && fifo_out == NULL)
+        {
+            hb_buffer_close(&buf_out);
+        }
+        if (buf_out != NULL)
+        {
+            if (hb_fifo_is_full(fifo_out))
+            {
+                // Keep the output and let other tasks run till the
+                // downstream fifo has room again
+                task->pending = buf_out;
+                break;
+            }
+            hb_fifo_push(fifo_out, buf_out);
+        }
+    }
+
+    return progress;
+}
+
+/**
+ * Audio worker pool thread.
+ * Services the decoder, filter and encoder tasks of the audio tracks
+ * assigned to it in pipeline order, batching several buffers per task.
+ * Sleeps when none of its tasks can make progress, till one of their
+ * input fifos is pushed to or one of their output fifos drains.
+ * @param _worker Handle to the worker.
+ */
+static void audio_pool_loop( void * _worker )
+{
+    hb_audio_worker_t * worker = _worker;
+    hb_job_t          * job    = worker->job;
+
+    while (!*job->die && !job->done)
+    {
+        int progress = 0;
+
+        for (int ii = 0; ii < hb_list_count(worker->list_task); ii++)
+        {
+            hb_audio_task_t * task = hb_list_item(worker->list_task, ii);
+            progress += audio_task_run(task, &job->done);
+        }
+
+        if (!progress)
+        {
+            hb_fifo_alert_wait(worker->alert);
+        }
+    }
+}
+
+// Registers (or with alert NULL removes) the worker's alert on the
+// fifos that can unblock the task.  A shared decoder also waits for
+// room in the raw fifos of the other tracks it feeds.
+static void audio_task_register_alert( hb_audio_task_t * task,
+                                       hb_fifo_alert_t * alert )
+{
+    hb_work_object_t   * w = task->work;
+    hb_filter_object_t * f = task->filter;
+    hb_fifo_t          * fifo_out = w ? w->fifo_out : f->fifo_out;
+
+    hb_fifo_register_push_alert(w ? w->fifo_in : f->fifo_in, alert);
+    if (fifo_out != NULL)
+    {
+        hb_fifo_register_drain_alert(fifo_out, alert);
+    }
+    if (w != NULL)
+    {
+        for (int ii = 0; ii < hb_list_count(w->list_audio); ii++)
+        {
+            hb_audio_t * audio = hb_list_item(w->list_audio, ii);
+            hb_fifo_register_drain_alert(audio->priv.fifo_raw, alert);
+        }
+    }
+}
+
+static void audio_pool_add_task( hb_audio_worker_t * worker,
+                                 hb_work_object_t * w,
+                                 hb_filter_object_t * filter )
+{
+    hb_audio_task_t * task = calloc(1, sizeof(hb_audio_task_t));
+
+    task->work   = w;
+    task->filter = filter;
+    hb_list_add(worker->list_task, task);
+    audio_task_register_alert(task, worker->alert);
+}
+
+/**
+ * Creates the audio worker pool and starts its threads.
+ * Every stage of an audio track is assigned to the same worker so that
+ * the buffers of a track are always processed in order.
+ * @param job Handle to the job.
+ */
+static hb_list_t * audio_pool_init( hb_job_t * job )
+{
+    int track_count = hb_list_count(job->list_audio);
+    int worker_count, ii, jj;
+
+    if (track_count == 0)
+    {
+        return NULL;
+    }
+
+    worker_count = MAX(1, hb_get_cpu_count() / 4);
+    worker_count = MIN(worker_count, track_count);
+
+    hb_list_t * pool = hb_list_init();
+    for (ii = 0; ii < worker_count; ii++)
+    {
+        hb_audio_worker_t * worker = calloc(1, sizeof(hb_audio_worker_t));
+        worker->job       = job;
+        worker->list_task = hb_list_init();
+        worker->alert     = hb_fifo_alert_init();
+        hb_list_add(pool, worker);
+    }
+
+    for (ii = 0; ii < track_count; ii++)
+    {
+        hb_audio_t        * audio  = hb_list_item(job->list_audio, ii);
+        hb_audio_worker_t * worker = hb_list_item(pool, ii % worker_count);
+        hb_list_t         * list_filter = audio->config.out.list_filter;
+        hb_work_object_t  * decoder = NULL, * encoder = NULL;
+
+        for (jj = 0; jj < hb_list_count(job->list_work); jj++)
+        {
+            hb_work_object_t * w = hb_list_item(job->list_work, jj);
+            if (w->audio == audio)
+            {
+                if (w->fifo_in == audio->priv.fifo_in)
+                {
+                    decoder = w;
+                }
+                else
+                {
+                    encoder = w;
+                }
+            }
+        }
+
+        if (decoder != NULL)
+        {
+            audio_pool_add_task(worker, decoder, NULL);
+        }
+        for (jj = 0; jj < hb_list_count(list_filter); jj++)
+        {
+            hb_filter_object_t * filter = hb_list_item(list_filter, jj);
+            if (!filter->skip)
+            {
+                audio_pool_add_task(worker, NULL, filter);
+            }
+        }
+        if (encoder != NULL)
+        {
+            audio_pool_add_task(worker, encoder, NULL);
+        }
+    }
+
+    hb_log("work: %d audio track(s) on %d audio worker thread(s)",
+           track_count, worker_count);
+
+    for (ii = 0; ii < worker_count; ii++)
+    {
+        hb_audio_worker_t * worker = hb_list_item(pool, ii);
+        worker->thread = hb_thread_init("audio pool", audio_pool_loop,
+                                        worker, HB_LOW_PRIORITY);
+    }
+
+    return pool;
+}
+
+static void audio_pool_close( hb_list_t ** _pool )
+{
+    hb_list_t         * pool = *_pool;
+    hb_audio_worker_t * worker;
+
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    while ((worker = hb_list_item(pool, 0)) != NULL)
+    {
+        hb_audio_task_t * task;
+
+        hb_list_rem(pool, worker);
+        if (worker->thread != NULL)
+        {
+            // job->done is set, wake the worker so that it sees it
+            hb_fifo_alert_signal(worker->alert);
+            hb_thread_close(&worker->thread);
+        }
+        while ((task = hb_list_item(worker->list_task, 0)) != NULL)
+        {
+            hb_list_rem(worker->list_task, task);
+            audio_task_register_alert(task, NULL);
+            hb_buffer_close(&task->pending);
+            free(task);
+        }
+        hb_list_close(&worker->list_task);
+        hb_fifo_alert_close(&worker->alert);
+        free(worker);
+    }
+    hb_list_close(_pool);
+}
@@ -22,9 +22,7 @@ fi
 trap "rm ${JSON_TEMP} ${C_TEMP}" EXIT INT TERM
 
 "${SELF_DIR}/create_resources.py" preset_builtin.list "${JSON_TEMP}"
-echo 'const char hb_builtin_presets_json[] =' > "${C_TEMP}"
-"${SELF_DIR}/quotestring.py" "${JSON_TEMP}" >> "${C_TEMP}"
-echo ';' >> "${C_TEMP}"
+"${SELF_DIR}/quotepresets.py" "${JSON_TEMP}" "${C_TEMP}"
 cp "${C_TEMP}" "${LIBHB_DIR}/handbrake/preset_builtin.h"
 
 exit 0
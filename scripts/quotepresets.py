@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+import sys
+
+
+def cstring(ss, indent='      '):
+    # Split in short literals, some compilers limit their length
+    chunks = list()
+    for ii in range(0, len(ss), 100):
+        chunk = ss[ii:ii + 100]
+        chunk = chunk.replace('\\', '\\\\')
+        chunk = chunk.replace('"', '\\"')
+        chunks.append('"%s"' % chunk)
+    if len(chunks) == 0:
+        chunks.append('""')
+    return ('\n' + indent).join(chunks)
+
+
+def quote(obj, indent='      '):
+    return cstring(json.dumps(obj, separators=(',', ':'), sort_keys=True,
+                              ensure_ascii=False), indent)
+
+
+def flatten(presets, parent, table):
+    for preset in presets:
+        index = len(table)
+        entry = dict(preset)
+        if entry.get('Folder'):
+            children = entry.get('ChildrenArray', [])
+            entry['ChildrenArray'] = []
+            table.append((parent, entry))
+            flatten(children, index, table)
+        else:
+            table.append((parent, entry))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Creates a C table of the builtin presets from a resource json')
+    parser.add_argument('infile', metavar='<input>', type=argparse.FileType('r'), help='Input resource json')
+    parser.add_argument('outfile', metavar='<output>', type=argparse.FileType('w'), nargs='?',
+                        default=sys.stdout, help='Output C header [stdout]')
+    args = parser.parse_args()
+
+    resources = json.load(args.infile)
+    table = list()
+    flatten(resources['PresetBuiltin'], -1, table)
+
+    presets = [ii for ii, (parent, entry) in enumerate(table)
+               if not entry.get('Folder')]
+    by_name = sorted(presets, key=lambda ii: (table[ii][1]['PresetName'], ii))
+
+    out = args.outfile
+    out.write('// Generated by scripts/build-presets.sh, do not edit\n\n')
+    out.write('typedef struct\n{\n')
+    out.write('    int          parent;  // Index of the parent folder, -1 for none\n')
+    out.write('    const char * name;\n')
+    out.write('    const char * json;    // Folders have an empty ChildrenArray\n')
+    out.write('} hb_builtin_preset_t;\n\n')
+    out.write('static const char hb_builtin_preset_template_json[] =\n')
+    out.write('%s;\n\n' % quote(resources['PresetTemplate'], ''))
+    out.write('static const char hb_builtin_preset_cli_default_json[] =\n')
+    out.write('%s;\n\n' % quote(resources['PresetCLIDefault'], ''))
+    out.write('static const hb_builtin_preset_t hb_builtin_presets[] =\n{\n')
+    for parent, entry in table:
+        out.write('    { %d, %s,\n      %s },\n' %
+                  (parent, cstring(entry['PresetName']), quote(entry)))
+    out.write('};\n\n')
+    out.write('// Non-folder hb_builtin_presets indices, sorted by name\n')
+    out.write('static const int hb_builtin_presets_by_name[] =\n{\n')
+    for ii in range(0, len(by_name), 10):
+        out.write('    %s,\n' % ', '.join(str(x) for x in by_name[ii:ii + 10]))
+    out.write('};\n')
+
+
+main()
@@ -159,6 +159,7 @@ static int     subtitle_all              = -1;
 static int     subburn                   = -1;
 static int     subburn_native            = -1;
 static int     subdefault                = 0;
+static int     subscan_single_pass       = 0;
 static char ** srtfile                   = NULL;
 static char ** srtcodeset                = NULL;
 static char ** srtoffset                 = NULL;
@@ -200,12 +201,15 @@ static char *   advanced_opts   = NULL;
 static int      maxHeight     = 0;
 static int      maxWidth      = 0;
 static int      fastanalysispass = -1;
+static int      multi_pass_cache = 0;
+static int      complexity_analysis = 0;
 static char *   preset_export_name   = NULL;
 static char *   preset_export_desc   = NULL;
 static char *   preset_export_file   = NULL;
 static char *   preset_name          = NULL;
 static char *   queue_import_name    = NULL;
 static int      cfr           = -1;
+static int      vfr_dedup     = -1;
 static int      optimize      = -1;
 static int      ipod_atom     = -1;
 static char *   color_range   = NULL;
@@ -226,6 +230,7 @@ static int      qsv_decode         = -1;
 #endif
 static int      hw_decode          = 0;
 static int      keep_duplicate_titles = 0;
+static int      fast_scan = 0;
 static int      hdr_dynamic_metadata_disable = 0;
 static char *   hdr_dynamic_metadata  = NULL;
 static int      metadata_passthru = -1;
@@ -445,8 +450,6 @@ void EventLoop(hb_handle_t *h, hb_dict_t *preset_dict)
             }
         }
 #endif
-        hb_snooze(200);
-
         HandleEvents( h, preset_dict );
     }
     job_running = 0;
@@ -519,7 +522,6 @@ int main( int argc, char ** argv )
     hb_handle_t * h;
 
     hb_global_init();
-    hb_presets_builtin_update();
     hb_presets_cli_default_init();
 
     /* Init libhb */
@@ -623,6 +625,7 @@ int main( int argc, char ** argv )
 
         hb_list_t *file_paths = hb_list_init();
         hb_list_add(file_paths, input);
+        hb_scan_set_fast(h, fast_scan);
         hb_scan(h, file_paths, titleindex, preview_count, store_previews,
                 min_title_duration * 90000LL, max_title_duration * 90000LL,
                 crop_threshold_frames, crop_threshold_pixels,
@@ -897,7 +900,9 @@ static int HandleEvents(hb_handle_t * h, hb_dict_t *preset_dict)
 {
     hb_state_t s;
 
-    hb_get_state( h, &s );
+    // Sleep until libhb reports a new state. Bounded so that
+    // keyboard input is still picked up while nothing happens.
+    hb_wait_state( h, &s, 200 );
     switch( s.state )
     {
         case HB_STATE_IDLE:
@@ -1716,6 +1721,9 @@ static void ShowHelp(void)
 "       --main-feature      Detect and select the main feature title.\n"
 "       --keep-duplicate-titles\n"
 "                           Keep duplicate titles when scanning (Blu-ray only)\n"
+"       --fast-scan         Decode only keyframes when scanning. Faster for\n"
+"                           high resolution sources, but may miss closed\n"
+"                           captions\n"
 "   -c, --chapters <string> Select chapters (e.g. \"1-3\" for chapters\n"
 "                           1 to 3 or \"3\" for chapter 3 only,\n"
 "                           default: all chapters)\n"
@@ -1813,6 +1821,16 @@ static void ShowHelp(void)
 "                           first pass to improve speed\n"
 "                           (works with x264 and x265)\n"
 "       --no-turbo          Disable 2-pass mode's \"turbo\" first pass\n"
+"   --multi-pass-cache <MiB>\n"
+"                           Store up to <MiB> of the first pass output, with\n"
+"                           video losslessly compressed, and reuse it for the\n"
+"                           final pass instead of decoding and filtering the\n"
+"                           source again (default: 0, off)\n"
+"   --complexity-analysis   For single pass average bitrate encodes, analyze\n"
+"                           a sample of the source first and let the encoder\n"
+"                           spend more bits on its harder parts\n"
+"                           (works with x264 and x265, constant frame rate\n"
+"                           output only)\n"
 "   -r, --rate <float>      Set video framerate\n"
 "                           (" );
     i = 0;
@@ -1855,6 +1873,10 @@ static void ShowHelp(void)
 "                           timing if it's below that rate.\n"
 "                           If none of these flags are given, the default\n"
 "                           is --pfr when -r is given and --vfr otherwise\n"
+"   --vfr-dedup             With --vfr, merge runs of identical frames\n"
+"                           (static scenes in animation or screen\n"
+"                           recordings) into single longer frames\n"
+"   --no-vfr-dedup          Disable duplicate frame merging\n"
 "   --hdr-dynamic-metadata  <string>\n"
 "                           Set the kind of HDR dynamic metadata to preserve:\n"
 "                               hdr10plus\n"
@@ -2287,6 +2309,12 @@ static void ShowHelp(void)
 "                           or less is selected. This should locate subtitles\n"
 "                           for short foreign language segments. Best used in\n"
 "                           conjunction with --subtitle-forced.\n"
+"      --subtitle-scan-single-pass\n"
+"                           Run the \"scan\" during the encode instead of\n"
+"                           in an extra pass. The selected track is added\n"
+"                           to the output when the encode is done.\n"
+"                           Only used for MP4 output when the scan result\n"
+"                           is not burned in.\n"
 "      --keep-subname       Passthru the source subtitle track(s) name(s).\n"
 "      --no-keep-subname    Disable the source subtitle track(s) name(s) passthru.\n"
 "  -S, --subname <string>   Set subtitle track name(s).\n"
@@ -2495,10 +2523,27 @@ static void Indent(FILE *f, char *whitespace, int indent)
     }
 }
 
+// Builtin presets are only added to the preset list when it is needed.
+// hb_presets_builtin_update() inserts them in front of the presets
+// added so far, so the final order is the same.
+static void LoadBuiltinPresets(void)
+{
+    static int loaded = 0;
+
+    if (!loaded)
+    {
+        hb_presets_builtin_update();
+        loaded = 1;
+    }
+}
+
 static void ShowPresets(hb_value_array_t *presets, int indent, int descriptions)
 {
     if (presets == NULL)
+    {
+        LoadBuiltinPresets();
         presets = hb_presets_get();
+    }
 
     int count = hb_value_array_len(presets);
     int ii;
@@ -2646,6 +2691,7 @@ static int ParseOptions( int argc, char ** argv )
     #define AUDIO_COMPRESSOR              339
     #define AUDIO_GATE                    340
     #define AUDIO_COMPRESSOR_TUNE         341
+    #define MULTI_PASS_CACHE              342
 
     for( ;; )
     {
@@ -2668,6 +2714,7 @@ static int ParseOptions( int argc, char ** argv )
             { "enable-hw-decoding",  required_argument,  NULL, HW_DECODE, },
 
             { "keep-duplicate-titles", no_argument,      NULL, KEEP_DUPLICATE_TITLES },
+            { "fast-scan",   no_argument,       &fast_scan, 1 },
 
             { "no-hdr-dynamic-metadata",  no_argument,       &hdr_dynamic_metadata_disable, 1 },
             { "hdr-dynamic-metadata",     required_argument, NULL, HDR_DYNAMIC_METADATA },
@@ -2822,6 +2869,8 @@ static int ParseOptions( int argc, char ** argv )
             { "arate",       required_argument, NULL,    'R' },
             { "turbo",       no_argument,       NULL,    'T' },
             { "no-turbo",    no_argument,       &fastanalysispass, 0 },
+            { "multi-pass-cache", required_argument, NULL, MULTI_PASS_CACHE },
+            { "complexity-analysis", no_argument, &complexity_analysis, 1 },
             { "maxHeight",   required_argument, NULL,    'Y' },
             { "maxWidth",    required_argument, NULL,    'X' },
             { "preset",      required_argument, NULL,    'Z' },
@@ -2837,6 +2886,7 @@ static int ParseOptions( int argc, char ** argv )
             { "no-keep-aname", no_argument,     &audio_name_passthru, 0 },
             { "automatic-naming-behaviour", required_argument, NULL, AUDIO_AUTONAMING_BEHAVIOUR },
             { "aname",       required_argument, NULL,    'A' },
+            { "subtitle-scan-single-pass", no_argument, &subscan_single_pass, 1 },
             { "keep-subname",    no_argument,   &sub_name_passthru, 1 },
             { "no-keep-subname", no_argument,   &sub_name_passthru, 0 },
             { "subname",     required_argument, NULL,    'S' },
@@ -2849,6 +2899,8 @@ static int ParseOptions( int argc, char ** argv )
             { "vfr",         no_argument,       &cfr,    0 },
             { "cfr",         no_argument,       &cfr,    1 },
             { "pfr",         no_argument,       &cfr,    2 },
+            { "vfr-dedup",   no_argument,       &vfr_dedup, 1 },
+            { "no-vfr-dedup",no_argument,       &vfr_dedup, 0 },
             { "audio-copy-mask", required_argument, NULL, ALLOWED_AUDIO_COPY },
             { "audio-fallback",  required_argument, NULL, AUDIO_FALLBACK },
             { "json",        no_argument,       NULL,    JSON_LOGGING },
@@ -3066,6 +3118,9 @@ static int ParseOptions( int argc, char ** argv )
             case AUDIO_COMPRESSOR_TUNE:
                 acompressor_tunes = hb_str_vsplit(optarg, ',');
                 break;
+            case MULTI_PASS_CACHE:
+                multi_pass_cache = strtol(optarg, NULL, 0);
+                break;
             case AUDIO_GATE:
                 agates = hb_str_vsplit(
                     optarg ? optarg : hb_filter_param_get_default_preset(HB_AUDIO_FILTER_AGATE), ',');
@@ -4315,28 +4370,40 @@ static hb_dict_t * PreparePreset(const char *preset_name)
     int preset_mux;
     const char *preset_format;
 
-    if (preset_name != NULL)
+    // Builtin presets come first in the preset list, so a builtin
+    // match is what a search of the full list would have found
+    preset = hb_presets_builtin_search(preset_name);
+    if (preset == NULL)
     {
-        preset = hb_preset_search(preset_name, 1 /*recurse*/,
-                                  HB_PRESET_TYPE_ALL);
+        if (preset_name != NULL)
+        {
+            LoadBuiltinPresets();
+            preset = hb_preset_search(preset_name, 1 /*recurse*/,
+                                      HB_PRESET_TYPE_ALL);
+            if (preset == NULL)
+            {
+                fprintf(stderr, "Invalid preset %s\n"
+                                "Valid presets are:\n", preset_name);
+                ShowPresets(NULL, 1, 1);
+                return NULL;
+            }
+        }
+        else
+        {
+            preset = hb_presets_get_default();
+            if (preset == NULL)
+            {
+                LoadBuiltinPresets();
+                preset = hb_presets_get_default();
+            }
+        }
         if (preset == NULL)
         {
-            fprintf(stderr, "Invalid preset %s\n"
-                            "Valid presets are:\n", preset_name);
-            ShowPresets(NULL, 1, 1);
+            fprintf(stderr, "Error loading presets! Aborting.\n");
             return NULL;
         }
+        preset = hb_value_dup(preset);
     }
-    else
-    {
-        preset = hb_presets_get_default();
-    }
-    if (preset == NULL)
-    {
-        fprintf(stderr, "Error loading presets! Aborting.\n");
-        return NULL;
-    }
-    preset = hb_value_dup(preset);
 
     int subtitle_track_count = count_subtitles(subtracks);
     // Apply any overrides that can be made directly to the preset
@@ -4969,6 +5036,10 @@ static hb_dict_t * PreparePreset(const char *preset_name)
                     hb_value_string(cfr == 0 ? "vfr" :
                                     cfr == 1 ? "cfr" : "pfr"));
     }
+    if (vfr_dedup != -1)
+    {
+        hb_dict_set(preset, "VideoFramerateDedup", hb_value_bool(vfr_dedup));
+    }
     if (color_range != NULL)
     {
         hb_dict_set(preset, "VideoColorRange",
@@ -5586,6 +5657,17 @@ PrepareJob(hb_handle_t *h, hb_title_t *title, hb_dict_t *preset_dict)
 
     hb_dict_set(dest_dict, "File", hb_value_string(output));
 
+    if (multi_pass_cache > 0)
+    {
+        hb_dict_set(hb_dict_get(job_dict, "Video"), "MultiPassCache",
+                    hb_value_int(multi_pass_cache));
+    }
+    if (complexity_analysis)
+    {
+        hb_dict_set(hb_dict_get(job_dict, "Video"), "ComplexityAnalysis",
+                    hb_value_bool(1));
+    }
+
     // Now that the job is initialized, we need to find out
     // what muxer is being used.
     mux = hb_container_get_from_name(
@@ -6106,6 +6188,8 @@ PrepareJob(hb_handle_t *h, hb_title_t *title, hb_dict_t *preset_dict)
                 hb_dict_set(subtitle_search, "Default", hb_value_bool(def));
                 hb_dict_set(subtitle_search, "Forced", hb_value_bool(force));
                 hb_dict_set(subtitle_search, "Burn", hb_value_bool(burn));
+                hb_dict_set(subtitle_search, "SinglePass",
+                            hb_value_bool(subscan_single_pass));
                 continue;
             }
 